@@ -16,7 +16,7 @@ using namespace std;
 * option selected should be all false for non-attempted questions OR no answer object at all.
 * 
 * we have choosen array<bool, 4> for option selected because the question object will have correct options
-* which is an unordered_set and will contain the option selected and is 0 based index.
+* which is a bitmask of the correct options, bit i being the 0 based option index.
 * so based on correct option index, lets say 0 & 3(i.e option A & D) is the answer then we need to check
 * against that index of opt_selected. e.g: opt_selected[0] && opt_selected[3] both should be true for a correct response.
 * 
@@ -1,17 +1,35 @@
 // ClientConnectionManager.cpp
 #include "ClientConnectionManager.hpp"
-#include <iostream>
+#include "Logger.h"
+#include <cstdlib>
+
+static const char * LOG_COMPONENT = "ClientConnectionManager";
+
+#define MAX_CONNECT_ATTEMPTS        20          // refused handshakes before giving up
+#define DEFAULT_RETRY_AFTER_MS      1000
+#define RESUME_RECONNECT_SPREAD_MS  500         // reconnects after a server restart are spread over this window
 
 ClientConnectionManager::ClientConnectionManager ()
     : quiz_controller (std::make_unique<ClientQuizController> ()),
     is_running (false),
-    is_connected (false)
+    is_connected (false),
+    connect_attempts (0),
+    is_compression_enabled (true),
+    compression_threshold (DEFAULT_COMPRESSION_THRESHOLD)
 {
 
     // Set up quiz controller callback to send messages
     quiz_controller->SetSendMessageCallback ([this] (const json & msg) {
         SendMessage (msg);
     });
+
+    quiz_controller->SetScheduleCallback ([this] (long long delay_ms, std::function<void ()> task) {
+        ws_client.set_timer (static_cast<long>(delay_ms), [task] (const websocketpp::lib::error_code & ec) {
+            if (!ec) {
+                task ();
+            }
+        });
+    });
 }
 
 ClientConnectionManager::~ClientConnectionManager ()
@@ -26,9 +44,9 @@ ClientConnectionManager::OnTlsInit (connection_hdl hdl)
         websocketpp::lib::asio::ssl::context::tlsv12_client);
     try {
         ctx->set_verify_mode (websocketpp::lib::asio::ssl::verify_none);
-        std::cout << "TLS init succeeded." << std::endl;
+        QUIZ_LOG_DEBUG (LOG_COMPONENT, "TLS init succeeded.");
     } catch (std::exception & e) {
-        std::cerr << "TLS init failed: " << e.what () << std::endl;
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "TLS init failed: %s", e.what ());
     }
     return ctx;
 }
@@ -36,35 +54,120 @@ ClientConnectionManager::OnTlsInit (connection_hdl hdl)
 void ClientConnectionManager::OnMessage (connection_hdl hdl, client::message_ptr msg)
 {
     try {
-        std::cout << "[RECEIVED] " << msg->get_payload () << std::endl;
+        QUIZ_LOG_DEBUG (LOG_COMPONENT, "[RECEIVED] %s", msg->get_payload ().c_str ());
 
         json response = json::parse (msg->get_payload ());
         quiz_controller->ProcessResponse (response);
 
     } catch (const std::exception & e) {
-        std::cerr << "Message processing exception: " << e.what () << std::endl;
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Message processing exception: %s", e.what ());
     }
 }
 
 void ClientConnectionManager::OnOpen (connection_hdl hdl)
 {
-    std::cout << "[CONNECTED] Successfully connected to server" << std::endl;
+    QUIZ_LOG_INFO (LOG_COMPONENT, "[CONNECTED] Successfully connected to server");
     is_connected = true;
+    connect_attempts = 0;
     ClientSessionManager::GetInstance ().SetState (ClientState::CONNECTED);
+
+    // no-op unless the previous connection was sent away by a server restart
+    quiz_controller->ResumeAfterReconnect ();
 }
 
 void ClientConnectionManager::OnClose (connection_hdl hdl)
 {
-    std::cout << "[DISCONNECTED] Connection closed" << std::endl;
+    websocketpp::lib::error_code ec;
+    client::connection_ptr con = ws_client.get_con_from_hdl (hdl, ec);
+    websocketpp::close::status::value code = ec ? websocketpp::close::status::blank : con->get_remote_close_code ();
+
+    QUIZ_LOG_INFO (LOG_COMPONENT, "[DISCONNECTED] Connection closed (%d)", static_cast<int>(code));
+
+    // 1012 - server restart handover, 1013 - evicted as a slow consumer, 1006 - the network dropped us:
+    // come back and pick up where we were
+    bool is_resumable = code == websocketpp::close::status::service_restart ||
+                        code == websocketpp::close::status::try_again_later ||
+                        code == websocketpp::close::status::abnormal_close;
+    if (is_resumable && is_running) {
+        quiz_controller->PrepareResume ();
+    }
+
     is_connected = false;
+    quiz_controller->ClearPendingRequests ();
     ClientSessionManager::GetInstance ().SetState (ClientState::DISCONNECTED);
+
+    if (is_resumable && is_running) {
+        ScheduleReconnect (static_cast<long long>(std::rand () % RESUME_RECONNECT_SPREAD_MS));
+    }
 }
 
 void ClientConnectionManager::OnFail (connection_hdl hdl)
 {
-    std::cout << "[FAILED] Connection failed" << std::endl;
     is_connected = false;
+    quiz_controller->ClearPendingRequests ();
     ClientSessionManager::GetInstance ().SetState (ClientState::DISCONNECTED);
+
+    // a 503 is admission control (or a restart in progress) - come back after the advertised delay
+    websocketpp::lib::error_code ec;
+    client::connection_ptr con = ws_client.get_con_from_hdl (hdl, ec);
+    bool is_busy = !ec && con->get_response_code () == websocketpp::http::status_code::service_unavailable;
+
+    // a session waiting to be resumed keeps trying through a network outage, anything else gives up here
+    if (!is_busy && !(is_running && quiz_controller->IsResumePending ())) {
+        QUIZ_LOG_WARN (LOG_COMPONENT, "[FAILED] Connection failed");
+        return;
+    }
+
+    if (++connect_attempts > MAX_CONNECT_ATTEMPTS) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Server still unreachable after %d attempts, giving up", MAX_CONNECT_ATTEMPTS);
+        return;
+    }
+
+    long long delay_ms = is_busy ? GetRetryAfterMs (con) : DEFAULT_RETRY_AFTER_MS + std::rand () % RESUME_RECONNECT_SPREAD_MS;
+    QUIZ_LOG_INFO (LOG_COMPONENT, "%s, reconnecting in %lld ms (attempt %d)", is_busy ? "Server busy" : "Server unreachable",
+                   delay_ms, connect_attempts.load ());
+    ScheduleReconnect (delay_ms);
+}
+
+long long ClientConnectionManager::GetRetryAfterMs (client::connection_ptr con) const
+{
+    // prefer our millisecond header, fall back to the standard one in seconds
+    long long delay_ms = DEFAULT_RETRY_AFTER_MS;
+    try {
+        std::string ms_header = con->get_response_header ("X-Retry-After-Ms");
+        std::string secs_header = con->get_response_header ("Retry-After");
+        if (!ms_header.empty ()) {
+            delay_ms = std::stoll (ms_header);
+        } else if (!secs_header.empty ()) {
+            delay_ms = std::stoll (secs_header) * 1000;
+        }
+    } catch (...) {
+        // malformed header - keep the default
+    }
+    return delay_ms;
+}
+
+void ClientConnectionManager::ScheduleReconnect (long long delay_ms)
+{
+    // the pending timer also keeps ws_client.run () alive until the next attempt
+    ws_client.set_timer (static_cast<long>(delay_ms), [this] (const websocketpp::lib::error_code & timer_ec) {
+        if (!timer_ec) {
+            Reconnect ();
+        }
+    });
+}
+
+void ClientConnectionManager::Reconnect ()
+{
+    websocketpp::lib::error_code ec;
+    client::connection_ptr con = ws_client.get_connection (server_uri, ec);
+    if (ec) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Connection creation failed: %s", ec.message ().c_str ());
+        return;
+    }
+
+    connection = con;
+    ws_client.connect (connection);
 }
 
 void ClientConnectionManager::SendMessage (const json & message)
@@ -72,21 +175,34 @@ void ClientConnectionManager::SendMessage (const json & message)
     if (is_connected && connection) {
         try {
             std::string msg_str = message.dump ();
-            std::cout << "[SENDING] " << msg_str << std::endl;
-            connection->send (msg_str);
+            QUIZ_LOG_DEBUG (LOG_COMPONENT, "[SENDING] %s", msg_str.c_str ());
+            client::message_ptr msg = connection->get_message (websocketpp::frame::opcode::text, msg_str.size ());
+            msg->set_payload (msg_str);
+            msg->set_compressed (is_compression_enabled && msg_str.size () >= compression_threshold);
+
+            websocketpp::lib::error_code ec = connection->send (msg);
+            if (ec) {
+                QUIZ_LOG_ERROR (LOG_COMPONENT, "Send message failed: %s", ec.message ().c_str ());
+            }
         } catch (const std::exception & e) {
-            std::cerr << "Send message exception: " << e.what () << std::endl;
+            QUIZ_LOG_ERROR (LOG_COMPONENT, "Send message exception: %s", e.what ());
         }
     } else {
-        std::cerr << "Cannot send message: not connected" << std::endl;
+        QUIZ_LOG_WARN (LOG_COMPONENT, "Cannot send message: not connected");
     }
 }
 
+void ClientConnectionManager::SetCompression (bool is_enabled, size_t threshold)
+{
+    is_compression_enabled = is_enabled;
+    compression_threshold = threshold;
+}
+
 bool ClientConnectionManager::ConnectToServer (const std::string & uri)
 {
     try {
         if (is_running) {
-            std::cout << "Already connected or connecting" << std::endl;
+            QUIZ_LOG_WARN (LOG_COMPONENT, "Already connected or connecting");
             return false;
         }
 
@@ -116,9 +232,10 @@ bool ClientConnectionManager::ConnectToServer (const std::string & uri)
 
         // Create connection
         websocketpp::lib::error_code ec;
+        server_uri = uri;
         connection = ws_client.get_connection (uri, ec);
         if (ec) {
-            std::cerr << "Connection creation failed: " << ec.message () << std::endl;
+            QUIZ_LOG_ERROR (LOG_COMPONENT, "Connection creation failed: %s", ec.message ().c_str ());
             return false;
         }
 
@@ -131,16 +248,16 @@ bool ClientConnectionManager::ConnectToServer (const std::string & uri)
             try {
                 ws_client.run ();
             } catch (const std::exception & e) {
-                std::cerr << "Client run exception: " << e.what () << std::endl;
+                QUIZ_LOG_ERROR (LOG_COMPONENT, "Client run exception: %s", e.what ());
             }
             is_running = false;
         });
 
-        std::cout << "Connecting to " << uri << "..." << std::endl;
+        QUIZ_LOG_INFO (LOG_COMPONENT, "Connecting to %s...", uri.c_str ());
         return true;
 
     } catch (const std::exception & e) {
-        std::cerr << "Connection exception: " << e.what () << std::endl;
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Connection exception: %s", e.what ());
         return false;
     }
 }
@@ -153,7 +270,7 @@ void ClientConnectionManager::Disconnect ()
                              websocketpp::close::status::going_away,
                              "Client disconnecting");
         } catch (const std::exception & e) {
-            std::cerr << "Disconnect exception: " << e.what () << std::endl;
+            QUIZ_LOG_ERROR (LOG_COMPONENT, "Disconnect exception: %s", e.what ());
         }
     }
 
@@ -3,13 +3,31 @@
 
 #include <websocketpp/config/asio_client.hpp>
 #include <websocketpp/client.hpp>
+#ifdef QUIZ_WS_COMPRESSION
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#endif
 #include <memory>
 #include <thread>
 #include <atomic>
 #include <nlohmann/json.hpp>
+#include "MessagePool.h"
 #include "ClientQuizController.hpp"
 
-using client = websocketpp::client<websocketpp::config::asio_tls_client>;
+// Client endpoint config - offers permessage-deflate to the server when built with zlib, frames come from MessagePool
+struct QuizClientConfig : public websocketpp::config::asio_tls_client {
+    typedef QuizClientConfig type;
+
+    typedef PooledMessage message_type;
+    typedef PooledConMsgManagerType con_msg_manager_type;
+    typedef PooledEndpointMsgManagerType endpoint_msg_manager_type;
+
+#ifdef QUIZ_WS_COMPRESSION
+    struct permessage_deflate_config { };
+    typedef websocketpp::extensions::permessage_deflate::enabled<permessage_deflate_config> permessage_deflate_type;
+#endif
+};
+
+using client = websocketpp::client<QuizClientConfig>;
 using connection_hdl = websocketpp::connection_hdl;
 using json = nlohmann::json;
 
@@ -23,6 +41,18 @@ private:
     std::atomic<bool> is_running;
     std::atomic<bool> is_connected;
 
+    // Automatic reconnects - after a 503 on the handshake (admission control) and after the server
+    // sent us away with 1012/1013 (restart handover, slow consumer eviction)
+    std::string server_uri;
+    std::atomic<int> connect_attempts;
+    long long GetRetryAfterMs (client::connection_ptr con) const;
+    void ScheduleReconnect (long long delay_ms);
+    void Reconnect ();
+
+    // Requests are small, so by default only the odd large SUBMIT_ANSWERS batch is worth deflating
+    std::atomic<bool> is_compression_enabled;
+    std::atomic<size_t> compression_threshold;
+
     // TLS configuration
     std::shared_ptr<websocketpp::lib::asio::ssl::context> OnTlsInit (connection_hdl hdl);
 
@@ -44,6 +74,9 @@ public:
     void Disconnect ();
     bool IsConnected () const;
 
+    // Outbound compression - only takes effect if the server accepted permessage-deflate
+    void SetCompression (bool is_enabled, size_t threshold = DEFAULT_COMPRESSION_THRESHOLD);
+
     // Get controller for UI interaction
     ClientQuizController & GetQuizController ();
 };
\ No newline at end of file
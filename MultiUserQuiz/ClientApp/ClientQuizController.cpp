@@ -1,5 +1,7 @@
 // ClientQuizController.cpp  
 #include "ClientQuizController.hpp"
+#include "Logger.h"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 
@@ -12,6 +14,11 @@ void ClientQuizController::SetSendMessageCallback (std::function<void (const jso
     send_message_callback = callback;
 }
 
+void ClientQuizController::SetScheduleCallback (std::function<void (long long, std::function<void ()>)> callback)
+{
+    schedule_callback = callback;
+}
+
 void ClientQuizController::SetStatusUpdateCallback (std::function<void (const std::string &)> callback)
 {
     on_status_update = callback;
@@ -27,6 +34,11 @@ void ClientQuizController::SetResultReceivedCallback (std::function<void (const
     on_result_received = callback;
 }
 
+void ClientQuizController::SetLeaderboardReceivedCallback (std::function<void (const json &)> callback)
+{
+    on_leaderboard_received = callback;
+}
+
 void ClientQuizController::SetErrorCallback (std::function<void (const std::string &)> callback)
 {
     on_error = callback;
@@ -34,55 +46,172 @@ void ClientQuizController::SetErrorCallback (std::function<void (const std::stri
 
 void ClientQuizController::Login (const std::string & username, const std::string & password)
 {
+    {
+        std::lock_guard<std::mutex> lock (resume_mutex);
+        resume_username = username;
+        resume_password = password;
+    }
+
     json request = {
         {"type", "LOGIN"},
         {"username", username},
         {"password", password}
     };
 
-    if (send_message_callback) {
-        send_message_callback (request);
+    SendRequest (request);
+}
+
+void ClientQuizController::PrepareResume ()
+{
+    std::lock_guard<std::mutex> lock (resume_mutex);
+    if (resume_username.empty () || session_mgr.GetState () == ClientState::CONNECTED) {
+        return;     // never logged in, nothing to resume
     }
+
+    is_resume_pending = true;
+    is_resuming_quiz = session_mgr.GetState () == ClientState::QUIZ_ACTIVE;
+    resume_started_at = std::chrono::steady_clock::now ();
+}
+
+void ClientQuizController::ResumeAfterReconnect ()
+{
+    std::string username, password, token;
+    unsigned long long seq;
+    {
+        std::lock_guard<std::mutex> lock (resume_mutex);
+        if (!is_resume_pending) {
+            return;
+        }
+        username = resume_username;
+        password = resume_password;
+        token = resume_token;
+        seq = last_seq;
+    }
+
+    if (on_status_update) {
+        on_status_update ("Reconnected, resuming session");
+    }
+
+    if (token.empty ()) {
+        Login (username, password);
+        return;
+    }
+
+    json request = {
+        {"type", "RESUME"},
+        {"resume_token", token},
+        {"last_seq", seq}
+    };
+
+    SendRequest (request);
+}
+
+bool ClientQuizController::IsResumePending () const
+{
+    std::lock_guard<std::mutex> lock (resume_mutex);
+    return is_resume_pending;
 }
 
 void ClientQuizController::StartQuiz ()
 {
     json request = {{"type", "START_QUIZ"}};
 
-    if (send_message_callback) {
-        send_message_callback (request);
-    }
+    SendRequest (request);
 }
 
 void ClientQuizController::ContinueQuiz ()
 {
     json request = {{"type", "CONTINUE_QUIZ"}};
 
-    if (send_message_callback) {
-        send_message_callback (request);
-    }
+    SendRequest (request);
 }
 
 void ClientQuizController::EndQuiz ()
 {
     json request = {{"type", "END_QUIZ"}};
 
-    if (send_message_callback) {
-        send_message_callback (request);
-    }
+    SendRequest (request);
 }
 
+/*
+* Shows the question straight from the prefetch cache when it is there, otherwise asks the server.
+* Either way the per question clock starts when the question is displayed, see DisplayQuestion.
+*/
 void ClientQuizController::FetchQuestion (unsigned int question_id)
 {
+    {
+        std::lock_guard<std::mutex> lock (display_mutex);
+        question_requested_at = std::chrono::steady_clock::now ();
+    }
+
+    json cached;
+    if (session_mgr.TakeCachedQuestion (question_id, cached)) {
+        // the cached timer was computed at fetch time - bring it up to the moment of display
+        cached["question_timer"] = session_mgr.ComputeQuestionTimer (cached.value ("question_timer", 0LL));
+        DisplayQuestion (cached);
+        return;
+    }
+
     json request = {
         {"type", "FETCH_QUESTION"},
         {"question_id", question_id}
     };
 
-    session_mgr.SetCurrentQuestion (question_id);
+    SendRequest (request, question_id);
+}
 
-    if (send_message_callback) {
-        send_message_callback (request);
+void ClientQuizController::FetchNextQuestion ()
+{
+    unsigned int question_id = session_mgr.GetNextUnattemptedQuestion ();
+    if (question_id == 0) {
+        if (on_status_update) {
+            on_status_update ("No unattempted questions left");
+        }
+        return;
+    }
+
+    FetchQuestion (question_id);
+}
+
+/*
+* Requests the next unattempted questions that are not cached yet, as a single FETCH_QUESTIONS frame
+* flagged as prefetch so the server leaves the user's activity time alone.
+*/
+void ClientQuizController::PrefetchQuestions ()
+{
+    if (!IsQuizActive ()) {
+        return;
+    }
+
+    std::vector<unsigned int> question_ids = session_mgr.ReservePrefetchCandidates ();
+    if (question_ids.empty ()) {
+        return;
+    }
+
+    json request = {
+        {"type", "FETCH_QUESTIONS"},
+        {"question_ids", question_ids},
+        {"prefetch", true}
+    };
+
+    SendRequest (request);
+}
+
+/*
+* Fetches many questions with one FETCH_QUESTIONS frame, split in chunks of MAX_BATCH_SIZE ids.
+* The chunks are pipelined, their responses are matched back through request_id.
+*/
+void ClientQuizController::FetchQuestions (const std::vector<unsigned int> & question_ids)
+{
+    for (size_t start = 0; start < question_ids.size (); start += MAX_BATCH_SIZE) {
+        size_t end = std::min (question_ids.size (), start + MAX_BATCH_SIZE);
+
+        json request = {
+            {"type", "FETCH_QUESTIONS"},
+            {"question_ids", std::vector<unsigned int> (question_ids.begin () + start, question_ids.begin () + end)}
+        };
+
+        SendRequest (request);
     }
 }
 
@@ -90,9 +219,7 @@ void ClientQuizController::FetchUnattemptedQuestions ()
 {
     json request = {{"type", "FETCH_UNATTEMPTED"}};
 
-    if (send_message_callback) {
-        send_message_callback (request);
-    }
+    SendRequest (request);
 }
 
 void ClientQuizController::SubmitAnswer (unsigned int question_id, const std::vector<int> & selected_options, long long time_to_attempt)
@@ -104,8 +231,29 @@ void ClientQuizController::SubmitAnswer (unsigned int question_id, const std::ve
         {"time_to_attempt_in_ms", time_to_attempt}
     };
 
-    if (send_message_callback) {
-        send_message_callback (request);
+    SendRequest (request, question_id);
+}
+
+void ClientQuizController::SubmitAnswers (const std::vector<QueuedAnswer> & answers)
+{
+    for (size_t start = 0; start < answers.size (); start += MAX_BATCH_SIZE) {
+        size_t end = std::min (answers.size (), start + MAX_BATCH_SIZE);
+        json entries = json::array ();
+
+        for (size_t i = start; i < end; ++i) {
+            entries.push_back ({
+                {"question_id", answers[i].question_id},
+                {"selected_options", answers[i].selected_options},
+                {"time_to_attempt_in_ms", answers[i].time_to_attempt}
+            });
+        }
+
+        json request = {
+            {"type", "SUBMIT_ANSWERS"},
+            {"answers", std::move (entries)}
+        };
+
+        SendRequest (request);
     }
 }
 
@@ -113,18 +261,96 @@ void ClientQuizController::Logout ()
 {
     json request = {{"type", "LOGOUT"}};
 
+    SendRequest (request);
+}
+
+void ClientQuizController::FetchLeaderboard (size_t top)
+{
+    json request = {
+        {"type", "LEADERBOARD"},
+        {"top", top}
+    };
+
+    SendRequest (request);
+}
+
+void ClientQuizController::SubscribeLeaderboard (bool is_subscribe, size_t top)
+{
+    json request = {
+        {"type", "SUBSCRIBE_LEADERBOARD"},
+        {"subscribe", is_subscribe},
+        {"top", top}
+    };
+
+    SendRequest (request);
+}
+
+void ClientQuizController::SendRequest (json & request, unsigned int question_id)
+{
+    unsigned long long request_id = next_request_id.fetch_add (1);
+    request["request_id"] = request_id;
+
+    {
+        std::lock_guard<std::mutex> lock (pending_mutex);
+        PendingRequest & pending = pending_requests[request_id];
+        pending = {request.value ("type", ""), question_id, std::chrono::steady_clock::now (), {}, {}};
+        if (request.value ("prefetch", false)) {
+            pending.prefetch_ids = request.value ("question_ids", std::vector<unsigned int>{});
+        }
+        if (pending.type == "LOGIN") {
+            pending.retry_request = request;
+        }
+    }
+
     if (send_message_callback) {
         send_message_callback (request);
     }
 }
 
+bool ClientQuizController::TakePendingRequest (const json & response, PendingRequest & pending)
+{
+    auto id_it = response.find ("request_id");
+    if (id_it == response.end () || !id_it->is_number_unsigned ()) {
+        // server push (timer notifications etc) - not a reply to any request
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock (pending_mutex);
+    auto it = pending_requests.find (id_it->get<unsigned long long> ());
+    if (it == pending_requests.end ()) {
+        return false;
+    }
+
+    pending = std::move (it->second);
+    pending_requests.erase (it);
+    return true;
+}
+
 void ClientQuizController::ProcessResponse (const json & response)
 {
     try {
         std::string type = response.value ("type", "");
 
+        PendingRequest pending {};
+        if (TakePendingRequest (response, pending)) {
+            QUIZ_LOG_DEBUG ("ClientQuizController", "%s (question %u) answered with %s in %lld ms",
+                            pending.type.c_str (), pending.question_id, type.c_str (),
+                            static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now () - pending.sent_at).count ()));
+        }
+
+        if (!pending.prefetch_ids.empty ()) {
+            // background work - never surfaces to the user, a failed prefetch just falls back to a normal fetch
+            HandlePrefetchedQuestions (type == "QUESTIONS" ? response : json::object (), pending);
+            return;
+        }
+
         if (type == "LOGIN_OK") {
             HandleLoginResponse (response);
+        } else if (type == "RESUME_OK") {
+            HandleResumed (response);
+        } else if (type == "RESUME_FAIL") {
+            HandleResumeFailed (response);
         } else if (type == "LOGIN_FAIL") {
             HandleError (response);
         } else if (type == "QUIZ_STARTED") {
@@ -133,18 +359,32 @@ void ClientQuizController::ProcessResponse (const json & response)
             HandleQuizRestarted (response);
         } else if (type == "QUESTION") {
             HandleQuestionResponse (response);
+        } else if (type == "QUESTIONS") {
+            HandleQuestionsResponse (response);
         } else if (type == "ANSWER_SUBMITTED") {
-            HandleAnswerSubmitted (response);
+            HandleAnswerSubmitted (response, response.value ("question_id", pending.question_id));
+        } else if (type == "ANSWERS_SUBMITTED") {
+            HandleAnswersSubmitted (response);
         } else if (type == "QUIZ_RESULT") {
             HandleQuizResult (response);
         } else if (type == "QUIZ_ENDED") {
             HandleQuizEnded (response);
         } else if (type == "LOGOUT_OK") {
             HandleLogoutResponse (response);
+        } else if (type == "RETRY_AFTER") {
+            HandleRetryAfter (response, pending);
+        } else if (type == "NOTIFICATION") {
+            HandleNotification (response);
+        } else if (type == "LEADERBOARD") {
+            HandleLeaderboard (response);
+        } else if (type == "LEADERBOARD_SUBSCRIBED") {
+            if (on_status_update) {
+                on_status_update (response.value ("subscribed", false) ? "Live leaderboard on" : "Live leaderboard off");
+            }
         } else if (type == "ERROR") {
             HandleError (response);
         } else {
-            std::cerr << "Unknown response type: " << type << std::endl;
+            QUIZ_LOG_WARN ("ClientQuizController", "Unknown response type: %s", type.c_str ());
         }
     } catch (const std::exception & e) {
         if (on_error) {
@@ -155,6 +395,12 @@ void ClientQuizController::ProcessResponse (const json & response)
 
 void ClientQuizController::HandleLoginResponse (const json & response)
 {
+    {
+        std::lock_guard<std::mutex> lock (resume_mutex);
+        resume_token = response.value ("resume_token", "");
+        last_seq = 0;
+    }
+
     std::string username = response.value ("welcome", "");
     session_mgr.SetUsername (username);
     session_mgr.SetState (ClientState::LOGGED_IN);
@@ -169,6 +415,103 @@ void ClientQuizController::HandleLoginResponse (const json & response)
             on_status_update ("Logged in as " + username);
         }
     }
+
+    bool is_continue_needed = false;
+    {
+        std::lock_guard<std::mutex> lock (resume_mutex);
+        if (is_resume_pending) {
+            is_continue_needed = is_resuming_quiz;
+            is_resume_pending = is_resuming_quiz;   // stays pending until the quiz is back
+        }
+    }
+
+    if (is_continue_needed) {
+        ContinueQuiz ();
+    }
+}
+
+/*
+* RESUME_OK - the session is back on this connection. The local quiz state is still ours, it only
+* misses the answers the server graded after the last sequence number we saw (a response lost with
+* the old connection), so apply those and carry on without a CONTINUE_QUIZ round trip.
+*/
+void ClientQuizController::HandleResumed (const json & response)
+{
+    bool was_quiz_active;
+    {
+        std::lock_guard<std::mutex> lock (resume_mutex);
+        resume_token = response.value ("resume_token", resume_token);
+        was_quiz_active = is_resuming_quiz;
+        is_resume_pending = false;
+        QUIZ_LOG_INFO ("ClientQuizController", "Session resumed %lld ms after the connection dropped",
+                       static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now () - resume_started_at).count ()));
+    }
+
+    session_mgr.SetUsername (response.value ("welcome", ""));
+    session_mgr.SetState (ClientState::LOGGED_IN);
+
+    if (!response.value ("quiz_started", false)) {
+        if (on_status_update) {
+            on_status_update ("Session resumed as " + session_mgr.GetUsername ());
+        }
+        return;
+    }
+
+    if (response.value ("full", false)) {
+        session_mgr.UpdateUnattemptedQuestions (response.value ("question_ids", std::vector<unsigned int>{}));
+    }
+    for (const json & change : response.value ("changes", json::array ())) {
+        session_mgr.MarkQuestionAttempted (change.value ("question_id", 0u));
+    }
+    session_mgr.UpdateQuizProgress (response);
+    TrackSequence (response);
+
+    if (response.value ("time_elapsed", false) || session_mgr.GetUnattemptedQuestions ().empty ()) {
+        session_mgr.SetState (ClientState::QUIZ_ENDED);
+        if (on_status_update) {
+            on_status_update ("Session resumed, the quiz is over - request the result");
+        }
+        return;
+    }
+
+    if (was_quiz_active || response.value ("full", false)) {
+        session_mgr.SetState (ClientState::QUIZ_ACTIVE);
+    }
+
+    if (on_status_update) {
+        on_status_update ("Session resumed! Remaining questions: " + std::to_string (session_mgr.GetUnattemptedQuestions ().size ()));
+    }
+
+    PrefetchQuestions ();
+}
+
+void ClientQuizController::HandleResumeFailed (const json & response)
+{
+    std::string username, password;
+    {
+        std::lock_guard<std::mutex> lock (resume_mutex);
+        resume_token.clear ();
+        username = resume_username;
+        password = resume_password;
+    }
+
+    QUIZ_LOG_INFO ("ClientQuizController", "Resume refused (%s), logging in again",
+                   response.value ("reason", "").c_str ());
+
+    // the regular path - LOGIN, then CONTINUE_QUIZ from HandleLoginResponse
+    Login (username, password);
+}
+
+void ClientQuizController::TrackSequence (const json & response)
+{
+    auto seq_it = response.find ("seq");
+    if (seq_it == response.end () || !seq_it->is_number_unsigned ()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock (resume_mutex);
+    last_seq = std::max (last_seq, seq_it->get<unsigned long long> ());
 }
 
 void ClientQuizController::HandleQuizStarted (const json & response)
@@ -176,13 +519,31 @@ void ClientQuizController::HandleQuizStarted (const json & response)
     session_mgr.SetState (ClientState::QUIZ_ACTIVE);
     session_mgr.UpdateQuizConfig (response);
 
+    std::vector<unsigned int> unattempted (session_mgr.GetTotalQuestions ());
+    for (size_t i = 0; i < unattempted.size (); ++i) {
+        unattempted[i] = static_cast<unsigned int>(i + 1);
+    }
+    session_mgr.UpdateUnattemptedQuestions (unattempted);
+
     if (on_status_update) {
         on_status_update ("Quiz started! Total questions: " + std::to_string (session_mgr.GetTotalQuestions ()));
     }
+
+    PrefetchQuestions ();
 }
 
 void ClientQuizController::HandleQuizRestarted (const json & response)
 {
+    {
+        std::lock_guard<std::mutex> lock (resume_mutex);
+        if (is_resume_pending) {
+            is_resume_pending = false;
+            QUIZ_LOG_INFO ("ClientQuizController", "Quiz resumed %lld ms after the server sent us away",
+                           static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::steady_clock::now () - resume_started_at).count ()));
+        }
+    }
+
     session_mgr.SetState (ClientState::QUIZ_ACTIVE);
     session_mgr.UpdateQuizConfig (response);
 
@@ -194,21 +555,78 @@ void ClientQuizController::HandleQuizRestarted (const json & response)
     if (on_status_update) {
         on_status_update ("Quiz resumed! Remaining questions: " + std::to_string (session_mgr.GetUnattemptedQuestions ().size ()));
     }
+
+    PrefetchQuestions ();
 }
 
 void ClientQuizController::HandleQuestionResponse (const json & response)
 {
     session_mgr.UpdateQuizProgress (response);
 
+    json question = response;
+    DisplayQuestion (question);
+}
+
+void ClientQuizController::DisplayQuestion (json & question)
+{
+    // with several fetches in flight the current question is the one that was last delivered, not last requested
+    session_mgr.SetCurrentQuestion (question.value ("id", 0u));
+
+    long long wait_ms;
+    {
+        std::lock_guard<std::mutex> lock (display_mutex);
+        wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now () - question_requested_at).count ();
+    }
+    session_mgr.MarkQuestionDisplayed (wait_ms);
+
     if (on_question_received) {
-        on_question_received (response);
+        on_question_received (question);
     }
+
+    PrefetchQuestions ();
 }
 
-void ClientQuizController::HandleAnswerSubmitted (const json & response)
+void ClientQuizController::HandleQuestionsResponse (const json & response)
 {
     session_mgr.UpdateQuizProgress (response);
 
+    for (const json & question : response.value ("questions", json::array ())) {
+        json single = question;
+        single["type"] = "QUESTION";
+        single["question_timer"] = response.value ("question_timer", 0LL);
+        HandleQuestionResponse (single);
+    }
+
+    if (!response.value ("invalid_ids", json::array ()).empty () && on_error) {
+        on_error ("Some question ids were rejected: " + response["invalid_ids"].dump ());
+    }
+}
+
+void ClientQuizController::HandlePrefetchedQuestions (const json & response, const PendingRequest & pending)
+{
+    for (const json & question : response.value ("questions", json::array ())) {
+        json cached = question;
+        cached["type"] = "QUESTION";
+        cached["question_timer"] = response.value ("question_timer", 0LL);
+        session_mgr.CacheQuestion (cached);
+    }
+
+    // ids that did not come back (invalid or the request failed) are free to be prefetched or fetched again
+    for (unsigned int qid : pending.prefetch_ids) {
+        session_mgr.ReleasePrefetch (qid);
+    }
+
+    QUIZ_LOG_DEBUG ("ClientQuizController", "Prefetched %zu of %zu questions",
+                    response.value ("questions", json::array ()).size (), pending.prefetch_ids.size ());
+}
+
+void ClientQuizController::HandleAnswerSubmitted (const json & response, unsigned int question_id)
+{
+    session_mgr.UpdateQuizProgress (response);
+    session_mgr.MarkQuestionAttempted (question_id);
+    TrackSequence (response);
+
     int status = response.value ("status", -1);
     std::string status_msg;
 
@@ -222,6 +640,36 @@ void ClientQuizController::HandleAnswerSubmitted (const json & response)
     if (on_status_update) {
         on_status_update ("Answer submitted: " + status_msg + " | Score: " + std::to_string (session_mgr.GetCurrentScore ()));
     }
+
+    PrefetchQuestions ();
+}
+
+void ClientQuizController::HandleAnswersSubmitted (const json & response)
+{
+    session_mgr.UpdateQuizProgress (response);
+    TrackSequence (response);
+
+    int correct = 0, incorrect = 0, partial = 0, rejected = 0;
+
+    for (const json & result : response.value ("results", json::array ())) {
+        if (result.contains ("status")) {
+            session_mgr.MarkQuestionAttempted (result.value ("question_id", 0u));
+        }
+        switch (result.value ("status", -1)) {
+            case 0: ++correct; break;
+            case 1: ++incorrect; break;
+            case 2: ++partial; break;
+            default: ++rejected; break;
+        }
+    }
+
+    if (on_status_update) {
+        on_status_update ("Answers submitted: " + std::to_string (correct) + " correct, " +
+                          std::to_string (partial) + " partial, " + std::to_string (incorrect) + " incorrect, " +
+                          std::to_string (rejected) + " rejected | Score: " + std::to_string (session_mgr.GetCurrentScore ()));
+    }
+
+    PrefetchQuestions ();
 }
 
 void ClientQuizController::HandleQuizResult (const json & response)
@@ -233,7 +681,7 @@ void ClientQuizController::HandleQuizResult (const json & response)
     }
 }
 
-void ClientQuizController::HandleQuizEnded (const json & response)
+void ClientQuizController::HandleQuizEnded (const json &)
 {
     session_mgr.SetState (ClientState::QUIZ_ENDED);
 
@@ -242,8 +690,17 @@ void ClientQuizController::HandleQuizEnded (const json & response)
     }
 }
 
-void ClientQuizController::HandleLogoutResponse (const json & response)
+void ClientQuizController::HandleLogoutResponse (const json &)
 {
+    {
+        std::lock_guard<std::mutex> lock (resume_mutex);
+        resume_username.clear ();
+        resume_password.clear ();
+        resume_token.clear ();
+        last_seq = 0;
+        is_resume_pending = false;
+    }
+
     session_mgr.Reset ();
     session_mgr.SetState (ClientState::CONNECTED);
 
@@ -252,6 +709,56 @@ void ClientQuizController::HandleLogoutResponse (const json & response)
     }
 }
 
+// both the reply to LEADERBOARD and the periodic pushes to subscribers
+void ClientQuizController::HandleLeaderboard (const json & response)
+{
+    if (on_leaderboard_received) {
+        on_leaderboard_received (response);
+    }
+}
+
+void ClientQuizController::HandleNotification (const json & response)
+{
+    std::string event = response.value ("event", "");
+
+    // quiz wide timer and admin events - the server coalesces them, only the latest one arrives
+    if (event == "QUIZ_TIMEOUT" || event == "QUIZ_FORCE_STOPPED" || event == "ALL_QUIZZES_FORCE_STOPPED") {
+        session_mgr.SetState (ClientState::QUIZ_ENDED);
+    }
+
+    if (on_status_update) {
+        on_status_update ("Server notification: " + event);
+    }
+}
+
+/*
+* The server is shedding load - send the same command again after the delay it asked for.
+* The delay is already jittered server side, so clients refused together do not return together.
+*/
+void ClientQuizController::HandleRetryAfter (const json & response, const PendingRequest & pending)
+{
+    long long retry_after_ms = response.value ("retry_after_ms", 1000LL);
+
+    if (pending.retry_request.is_null () || !schedule_callback) {
+        if (on_error) {
+            on_error ("Server busy, please retry " + response.value ("command", std::string ("the last command")));
+        }
+        return;
+    }
+
+    if (on_status_update) {
+        on_status_update ("Server busy, retrying " + pending.type + " in " + std::to_string (retry_after_ms) + " ms");
+    }
+
+    json request = pending.retry_request;
+    request.erase ("request_id");
+    schedule_callback (retry_after_ms, [this, request] () mutable {
+        if (IsConnected ()) {
+            SendRequest (request);
+        }
+    });
+}
+
 void ClientQuizController::HandleError (const json & response)
 {
     std::string message = response.value ("message", response.value ("reason", "Unknown error"));
@@ -287,4 +794,21 @@ std::string ClientQuizController::GetStatusString () const
         case ClientState::QUIZ_ENDED: return "Quiz ended - " + session_mgr.GetUsername ();
         default: return "Unknown state";
     }
-}
\ No newline at end of file
+}
+
+size_t ClientQuizController::GetPendingRequestCount () const
+{
+    std::lock_guard<std::mutex> lock (pending_mutex);
+    return pending_requests.size ();
+}
+
+void ClientQuizController::ClearPendingRequests ()
+{
+    {
+        std::lock_guard<std::mutex> lock (pending_mutex);
+        pending_requests.clear ();
+    }
+
+    // prefetches in flight died with the connection, start the cache over after reconnecting
+    session_mgr.ClearQuestionCache ();
+}
@@ -1,34 +1,93 @@
 #pragma once
 
 #include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "ClientSessionManager.hpp"
+#include "QuizDefs.h"
 
 using json = nlohmann::json;
 
+// An answer held back by the client (e.g. kiosk without connectivity) to be flushed with SubmitAnswers
+struct QueuedAnswer {
+    unsigned int question_id;
+    std::vector<int> selected_options;
+    long long time_to_attempt;
+};
+
 class ClientQuizController {
 
 private:
+    // Book keeping for a request that is still waiting for its response, keyed by request_id
+    struct PendingRequest {
+        std::string type;
+        unsigned int question_id;
+        std::chrono::steady_clock::time_point sent_at;
+        std::vector<unsigned int> prefetch_ids;     // set only for background prefetches
+        json retry_request;                         // kept for commands the server may answer with RETRY_AFTER
+    };
+
     ClientSessionManager & session_mgr;
     std::function<void (const json &)> send_message_callback;
+    std::function<void (long long, std::function<void ()>)> schedule_callback;
+
+    std::atomic<unsigned long long> next_request_id {1};
+    std::unordered_map<unsigned long long, PendingRequest> pending_requests;
+    mutable std::mutex pending_mutex;
+
+    // Resume after the server sent us away - credentials of the last login and whether a quiz was running.
+    // The resume token and the last answer sequence seen let us RESUME, the credentials are the fallback.
+    std::string resume_username;
+    std::string resume_password;
+    std::string resume_token;
+    unsigned long long last_seq = 0;
+    bool is_resume_pending = false;
+    bool is_resuming_quiz = false;
+    std::chrono::steady_clock::time_point resume_started_at;
+    mutable std::mutex resume_mutex;
+
+    // When the user asked for the question that is about to be shown, used to measure the perceived wait
+    std::chrono::steady_clock::time_point question_requested_at;
+    std::mutex display_mutex;
+
+    // Stamps the request with a fresh request_id, remembers it as pending and sends it
+    void SendRequest (json & request, unsigned int question_id = 0);
+    bool TakePendingRequest (const json & response, PendingRequest & pending);
+
+    // Prefetch - keeps the next few unattempted questions cached so they can be shown without a round trip
+    void PrefetchQuestions ();
+    void DisplayQuestion (json & question);
 
     // Response handlers
     void HandleLoginResponse (const json & response);
+    void HandleResumed (const json & response);
+    void HandleResumeFailed (const json & response);
     void HandleQuizStarted (const json & response);
     void HandleQuizRestarted (const json & response);
     void HandleQuestionResponse (const json & response);
-    void HandleAnswerSubmitted (const json & response);
+    void HandleQuestionsResponse (const json & response);
+    void HandlePrefetchedQuestions (const json & response, const PendingRequest & pending);
+    void HandleAnswerSubmitted (const json & response, unsigned int question_id);
+    void HandleAnswersSubmitted (const json & response);
     void HandleQuizResult (const json & response);
     void HandleQuizEnded (const json & response);
     void HandleLogoutResponse (const json & response);
+    void HandleNotification (const json & response);
+    void HandleLeaderboard (const json & response);
+    void HandleRetryAfter (const json & response, const PendingRequest & pending);
     void HandleError (const json & response);
+    void TrackSequence (const json & response);
 
     // UI callbacks
     std::function<void (const std::string &)> on_status_update;
     std::function<void (const json &)> on_question_received;
     std::function<void (const json &)> on_result_received;
+    std::function<void (const json &)> on_leaderboard_received;
     std::function<void (const std::string &)> on_error;
 
 public:
@@ -36,9 +95,11 @@ public:
 
     // Set callbacks
     void SetSendMessageCallback (std::function<void (const json &)> callback);
+    void SetScheduleCallback (std::function<void (long long, std::function<void ()>)> callback);
     void SetStatusUpdateCallback (std::function<void (const std::string &)> callback);
     void SetQuestionReceivedCallback (std::function<void (const json &)> callback);
     void SetResultReceivedCallback (std::function<void (const json &)> callback);
+    void SetLeaderboardReceivedCallback (std::function<void (const json &)> callback);
     void SetErrorCallback (std::function<void (const std::string &)> callback);
 
     // Command methods
@@ -47,17 +108,29 @@ public:
     void ContinueQuiz ();
     void EndQuiz ();
     void FetchQuestion (unsigned int question_id);
+    void FetchNextQuestion ();
+    void FetchQuestions (const std::vector<unsigned int> & question_ids);
     void FetchUnattemptedQuestions ();
     void SubmitAnswer (unsigned int question_id, const std::vector<int> & selected_options, long long time_to_attempt);
+    void SubmitAnswers (const std::vector<QueuedAnswer> & answers);
     void Logout ();
+    void FetchLeaderboard (size_t top = DEFAULT_LEADERBOARD_TOP);
+    void SubscribeLeaderboard (bool is_subscribe, size_t top = DEFAULT_LEADERBOARD_TOP);
 
     // Response processor
     void ProcessResponse (const json & response);
 
+    // Reconnect handling - PrepareResume before the connection state is dropped, ResumeAfterReconnect once reconnected
+    void PrepareResume ();
+    void ResumeAfterReconnect ();
+    bool IsResumePending () const;
+
     // Utility methods
     bool IsConnected () const;
     bool IsLoggedIn () const;
     bool IsQuizActive () const;
     std::string GetStatusString () const;
+    size_t GetPendingRequestCount () const;
+    void ClearPendingRequests ();
 };
 
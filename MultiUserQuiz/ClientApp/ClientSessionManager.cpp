@@ -1,5 +1,6 @@
 // ClientSessionManager.cpp
 #include "ClientSessionManager.hpp"
+#include <algorithm>
 
 std::unique_ptr<ClientSessionManager> ClientSessionManager::instance = nullptr;
 std::mutex ClientSessionManager::instance_mutex;
@@ -96,6 +97,167 @@ std::vector<unsigned int> ClientSessionManager::GetUnattemptedQuestions () const
     return unattempted_questions;
 }
 
+void ClientSessionManager::MarkQuestionAttempted (unsigned int qid)
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    unattempted_questions.erase (std::remove (unattempted_questions.begin (), unattempted_questions.end (), qid),
+                                 unattempted_questions.end ());
+}
+
+unsigned int ClientSessionManager::GetNextUnattemptedQuestion () const
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+
+    for (unsigned int qid : unattempted_questions) {
+        if (qid != current_question_id) {
+            return qid;
+        }
+    }
+    return 0;
+}
+
+void ClientSessionManager::SetPrefetchDepth (size_t depth)
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    prefetch_depth = depth;
+}
+
+size_t ClientSessionManager::GetPrefetchDepth () const
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    return prefetch_depth;
+}
+
+/*
+* Picks the next unattempted questions that are neither on screen, cached nor already being fetched,
+* so that cached + in flight never exceeds the prefetch depth. The picked ids are marked in flight.
+*/
+std::vector<unsigned int> ClientSessionManager::ReservePrefetchCandidates ()
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    std::vector<unsigned int> candidates;
+    size_t budget = prefetch_depth;
+
+    if (question_cache.size () + prefetch_in_flight.size () >= budget) {
+        return candidates;
+    }
+    budget -= question_cache.size () + prefetch_in_flight.size ();
+
+    for (unsigned int qid : unattempted_questions) {
+        if (candidates.size () >= budget) {
+            break;
+        }
+        if (qid == current_question_id || question_cache.count (qid) || prefetch_in_flight.count (qid)) {
+            continue;
+        }
+        candidates.push_back (qid);
+        prefetch_in_flight.insert (qid);
+    }
+    return candidates;
+}
+
+void ClientSessionManager::CacheQuestion (const json & question)
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    unsigned int qid = question.value ("id", 0u);
+
+    prefetch_in_flight.erase (qid);
+    if (qid == 0 || prefetch_depth == 0 || question_cache.count (qid)) {
+        return;
+    }
+
+    while (question_cache.size () >= prefetch_depth && !cache_order.empty ()) {
+        question_cache.erase (cache_order.front ());
+        cache_order.pop_front ();
+    }
+
+    question_cache[qid] = question;
+    cache_order.push_back (qid);
+}
+
+void ClientSessionManager::ReleasePrefetch (unsigned int qid)
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    prefetch_in_flight.erase (qid);
+}
+
+bool ClientSessionManager::TakeCachedQuestion (unsigned int qid, json & question)
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    auto it = question_cache.find (qid);
+    if (it == question_cache.end ()) {
+        return false;
+    }
+
+    question = std::move (it->second);
+    question_cache.erase (it);
+    cache_order.erase (std::remove (cache_order.begin (), cache_order.end (), qid), cache_order.end ());
+    return true;
+}
+
+void ClientSessionManager::ClearQuestionCache ()
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    question_cache.clear ();
+    cache_order.clear ();
+    prefetch_in_flight.clear ();
+}
+
+void ClientSessionManager::MarkQuestionDisplayed (long long wait_ms)
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    question_displayed_at = std::chrono::steady_clock::now ();
+
+    ++displayed_count;
+    total_display_wait_ms += wait_ms;
+    max_display_wait_ms = std::max (max_display_wait_ms, wait_ms);
+}
+
+long long ClientSessionManager::GetTimeSinceDisplayMs () const
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    if (question_displayed_at == std::chrono::steady_clock::time_point ()) {
+        return 0;       // nothing shown yet
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now () - question_displayed_at).count ();
+}
+
+/*
+* A prefetched question carries the timer the server computed when it was fetched.
+* Recompute it for the moment of display: bullet mode is a fixed time per question, time bound mode
+* is whatever is left of the total, strict mode counts down to the fixed end time.
+*/
+long long ClientSessionManager::ComputeQuestionTimer (long long server_timer) const
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+
+    switch (quiz_mode) {
+        case 1:     // TIME_BOUND_MODE
+            return std::max (0LL, total_time_limit - elapsed_time);
+        case 2:     // STRICT_TIME_BOUND_MODE
+        {
+            long long now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now ().time_since_epoch ()).count ();
+            return std::max (0LL, end_time - now_ms);
+        }
+        default:
+            return server_timer;
+    }
+}
+
+double ClientSessionManager::GetAverageDisplayWaitMs () const
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    return displayed_count ? static_cast<double>(total_display_wait_ms) / displayed_count : 0.0;
+}
+
+long long ClientSessionManager::GetMaxDisplayWaitMs () const
+{
+    std::lock_guard<std::mutex> lock (state_mutex);
+    return max_display_wait_ms;
+}
+
 // Getters implementation
 unsigned int ClientSessionManager::GetTotalQuestions () const
 {
@@ -158,4 +320,11 @@ void ClientSessionManager::Reset ()
     elapsed_time = 0;
     end_time = 0;
     current_score = 0.0;
+    question_cache.clear ();
+    cache_order.clear ();
+    prefetch_in_flight.clear ();
+    displayed_count = 0;
+    total_display_wait_ms = 0;
+    max_display_wait_ms = 0;
+    question_displayed_at = std::chrono::steady_clock::time_point ();
 }
\ No newline at end of file
@@ -3,11 +3,17 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <unordered_map>
+#include <unordered_set>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
+#define DEFAULT_PREFETCH_DEPTH      3       // questions kept ready ahead of the one on screen
+
 enum class ClientState {
     DISCONNECTED,
     CONNECTED,
@@ -39,7 +45,20 @@ private:
     bool is_multioption_allowed;
     bool is_kbc_mode;
 
-    ClientSessionManager () : current_state (ClientState::DISCONNECTED), is_reconnection (false)
+    // Prefetched questions, bounded to prefetch_depth entries and evicted oldest first
+    size_t prefetch_depth;
+    std::unordered_map<unsigned int, json> question_cache;
+    std::deque<unsigned int> cache_order;
+    std::unordered_set<unsigned int> prefetch_in_flight;
+
+    // Per question timing - the clock for a question starts when it is shown, not when it is fetched
+    std::chrono::steady_clock::time_point question_displayed_at;
+    long long displayed_count;
+    long long total_display_wait_ms;
+    long long max_display_wait_ms;
+
+    ClientSessionManager () : current_state (ClientState::DISCONNECTED), is_reconnection (false),
+        prefetch_depth (DEFAULT_PREFETCH_DEPTH), displayed_count (0), total_display_wait_ms (0), max_display_wait_ms (0)
     { }
 
 public:
@@ -63,6 +82,24 @@ public:
     unsigned int GetCurrentQuestion () const;
     void UpdateUnattemptedQuestions (const std::vector<unsigned int> & questions);
     std::vector<unsigned int> GetUnattemptedQuestions () const;
+    void MarkQuestionAttempted (unsigned int qid);
+    unsigned int GetNextUnattemptedQuestion () const;
+
+    // Prefetch cache
+    void SetPrefetchDepth (size_t depth);
+    size_t GetPrefetchDepth () const;
+    std::vector<unsigned int> ReservePrefetchCandidates ();
+    void CacheQuestion (const json & question);
+    void ReleasePrefetch (unsigned int qid);
+    bool TakeCachedQuestion (unsigned int qid, json & question);
+    void ClearQuestionCache ();
+
+    // Display timing
+    void MarkQuestionDisplayed (long long wait_ms);
+    long long GetTimeSinceDisplayMs () const;
+    long long ComputeQuestionTimer (long long server_timer) const;
+    double GetAverageDisplayWaitMs () const;
+    long long GetMaxDisplayWaitMs () const;
 
     // Getters for quiz info
     unsigned int GetTotalQuestions () const;
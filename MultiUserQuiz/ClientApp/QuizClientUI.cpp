@@ -9,7 +9,8 @@
 
 QuizClientUI::QuizClientUI ()
     : connection_mgr (std::make_unique<ClientConnectionManager> ()),
-    is_running (false)
+    is_running (false),
+    is_leaderboard_live (false)
 {
 
     // Set up callbacks
@@ -27,6 +28,10 @@ QuizClientUI::QuizClientUI ()
         OnResultReceived (result);
                                           });
 
+    controller.SetLeaderboardReceivedCallback ([this] (const json & leaderboard) {
+        OnLeaderboardReceived (leaderboard);
+                                               });
+
     controller.SetErrorCallback ([this] (const std::string & error) {
         OnError (error);
                                  });
@@ -154,12 +159,16 @@ void QuizClientUI::ShowQuizMenu ()
     std::cout << "3. Submit Answer for Current Question" << std::endl;
     std::cout << "4. End Quiz" << std::endl;
     std::cout << "5. Logout" << std::endl;
+    std::cout << "6. Next Question" << std::endl;
+    std::cout << "7. Leaderboard" << std::endl;
+    std::cout << (is_leaderboard_live ? "8. Stop Live Leaderboard" : "8. Live Leaderboard") << std::endl;
 
     std::cout << "\nQuiz Info:" << std::endl;
     std::cout << "Total Questions: " << session.GetTotalQuestions () << std::endl;
     std::cout << "Current Score: " << session.GetCurrentScore () << std::endl;
     std::cout << "Elapsed Time: " << session.GetElapsedTime () << "ms" << std::endl;
     std::cout << "Unattempted Questions: " << session.GetUnattemptedQuestions ().size () << std::endl;
+    std::cout << "Question Wait (avg/max): " << session.GetAverageDisplayWaitMs () << "/" << session.GetMaxDisplayWaitMs () << "ms" << std::endl;
 
     int choice = GetIntInput ("Enter choice: ");
 
@@ -184,7 +193,8 @@ void QuizClientUI::ShowQuizMenu ()
             std::cout << "Enter selected options (space-separated, 0-based indexing): ";
             std::vector<int> options = GetMultipleChoiceInput (10); // Assume max 10 options
 
-            long long time_taken = GetIntInput ("Enter time taken (ms): ");
+            // measured from when the question was shown, a prefetched question is not charged for its fetch
+            long long time_taken = session.GetTimeSinceDisplayMs ();
 
             controller.SubmitAnswer (qid, options, time_taken);
             break;
@@ -195,6 +205,16 @@ void QuizClientUI::ShowQuizMenu ()
         case 5:
             controller.Logout ();
             break;
+        case 6:
+            controller.FetchNextQuestion ();
+            break;
+        case 7:
+            controller.FetchLeaderboard ();
+            break;
+        case 8:
+            is_leaderboard_live = !is_leaderboard_live;
+            controller.SubscribeLeaderboard (is_leaderboard_live);
+            break;
         default:
             std::cout << "Invalid choice!" << std::endl;
             break;
@@ -277,6 +297,22 @@ void QuizClientUI::ShowResult (const json & result)
     std::cout << "====================" << std::endl;
 }
 
+void QuizClientUI::ShowLeaderboard (const json & leaderboard)
+{
+    std::cout << "\n=== LEADERBOARD ===" << std::endl;
+
+    for (const json & entry : leaderboard.value ("top", json::array ())) {
+        std::cout << "  " << entry.value ("rank", 0u) << ". " << entry.value ("username", "")
+            << "  " << entry.value ("score", 0.0) << " pts  " << entry.value ("elapsed_time", 0LL) << "ms" << std::endl;
+    }
+
+    if (leaderboard.value ("rank", 0u) != 0) {
+        std::cout << "Your Rank: " << leaderboard["rank"] << " of " << leaderboard.value ("total", 0u) << std::endl;
+    }
+
+    std::cout << "===================" << std::endl;
+}
+
 std::string QuizClientUI::GetStringInput (const std::string & prompt)
 {
     std::cout << prompt;
@@ -343,6 +379,11 @@ void QuizClientUI::OnResultReceived (const json & result)
     ShowResult (result);
 }
 
+void QuizClientUI::OnLeaderboardReceived (const json & leaderboard)
+{
+    ShowLeaderboard (leaderboard);
+}
+
 void QuizClientUI::OnError (const std::string & error)
 {
     std::cout << "[ERROR] " << error << std::endl;
@@ -9,12 +9,14 @@ class QuizClientUI {
     private:
     std::unique_ptr<ClientConnectionManager> connection_mgr;
     bool is_running;
+    bool is_leaderboard_live;
 
     // UI helper methods
     void ShowMainMenu ();
     void ShowQuizMenu ();
     void ShowQuestion (const json & question);
     void ShowResult (const json & result);
+    void ShowLeaderboard (const json & leaderboard);
     void HandleUserInput ();
 
     // Input helpers
@@ -26,6 +28,7 @@ class QuizClientUI {
     void OnStatusUpdate (const std::string & status);
     void OnQuestionReceived (const json & question);
     void OnResultReceived (const json & result);
+    void OnLeaderboardReceived (const json & leaderboard);
     void OnError (const std::string & error);
 
     public:
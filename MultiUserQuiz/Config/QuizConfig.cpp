@@ -64,6 +64,14 @@ int QuizConfig::Parser (void * user, const char * section, const char * name, co
 {
     QuizConfig * self = static_cast<QuizConfig *>(user);
 
+    if (strcmp (section, "Logging") == 0) {
+        return LoggingParser (self, name, value);
+    }
+
+    if (strcmp (section, "Server") == 0) {
+        return ServerParser (self, name, value);
+    }
+
     if (strcmp (section, "Quiz") != 0) {
         std::cerr << "Unknown section: " << section << "\n";
         return 0;
@@ -137,6 +145,18 @@ int QuizConfig::Parser (void * user, const char * section, const char * name, co
             return 0;
         }
 
+    } else if (key == "ShuffleQuestions") {
+        if (!ParseBool (valStr, self->vIsShuffleQuestions)) {
+            std::cerr << "Invalid ShuffleQuestions value: " << valStr << "\n";
+            return 0;
+        }
+
+    } else if (key == "ShuffleOptions") {
+        if (!ParseBool (valStr, self->vIsShuffleOptions)) {
+            std::cerr << "Invalid ShuffleOptions value: " << valStr << "\n";
+            return 0;
+        }
+
     } else {
         std::cerr << "Unknown key: " << name << " in section: " << section << "\n";
         return 0;
@@ -145,6 +165,176 @@ int QuizConfig::Parser (void * user, const char * section, const char * name, co
     return 1; // Success
 }
 
+int QuizConfig::LoggingParser (QuizConfig * self, const std::string & key, const std::string & valStr)
+{
+    if (key == "LogLevel") {
+        if (!Logger::ParseLevel (valStr, self->vLogLevel)) {
+            std::cerr << "Invalid LogLevel value: " << valStr << "\n";
+            return 0;
+        }
+
+    } else if (key == "LogFormat") {
+        if (!Logger::ParseFormat (valStr, self->vLogFormat)) {
+            std::cerr << "Invalid LogFormat value: " << valStr << "\n";
+            return 0;
+        }
+
+    } else if (key == "LogFile") {
+        self->vLogFile = valStr;
+
+    } else {
+        std::cerr << "Unknown key: " << key << " in section: Logging\n";
+        return 0;
+    }
+
+    return 1;
+}
+
+int QuizConfig::ServerParser (QuizConfig * self, const std::string & key, const std::string & valStr)
+{
+    if (key == "EnableCompression") {
+        if (!ParseBool (valStr, self->vIsCompressionEnabled)) {
+            std::cerr << "Invalid EnableCompression value: " << valStr << "\n";
+            return 0;
+        }
+
+    } else if (key == "CompressionThreshold") {
+        long long bytes;
+        if (!ParseNumber (valStr, bytes) || bytes < 0) {
+            std::cerr << "Invalid CompressionThreshold. Must be >= 0 bytes. Got: " << valStr << "\n";
+            return 0;
+        }
+        self->vCompressionThreshold = static_cast<size_t>(bytes);
+
+    } else if (key == "SendBufferBytes" || key == "SendQueueBytes") {
+        long long bytes;
+        if (!ParseNumber (valStr, bytes) || bytes <= 0) {
+            std::cerr << "Invalid " << key << ". Must be > 0 bytes. Got: " << valStr << "\n";
+            return 0;
+        }
+        (key == "SendBufferBytes" ? self->vSendBufferBytes : self->vSendQueueBytes) = static_cast<size_t>(bytes);
+
+    } else if (key == "HandshakeRate" || key == "HandshakeBurst" || key == "LoginRate" || key == "LoginBurst") {
+        double val;
+        if (!ParseNumber (valStr, val) || val < 0) {
+            std::cerr << "Invalid " << key << ". Must be >= 0. Got: " << valStr << "\n";
+            return 0;
+        }
+
+        if (key == "HandshakeRate") {
+            self->vHandshakeRate = val;
+        } else if (key == "HandshakeBurst") {
+            self->vHandshakeBurst = val;
+        } else if (key == "LoginRate") {
+            self->vLoginRate = val;
+        } else {
+            self->vLoginBurst = val;
+        }
+
+    } else if (key == "HandoffSocket") {
+        self->vHandoffSocket = valStr;
+
+    } else if (key == "StateFile") {
+        if (valStr.empty ()) {
+            std::cerr << "StateFile must not be empty\n";
+            return 0;
+        }
+        self->vStateFile = valStr;
+
+    } else if (key == "ResumeTokenTtlSec") {
+        if (!ParseNumber (valStr, self->vResumeTokenTtlSec) || self->vResumeTokenTtlSec <= 0) {
+            std::cerr << "Invalid ResumeTokenTtlSec. Must be > 0. Got: " << valStr << "\n";
+            return 0;
+        }
+
+    } else if (key == "LeaderboardPushIntervalMs") {
+        if (!ParseNumber (valStr, self->vLeaderboardPushIntervalMs) || self->vLeaderboardPushIntervalMs <= 0) {
+            std::cerr << "Invalid LeaderboardPushIntervalMs. Must be > 0. Got: " << valStr << "\n";
+            return 0;
+        }
+
+    } else if (key == "AdminUser") {
+        self->vAdminUser = valStr;
+
+    } else if (key == "AnalyticsFile") {
+        if (valStr.empty ()) {
+            std::cerr << "AnalyticsFile must not be empty\n";
+            return 0;
+        }
+        self->vAnalyticsFile = valStr;
+
+    } else if (key == "ResultsFile") {
+        if (valStr.empty ()) {
+            std::cerr << "ResultsFile must not be empty\n";
+            return 0;
+        }
+        self->vResultsFile = valStr;
+
+    } else if (key == "QuestionBankFile") {
+        if (valStr.empty ()) {
+            std::cerr << "QuestionBankFile must not be empty\n";
+            return 0;
+        }
+        self->vQuestionBankFile = valStr;
+
+    } else if (key == "BankWatchIntervalMs") {
+        if (!ParseNumber (valStr, self->vBankWatchIntervalMs) || self->vBankWatchIntervalMs < 0) {
+            std::cerr << "Invalid BankWatchIntervalMs. Must be >= 0. Got: " << valStr << "\n";
+            return 0;
+        }
+
+    } else if (key == "ReactorShards") {
+        if (!ParseNumber (valStr, self->vReactorShards) || self->vReactorShards < 0) {
+            std::cerr << "Invalid ReactorShards. Must be >= 0. Got: " << valStr << "\n";
+            return 0;
+        }
+
+    } else if (key == "CredentialFile") {
+        self->vCredentialFile = valStr;
+
+    } else if (key == "HashThreads" || key == "HashQueueLimit" || key == "CredentialCacheTtlSec") {
+        long long val;
+        if (!ParseNumber (valStr, val) || val < 0) {
+            std::cerr << "Invalid " << key << ". Must be >= 0. Got: " << valStr << "\n";
+            return 0;
+        }
+        if (key == "HashThreads") {
+            self->vHashThreads = static_cast<int>(val);
+        } else if (key == "HashQueueLimit") {
+            self->vHashQueueLimit = static_cast<size_t>(val);
+        } else {
+            self->vCredentialCacheTtlSec = val;
+        }
+
+    } else if (key == "RosterFile") {
+        self->vRosterFile = valStr;
+
+    } else if (key == "ArchiveFile") {
+        self->vArchiveFile = valStr;
+
+    } else if (key == "AnswerJournalFile") {
+        self->vAnswerJournalFile = valStr;
+
+    } else if (key == "KernelTls") {
+        if (!ParseBool (valStr, self->vIsKernelTlsEnabled)) {
+            std::cerr << "Invalid KernelTls value: " << valStr << "\n";
+            return 0;
+        }
+
+    } else if (key == "SlowConsumerTimeoutMs") {
+        if (!ParseNumber (valStr, self->vSlowConsumerTimeoutMs) || self->vSlowConsumerTimeoutMs <= 0) {
+            std::cerr << "Invalid SlowConsumerTimeoutMs. Must be > 0. Got: " << valStr << "\n";
+            return 0;
+        }
+
+    } else {
+        std::cerr << "Unknown key: " << key << " in section: Server\n";
+        return 0;
+    }
+
+    return 1;
+}
+
 QuizConfig & QuizConfig::GetInstance ()
 {
     static QuizConfig instance;
@@ -164,6 +354,33 @@ QuizConfig::QuizConfig ()
 
     vTimeAllowed.vTimePerQues = 15 * 1000;          // 15 seconds
     vIsKBCMode = false;
+    vIsShuffleQuestions = false;
+    vIsShuffleOptions = false;
+
+    vLogLevel = LOG_LEVEL_INFO;
+    vLogFormat = LOG_FORMAT_TEXT;
+
+    vIsCompressionEnabled = true;
+    vCompressionThreshold = DEFAULT_COMPRESSION_THRESHOLD;
+    vSendBufferBytes = DEFAULT_SEND_BUFFER_BYTES;
+    vSendQueueBytes = DEFAULT_SEND_QUEUE_BYTES;
+    vSlowConsumerTimeoutMs = DEFAULT_SLOW_CONSUMER_TIMEOUT_MS;
+    vHandshakeRate = vHandshakeBurst = DEFAULT_HANDSHAKE_RATE;
+    vLoginRate = vLoginBurst = DEFAULT_LOGIN_RATE;
+    vHandoffSocket = "quiz_handoff.sock";
+    vStateFile = "quiz_state.json";
+    vResumeTokenTtlSec = DEFAULT_RESUME_TOKEN_TTL_SEC;
+    vLeaderboardPushIntervalMs = DEFAULT_LEADERBOARD_PUSH_INTERVAL_MS;
+    vAnalyticsFile = DEFAULT_ANALYTICS_FILE;
+    vResultsFile = DEFAULT_RESULTS_FILE;
+    vArchiveFile = DEFAULT_ARCHIVE_FILE;
+    vQuestionBankFile = DEFAULT_QUESTION_BANK_FILE;
+    vBankWatchIntervalMs = DEFAULT_BANK_WATCH_INTERVAL_MS;
+    vIsKernelTlsEnabled = false;
+    vReactorShards = DEFAULT_REACTOR_SHARDS;
+    vHashThreads = DEFAULT_HASH_THREADS;
+    vHashQueueLimit = DEFAULT_HASH_QUEUE_LIMIT;
+    vCredentialCacheTtlSec = DEFAULT_CREDENTIAL_CACHE_TTL_SEC;
 }
 
 QuizConfig::~QuizConfig ()
@@ -217,6 +434,16 @@ bool QuizConfig::IsKBCMode () const
     return vIsKBCMode;
 }
 
+bool QuizConfig::IsShuffleQuestions () const
+{
+    return vIsShuffleQuestions;
+}
+
+bool QuizConfig::IsShuffleOptions () const
+{
+    return vIsShuffleOptions;
+}
+
 bool QuizConfig::IsMultiOptionSelect () const
 {
     return vIsMultiOptionSelect;
@@ -225,4 +452,154 @@ bool QuizConfig::IsMultiOptionSelect () const
 eQuizMode QuizConfig::GetQuizMode () const
 {
     return vQuizMode;
+}
+
+eLogLevel QuizConfig::GetLogLevel () const
+{
+    return vLogLevel;
+}
+
+eLogFormat QuizConfig::GetLogFormat () const
+{
+    return vLogFormat;
+}
+
+std::string QuizConfig::GetLogFile () const
+{
+    return vLogFile;
+}
+
+bool QuizConfig::IsCompressionEnabled () const
+{
+    return vIsCompressionEnabled;
+}
+
+size_t QuizConfig::GetCompressionThreshold () const
+{
+    return vCompressionThreshold;
+}
+
+size_t QuizConfig::GetSendBufferBytes () const
+{
+    return vSendBufferBytes;
+}
+
+size_t QuizConfig::GetSendQueueBytes () const
+{
+    return vSendQueueBytes;
+}
+
+long long QuizConfig::GetSlowConsumerTimeoutMs () const
+{
+    return vSlowConsumerTimeoutMs;
+}
+
+double QuizConfig::GetHandshakeRate () const
+{
+    return vHandshakeRate;
+}
+
+double QuizConfig::GetHandshakeBurst () const
+{
+    return vHandshakeBurst;
+}
+
+double QuizConfig::GetLoginRate () const
+{
+    return vLoginRate;
+}
+
+double QuizConfig::GetLoginBurst () const
+{
+    return vLoginBurst;
+}
+
+std::string QuizConfig::GetHandoffSocket () const
+{
+    return vHandoffSocket;
+}
+
+std::string QuizConfig::GetStateFile () const
+{
+    return vStateFile;
+}
+
+long long QuizConfig::GetResumeTokenTtlSec () const
+{
+    return vResumeTokenTtlSec;
+}
+
+long long QuizConfig::GetLeaderboardPushIntervalMs () const
+{
+    return vLeaderboardPushIntervalMs;
+}
+
+std::string QuizConfig::GetAdminUser () const
+{
+    return vAdminUser;
+}
+
+std::string QuizConfig::GetAnalyticsFile () const
+{
+    return vAnalyticsFile;
+}
+
+std::string QuizConfig::GetResultsFile () const
+{
+    return vResultsFile;
+}
+
+std::string QuizConfig::GetQuestionBankFile () const
+{
+    return vQuestionBankFile;
+}
+
+long long QuizConfig::GetBankWatchIntervalMs () const
+{
+    return vBankWatchIntervalMs;
+}
+
+bool QuizConfig::IsKernelTlsEnabled () const
+{
+    return vIsKernelTlsEnabled;
+}
+
+int QuizConfig::GetReactorShards () const
+{
+    return vReactorShards;
+}
+
+std::string QuizConfig::GetAnswerJournalFile () const
+{
+    return vAnswerJournalFile;
+}
+
+std::string QuizConfig::GetCredentialFile () const
+{
+    return vCredentialFile;
+}
+
+int QuizConfig::GetHashThreads () const
+{
+    return vHashThreads;
+}
+
+size_t QuizConfig::GetHashQueueLimit () const
+{
+    return vHashQueueLimit;
+}
+
+long long QuizConfig::GetCredentialCacheTtlSec () const
+{
+    return vCredentialCacheTtlSec;
+}
+
+std::string QuizConfig::GetRosterFile () const
+{
+    return vRosterFile;
+}
+
+std::string QuizConfig::GetArchiveFile () const
+{
+    return vArchiveFile;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include "../QuizDefs.h"
+#include "../Logger/Logger.h"
 
 using namespace std;
 
@@ -29,6 +30,42 @@ public:
             bool                IsMultiOptionSelect () const;
             eQuizMode           GetQuizMode () const;
             bool                IsKBCMode () const;
+            bool                IsShuffleQuestions () const;
+            bool                IsShuffleOptions () const;
+
+            // logging related
+            eLogLevel           GetLogLevel () const;
+            eLogFormat          GetLogFormat () const;
+            std::string         GetLogFile () const;
+
+            // network related
+            bool                IsCompressionEnabled () const;
+            size_t              GetCompressionThreshold () const;
+            size_t              GetSendBufferBytes () const;
+            size_t              GetSendQueueBytes () const;
+            long long           GetSlowConsumerTimeoutMs () const;
+            double              GetHandshakeRate () const;
+            double              GetHandshakeBurst () const;
+            double              GetLoginRate () const;
+            double              GetLoginBurst () const;
+            std::string         GetHandoffSocket () const;
+            std::string         GetStateFile () const;
+            long long           GetResumeTokenTtlSec () const;
+            long long           GetLeaderboardPushIntervalMs () const;
+            std::string         GetAdminUser () const;
+            std::string         GetAnalyticsFile () const;
+            std::string         GetResultsFile () const;
+            std::string         GetQuestionBankFile () const;
+            long long           GetBankWatchIntervalMs () const;
+            bool                IsKernelTlsEnabled () const;
+            int                 GetReactorShards () const;
+            std::string         GetAnswerJournalFile () const;
+            std::string         GetCredentialFile () const;
+            int                 GetHashThreads () const;
+            size_t              GetHashQueueLimit () const;
+            long long           GetCredentialCacheTtlSec () const;
+            std::string         GetRosterFile () const;
+            std::string         GetArchiveFile () const;
 
 private:
                                 // Ctor and Dtors
@@ -39,6 +76,8 @@ private:
                                 QuizConfig & operator=  (const QuizConfig &) = delete;
 
     static  int                 Parser                  (void * user, const char * section, const char * name, const char * value);
+    static  int                 LoggingParser           (QuizConfig * self, const std::string & key, const std::string & valStr);
+    static  int                 ServerParser            (QuizConfig * self, const std::string & key, const std::string & valStr);
 
             // config variables.
             eQuizMode           vQuizMode;
@@ -60,4 +99,42 @@ private:
             // result related
             bool                vIsKBCMode;             // In KBC mode it will show the correct answer and score after each question.
                                                         // KBC Mode should not be allowed with TIMERBOUND quiz
+
+            // anti cheating - every user gets its own question / option order, see QuestionShuffle
+            bool                vIsShuffleQuestions;
+            bool                vIsShuffleOptions;
+
+            // logging related - [Logging] section
+            eLogLevel           vLogLevel;
+            eLogFormat          vLogFormat;
+            std::string         vLogFile;               // empty means stdout
+
+            // network related - [Server] section
+            bool                vIsCompressionEnabled;  // deflate payloads when the peer negotiated permessage-deflate
+            size_t              vCompressionThreshold;  // payloads below this many bytes go out uncompressed
+            size_t              vSendBufferBytes;       // in flight bytes per connection before messages are queued
+            size_t              vSendQueueBytes;        // queued bytes per connection before it is evicted
+            long long           vSlowConsumerTimeoutMs; // max time a connection may keep a non empty queue
+            double              vHandshakeRate;         // admission control - per second, 0 = unlimited
+            double              vHandshakeBurst;
+            double              vLoginRate;
+            double              vLoginBurst;
+            std::string         vHandoffSocket;         // unix socket a restarted server uses to take over from the running one
+            std::string         vStateFile;             // users are persisted here during the handover
+            long long           vResumeTokenTtlSec;     // lifetime of the resume token handed out with LOGIN_OK
+            long long           vLeaderboardPushIntervalMs; // subscribers get at most one leaderboard snapshot per interval
+            std::string         vAdminUser;             // may run the admin queries (ITEM_STATS), empty = nobody
+            std::string         vAnalyticsFile;         // item analytics csv written when the quiz ends, one per exam (<name>_<exam id>.csv)
+            std::string         vResultsFile;           // columnar export of every user's result, see ResultExporter - one per exam like the csv
+            std::string         vQuestionBankFile;      // loaded at startup and by RELOAD_BANK
+            long long           vBankWatchIntervalMs;   // > 0 reloads the bank when the file changes, see BankReloader
+            bool                vIsKernelTlsEnabled;    // hand record crypto to the kernel after the handshake, where supported
+            std::string         vAnswerJournalFile;     // accepted answers are synced here before they are acknowledged, empty = off
+            std::string         vCredentialFile;        // scrypt hashed passwords for LOGIN, empty = the built in test password
+            int                 vHashThreads;           // threads checking passwords, see CredentialStore
+            size_t              vHashQueueLimit;
+            long long           vCredentialCacheTtlSec; // a verified login is remembered this long, 0 = always hash
+            std::string         vRosterFile;            // candidates whose users are built before the exam starts, empty = none
+            std::string         vArchiveFile;           // finished users are moved here after an export, empty = kept in memory
+            int                 vReactorShards;         // event loops listening on the port side by side, see ConnectionManager
 };
\ No newline at end of file
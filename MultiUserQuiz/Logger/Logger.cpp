@@ -0,0 +1,380 @@
+// Logger.cpp
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstring>
+#include <ctime>
+
+static_assert ((LOG_RING_CAPACITY & (LOG_RING_CAPACITY - 1)) == 0, "LOG_RING_CAPACITY must be a power of 2");
+
+namespace {
+
+    const char * LevelName (unsigned char level)
+    {
+        switch (level) {
+            case LOG_LEVEL_TRACE: return "TRACE";
+            case LOG_LEVEL_DEBUG: return "DEBUG";
+            case LOG_LEVEL_INFO:  return "INFO";
+            case LOG_LEVEL_WARN:  return "WARN";
+            case LOG_LEVEL_ERROR: return "ERROR";
+            default:              return "OFF";
+        }
+    }
+
+    long long NowInUs ()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now ().time_since_epoch ())
+            .count ();
+    }
+
+    void AppendJsonEscaped (std::string & buffer, const char * str, size_t len)
+    {
+        for (size_t i = 0; i < len; ++i) {
+            char ch = str[i];
+            switch (ch) {
+                case '"':  buffer += "\\\""; break;
+                case '\\': buffer += "\\\\"; break;
+                case '\n': buffer += "\\n"; break;
+                case '\r': buffer += "\\r"; break;
+                case '\t': buffer += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(ch) < 0x20) {
+                        char esc[8];
+                        snprintf (esc, sizeof (esc), "\\u%04x", ch);
+                        buffer += esc;
+                    } else {
+                        buffer += ch;
+                    }
+                    break;
+            }
+        }
+    }
+
+} // anonymous namespace
+
+// ---------------- LogRing ----------------
+
+Logger::LogRecord * Logger::LogRing::BeginWrite ()
+{
+    unsigned long long h = head.load (std::memory_order_relaxed);
+    unsigned long long t = tail.load (std::memory_order_acquire);
+
+    if (h - t >= LOG_RING_CAPACITY) {
+        // flusher is behind - drop rather than wait
+        dropped.fetch_add (1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &slots[h & (LOG_RING_CAPACITY - 1)];
+}
+
+void Logger::LogRing::CommitWrite ()
+{
+    head.store (head.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename Fn>
+void Logger::LogRing::Drain (Fn && fn)
+{
+    unsigned long long t = tail.load (std::memory_order_relaxed);
+    unsigned long long h = head.load (std::memory_order_acquire);
+
+    while (t != h) {
+        fn (slots[t & (LOG_RING_CAPACITY - 1)]);
+        ++t;
+    }
+    tail.store (t, std::memory_order_release);
+}
+
+unsigned long long Logger::LogRing::TakeDropped ()
+{
+    return dropped.exchange (0, std::memory_order_relaxed);
+}
+
+// ---------------- Logger ----------------
+
+Logger & Logger::GetInstance ()
+{
+    static Logger instance;
+    return instance;
+}
+
+Logger::Logger ()
+    : min_level (LOG_LEVEL_INFO),
+    output_format (LOG_FORMAT_TEXT),
+    output (stdout),
+    owns_output (false),
+    is_running (true)
+{
+    flusher_thread = std::thread (&Logger::FlushLoop, this);
+}
+
+Logger::~Logger ()
+{
+    Stop ();
+
+    if (owns_output && output) {
+        fclose (output);
+    }
+}
+
+void Logger::Stop ()
+{
+    {
+        std::lock_guard<std::mutex> lock (flusher_mutex);
+        if (!is_running.exchange (false)) {
+            return;
+        }
+    }
+    flusher_cv.notify_one ();
+
+    if (flusher_thread.joinable ()) {
+        flusher_thread.join ();
+    }
+
+    // pick up whatever was logged while the flusher was shutting down
+    Flush ();
+}
+
+void Logger::SetLevel (eLogLevel level)
+{
+    min_level.store (level, std::memory_order_relaxed);
+}
+
+eLogLevel Logger::GetLevel () const
+{
+    return static_cast<eLogLevel>(min_level.load (std::memory_order_relaxed));
+}
+
+void Logger::SetFormat (eLogFormat format)
+{
+    output_format.store (format, std::memory_order_relaxed);
+}
+
+bool Logger::SetOutputFile (const std::string & path)
+{
+    FILE * new_output = stdout;
+    bool is_owned = false;
+
+    if (!path.empty ()) {
+        bool is_binary = output_format.load (std::memory_order_relaxed) == LOG_FORMAT_BINARY;
+        new_output = fopen (path.c_str (), is_binary ? "ab" : "a");
+        if (!new_output) {
+            return false;
+        }
+        is_owned = true;
+    }
+
+    std::lock_guard<std::mutex> lock (output_mutex);
+    if (owns_output && output) {
+        fflush (output);
+        fclose (output);
+    }
+    output = new_output;
+    owns_output = is_owned;
+    return true;
+}
+
+Logger::LogRing & Logger::GetThreadRing ()
+{
+    thread_local std::shared_ptr<LogRing> ring;
+
+    if (!ring) {
+        std::lock_guard<std::mutex> lock (rings_mutex);
+        ring = std::make_shared<LogRing> (static_cast<unsigned int>(rings.size ()));
+        rings.push_back (ring);
+    }
+    return *ring;
+}
+
+void Logger::Log (eLogLevel level, const char * component, const char * fmt, ...)
+{
+    LogRing & ring = GetThreadRing ();
+    LogRecord * rec = ring.BeginWrite ();
+    if (!rec) {
+        return;
+    }
+
+    va_list args;
+    va_start (args, fmt);
+    int written = vsnprintf (rec->message, LOG_MESSAGE_CAPACITY, fmt, args);
+    va_end (args);
+
+    if (written < 0) {
+        written = 0;
+    }
+
+    rec->timestamp_us = NowInUs ();
+    rec->component = component;
+    rec->thread_index = ring.GetThreadIndex ();
+    rec->level = static_cast<unsigned char>(level);
+    rec->length = static_cast<unsigned short>(std::min (written, LOG_MESSAGE_CAPACITY - 1));
+
+    ring.CommitWrite ();
+}
+
+void Logger::FlushLoop ()
+{
+    while (is_running.load ()) {
+        {
+            std::unique_lock<std::mutex> lock (flusher_mutex);
+            flusher_cv.wait_for (lock, std::chrono::milliseconds (LOG_FLUSH_INTERVAL_MS),
+                                 [this] () { return !is_running.load (); });
+        }
+        Flush ();
+    }
+}
+
+size_t Logger::DrainAll (std::string & buffer)
+{
+    std::vector<std::shared_ptr<LogRing>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock (rings_mutex);
+        snapshot = rings;
+    }
+
+    eLogFormat format = static_cast<eLogFormat>(output_format.load (std::memory_order_relaxed));
+    size_t count = 0;
+
+    for (auto & ring : snapshot) {
+        ring->Drain ([&] (const LogRecord & rec) {
+            switch (format) {
+                case LOG_FORMAT_JSON:   FormatJson (buffer, rec); break;
+                case LOG_FORMAT_BINARY: WriteBinary (buffer, rec); break;
+                default:                FormatText (buffer, rec); break;
+            }
+            ++count;
+        });
+
+        unsigned long long dropped = ring->TakeDropped ();
+        if (dropped > 0 && format != LOG_FORMAT_BINARY) {
+            char line[96];
+            snprintf (line, sizeof (line), "[logger] thread %u dropped %llu records\n", ring->GetThreadIndex (), dropped);
+            buffer += line;
+        }
+    }
+    return count;
+}
+
+void Logger::Flush ()
+{
+    // the rings have a single consumer, so draining is serialized on the output lock
+    std::lock_guard<std::mutex> lock (output_mutex);
+    static std::string buffer;
+    buffer.clear ();
+
+    DrainAll (buffer);
+    if (buffer.empty ()) {
+        return;
+    }
+
+    fwrite (buffer.data (), 1, buffer.size (), output);
+    fflush (output);
+}
+
+void Logger::FormatText (std::string & buffer, const LogRecord & rec) const
+{
+    // 2026-01-31 13:45:10.123456 [INFO ] [T2] [ConnectionManager] message
+    time_t secs = static_cast<time_t>(rec.timestamp_us / 1000000);
+    std::tm tm_buf {};
+#ifdef _WIN32
+    localtime_s (&tm_buf, &secs);
+#else
+    localtime_r (&secs, &tm_buf);
+#endif
+
+    char prefix[96];
+    size_t len = strftime (prefix, sizeof (prefix), "%Y-%m-%d %H:%M:%S", &tm_buf);
+    snprintf (prefix + len, sizeof (prefix) - len, ".%06lld [%-5s] [T%u] ",
+              rec.timestamp_us % 1000000, LevelName (rec.level), rec.thread_index);
+
+    buffer += prefix;
+    if (rec.component) {
+        buffer += '[';
+        buffer += rec.component;
+        buffer += "] ";
+    }
+    buffer.append (rec.message, rec.length);
+    buffer += '\n';
+}
+
+void Logger::FormatJson (std::string & buffer, const LogRecord & rec) const
+{
+    char prefix[96];
+    snprintf (prefix, sizeof (prefix), "{\"ts_us\":%lld,\"level\":\"%s\",\"thread\":%u,\"component\":\"",
+              rec.timestamp_us, LevelName (rec.level), rec.thread_index);
+
+    buffer += prefix;
+    if (rec.component) {
+        AppendJsonEscaped (buffer, rec.component, strlen (rec.component));
+    }
+    buffer += "\",\"msg\":\"";
+    AppendJsonEscaped (buffer, rec.message, rec.length);
+    buffer += "\"}\n";
+}
+
+/*
+* Binary layout per record (little endian, native sizes):
+*   int64   timestamp in micro seconds since epoch
+*   uint32  thread index
+*   uint8   level
+*   uint8   component length (N)
+*   uint16  message length (M)
+*   N bytes component, M bytes message
+*/
+void Logger::WriteBinary (std::string & buffer, const LogRecord & rec) const
+{
+    size_t comp_len = rec.component ? std::min<size_t> (strlen (rec.component), 255) : 0;
+    unsigned char comp_len8 = static_cast<unsigned char>(comp_len);
+
+    buffer.append (reinterpret_cast<const char *>(&rec.timestamp_us), sizeof (rec.timestamp_us));
+    buffer.append (reinterpret_cast<const char *>(&rec.thread_index), sizeof (rec.thread_index));
+    buffer.append (reinterpret_cast<const char *>(&rec.level), sizeof (rec.level));
+    buffer.append (reinterpret_cast<const char *>(&comp_len8), sizeof (comp_len8));
+    buffer.append (reinterpret_cast<const char *>(&rec.length), sizeof (rec.length));
+    if (comp_len) {
+        buffer.append (rec.component, comp_len);
+    }
+    buffer.append (rec.message, rec.length);
+}
+
+bool Logger::ParseLevel (const std::string & value, eLogLevel & level)
+{
+    std::string val = value;
+    std::transform (val.begin (), val.end (), val.begin (), ::toupper);
+
+    if (val == "TRACE") {
+        level = LOG_LEVEL_TRACE;
+    } else if (val == "DEBUG") {
+        level = LOG_LEVEL_DEBUG;
+    } else if (val == "INFO") {
+        level = LOG_LEVEL_INFO;
+    } else if (val == "WARN" || val == "WARNING") {
+        level = LOG_LEVEL_WARN;
+    } else if (val == "ERROR") {
+        level = LOG_LEVEL_ERROR;
+    } else if (val == "OFF") {
+        level = LOG_LEVEL_OFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool Logger::ParseFormat (const std::string & value, eLogFormat & format)
+{
+    std::string val = value;
+    std::transform (val.begin (), val.end (), val.begin (), ::toupper);
+
+    if (val == "TEXT") {
+        format = LOG_FORMAT_TEXT;
+    } else if (val == "JSON") {
+        format = LOG_FORMAT_JSON;
+    } else if (val == "BINARY") {
+        format = LOG_FORMAT_BINARY;
+    } else {
+        return false;
+    }
+    return true;
+}
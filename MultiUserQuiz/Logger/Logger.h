@@ -0,0 +1,161 @@
+// Logger.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+* Asynchronous logger shared by the server and the client.
+*
+* Every thread that logs gets its own fixed-size ring of records (single producer / single consumer),
+* so the I/O threads never contend on a stream lock and never block on terminal or file I/O.
+* A background flusher thread drains all rings every few milliseconds and writes them out in one go.
+*
+* If a ring is full the record is dropped and counted - logging must never stall a handler.
+* The flusher reports the dropped count so that loss is visible in the output itself.
+*
+* Use the QUIZ_LOG_* macros below rather than calling Log directly, they skip the formatting
+* completely when the severity is filtered out.
+*/
+
+enum eLogLevel {
+    LOG_LEVEL_TRACE,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF,
+};
+
+enum eLogFormat {
+    LOG_FORMAT_TEXT,            // human readable single line per record
+    LOG_FORMAT_JSON,            // one json object per line - for log shippers
+    LOG_FORMAT_BINARY,          // fixed header + raw bytes, see Logger::WriteBinary for the layout
+};
+
+#define LOG_MESSAGE_CAPACITY    232         // record is 256 bytes in total, longer messages are truncated
+#define LOG_RING_CAPACITY       1024        // records per thread, must be power of 2
+#define LOG_FLUSH_INTERVAL_MS   5
+
+class Logger {
+
+private:
+    struct LogRecord {
+        long long timestamp_us;
+        const char * component;             // must be a string literal, only the pointer is stored
+        unsigned int thread_index;
+        unsigned short length;
+        unsigned char level;
+        char message[LOG_MESSAGE_CAPACITY];
+    };
+
+    class LogRing {
+        public:
+        explicit LogRing (unsigned int index) : thread_index (index)
+        { }
+
+        LogRecord * BeginWrite ();
+        void CommitWrite ();
+
+        template <typename Fn>
+        void Drain (Fn && fn);
+
+        unsigned long long TakeDropped ();
+        unsigned int GetThreadIndex () const
+        {
+            return thread_index;
+        }
+
+        private:
+        alignas(64) std::atomic<unsigned long long> head {0};      // written by the owning thread only
+        alignas(64) std::atomic<unsigned long long> tail {0};      // written by the flusher only
+        alignas(64) std::atomic<unsigned long long> dropped {0};
+        unsigned int thread_index;
+        LogRecord slots[LOG_RING_CAPACITY];
+    };
+
+    std::atomic<int> min_level;
+    std::atomic<int> output_format;
+
+    std::vector<std::shared_ptr<LogRing>> rings;
+    std::mutex rings_mutex;                 // only taken when a thread logs for the first time and by the flusher
+
+    FILE * output;
+    bool owns_output;
+    std::mutex output_mutex;                // guards the output and serializes draining of the rings
+
+    std::thread flusher_thread;
+    std::mutex flusher_mutex;
+    std::condition_variable flusher_cv;
+    std::atomic<bool> is_running;
+
+    Logger ();
+    ~Logger ();
+
+    Logger (const Logger &) = delete;
+    Logger & operator= (const Logger &) = delete;
+
+    LogRing & GetThreadRing ();
+    void FlushLoop ();
+    size_t DrainAll (std::string & buffer);
+    void FormatText (std::string & buffer, const LogRecord & rec) const;
+    void FormatJson (std::string & buffer, const LogRecord & rec) const;
+    void WriteBinary (std::string & buffer, const LogRecord & rec) const;
+
+public:
+    static Logger & GetInstance ();
+
+    // Filtering
+    void SetLevel (eLogLevel level);
+    eLogLevel GetLevel () const;
+    bool IsEnabled (eLogLevel level) const
+    {
+        return level >= min_level.load (std::memory_order_relaxed);
+    }
+
+    // Output
+    void SetFormat (eLogFormat format);
+    bool SetOutputFile (const std::string & path);
+    void Flush ();
+    void Stop ();
+
+    // Producer side - formats straight into the calling thread's ring, no allocation
+    void Log (eLogLevel level, const char * component, const char * fmt, ...)
+#if defined(__GNUC__) || defined(__clang__)
+        __attribute__ ((format (printf, 4, 5)))
+#endif
+        ;
+
+    // Helpers for the config parser
+    static bool ParseLevel (const std::string & value, eLogLevel & level);
+    static bool ParseFormat (const std::string & value, eLogFormat & format);
+};
+
+#define QUIZ_LOG(level, component, ...)                                             \
+    do {                                                                            \
+        if (Logger::GetInstance ().IsEnabled (level)) {                             \
+            Logger::GetInstance ().Log (level, component, __VA_ARGS__);             \
+        }                                                                           \
+    } while (0)
+
+// Logs only every Nth occurrence of this call site - for high rate events like per message traces.
+#define QUIZ_LOG_SAMPLED(level, every_n, component, ...)                            \
+    do {                                                                            \
+        static std::atomic<unsigned int> quiz_log_sample_counter_ {0};              \
+        if (Logger::GetInstance ().IsEnabled (level) &&                             \
+            quiz_log_sample_counter_.fetch_add (1, std::memory_order_relaxed) % (every_n) == 0) { \
+            Logger::GetInstance ().Log (level, component, __VA_ARGS__);             \
+        }                                                                           \
+    } while (0)
+
+#define QUIZ_LOG_TRACE(component, ...)  QUIZ_LOG (LOG_LEVEL_TRACE, component, __VA_ARGS__)
+#define QUIZ_LOG_DEBUG(component, ...)  QUIZ_LOG (LOG_LEVEL_DEBUG, component, __VA_ARGS__)
+#define QUIZ_LOG_INFO(component, ...)   QUIZ_LOG (LOG_LEVEL_INFO, component, __VA_ARGS__)
+#define QUIZ_LOG_WARN(component, ...)   QUIZ_LOG (LOG_LEVEL_WARN, component, __VA_ARGS__)
+#define QUIZ_LOG_ERROR(component, ...)  QUIZ_LOG (LOG_LEVEL_ERROR, component, __VA_ARGS__)
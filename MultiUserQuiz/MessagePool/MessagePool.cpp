@@ -0,0 +1,17 @@
+// MessagePool.cpp
+#include "MessagePool.h"
+
+namespace MessagePool {
+
+    std::atomic<unsigned long long> created_total {0};
+    std::atomic<unsigned long long> freed_total {0};
+
+    Stats GetStats ()
+    {
+        return {
+            created_total.load (std::memory_order_relaxed),
+            freed_total.load (std::memory_order_relaxed)
+        };
+    }
+
+} // namespace MessagePool
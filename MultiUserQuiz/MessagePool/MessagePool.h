@@ -0,0 +1,292 @@
+// MessagePool.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <websocketpp/frame.hpp>
+#include <websocketpp/message_buffer/alloc.hpp>
+#include <websocketpp/message_buffer/message.hpp>
+
+/*
+* Recycled websocket messages for the server and the client endpoint.
+*
+* Stock websocketpp allocates a message object, its shared_ptr control block and a payload string for
+* every frame in and out, on whichever io thread handles it - the busiest path through the allocator.
+* Here released messages go back to a cache owned by the releasing thread, sorted into size classes by
+* the capacity of their payload, and the next get_message on that thread takes one that already fits.
+* The shared_ptr control blocks come from a per thread free list too, so a warm io thread serves a frame
+* without touching the heap.
+*
+* Nothing is shared between threads and nothing is locked. A message released on another thread than it
+* was taken on just moves to that thread's cache. Buffers above the largest class and anything past a
+* thread's byte budget are freed as before, so a burst of large frames does not stay resident.
+*/
+
+#define MESSAGE_POOL_CLASS_COUNT        5           // 256 B, 1 KB, 4 KB, 16 KB, 64 KB
+#define MESSAGE_POOL_SMALLEST_CLASS     256
+#define MESSAGE_POOL_LARGEST_BUFFER     (256 << 10) // payloads grown past this are freed, not cached
+#define MESSAGE_POOL_THREAD_BYTES       (4 << 20)   // payload capacity a thread keeps cached at most
+#define MESSAGE_POOL_BLOCK_CACHE        1024        // control blocks a thread keeps cached at most
+
+namespace MessagePool {
+
+    /*
+    * Only the slow path is counted - a warm pool touches no shared cache line at all. created keeps
+    * growing while the pool is still filling or when frames outgrow the classes, freed when buffers
+    * are over the budget.
+    */
+    struct Stats {
+        unsigned long long created;         // messages newly allocated, a get_message the caches could not serve
+        unsigned long long freed;           // messages released but too large or over the thread budget
+    };
+
+    // process wide, summed over all threads
+    Stats GetStats ();
+
+    extern std::atomic<unsigned long long> created_total;
+    extern std::atomic<unsigned long long> freed_total;
+
+    // the class a payload of this size is served from, CLASS_COUNT when it is too large to pool
+    inline size_t ClassFor (size_t size)
+    {
+        size_t class_size = MESSAGE_POOL_SMALLEST_CLASS;
+        for (size_t i = 0; i < MESSAGE_POOL_CLASS_COUNT; ++i, class_size <<= 2) {
+            if (size <= class_size) {
+                return i;
+            }
+        }
+        return MESSAGE_POOL_CLASS_COUNT;
+    }
+
+    // the largest class a buffer of this capacity can fully serve, CLASS_COUNT when it is below the smallest
+    inline size_t ClassOf (size_t capacity)
+    {
+        if (capacity < MESSAGE_POOL_SMALLEST_CLASS) {
+            return MESSAGE_POOL_CLASS_COUNT;
+        }
+        size_t index = 0;
+        size_t class_size = MESSAGE_POOL_SMALLEST_CLASS;
+        while (index + 1 < MESSAGE_POOL_CLASS_COUNT && capacity >= (class_size << 2)) {
+            class_size <<= 2;
+            ++index;
+        }
+        return index;
+    }
+
+    /*
+    * Fixed size blocks for the shared_ptr control blocks, one free list per thread and block type.
+    * Freed blocks stay on the freeing thread's list.
+    */
+    template <typename T>
+    struct BlockAllocator {
+        typedef T value_type;
+
+        BlockAllocator () noexcept = default;
+        template <typename U>
+        BlockAllocator (const BlockAllocator<U> &) noexcept { }
+
+        struct FreeList {
+            std::vector<void *> blocks;
+
+            FreeList ()
+            {
+                blocks.reserve (MESSAGE_POOL_BLOCK_CACHE);
+                IsAlive () = true;
+            }
+            ~FreeList ()
+            {
+                IsAlive () = false;
+                for (void * block : blocks) {
+                    ::operator delete (block);
+                }
+            }
+        };
+
+        // trivially destructible, so it can still be read once the list is gone at thread exit
+        static bool & IsAlive ()
+        {
+            thread_local bool is_alive = false;
+            return is_alive;
+        }
+
+        static FreeList * LocalFreeList ()
+        {
+            thread_local FreeList list;
+            return IsAlive () ? &list : nullptr;
+        }
+
+        T * allocate (size_t n)
+        {
+            FreeList * list = (n == 1) ? LocalFreeList () : nullptr;
+            if (list && !list->blocks.empty ()) {
+                void * block = list->blocks.back ();
+                list->blocks.pop_back ();
+                return static_cast<T *>(block);
+            }
+            return static_cast<T *>(::operator new (n * sizeof (T)));
+        }
+
+        void deallocate (T * p, size_t n) noexcept
+        {
+            FreeList * list = (n == 1) ? LocalFreeList () : nullptr;
+            if (list && list->blocks.size () < MESSAGE_POOL_BLOCK_CACHE) {
+                list->blocks.push_back (p);
+                return;
+            }
+            ::operator delete (p);
+        }
+
+        template <typename U>
+        bool operator== (const BlockAllocator<U> &) const noexcept { return true; }
+        template <typename U>
+        bool operator!= (const BlockAllocator<U> &) const noexcept { return false; }
+    };
+
+    /*
+    * The per thread message cache - one list per size class. Also marks a thread as gone at exit, a message
+    * released after that (a connection torn down during thread exit) is simply freed.
+    */
+    template <typename message>
+    class ThreadCache {
+        std::vector<message *> classes[MESSAGE_POOL_CLASS_COUNT];
+        size_t cached_bytes = 0;
+
+        static bool & IsAlive ()
+        {
+            thread_local bool is_alive = false;
+            return is_alive;
+        }
+
+    public:
+        ThreadCache () { IsAlive () = true; }
+        ~ThreadCache ()
+        {
+            IsAlive () = false;
+            for (auto & list : classes) {
+                for (message * msg : list) {
+                    delete msg;
+                }
+            }
+        }
+
+        static ThreadCache * Local ()
+        {
+            thread_local ThreadCache cache;
+            return IsAlive () ? &cache : nullptr;
+        }
+
+        // a cached message whose payload holds at least size bytes without growing, nullptr if there is none
+        message * Take (size_t size)
+        {
+            for (size_t i = ClassFor (size); i < MESSAGE_POOL_CLASS_COUNT; ++i) {
+                if (!classes[i].empty ()) {
+                    message * msg = classes[i].back ();
+                    classes[i].pop_back ();
+                    cached_bytes -= msg->get_raw_payload ().capacity ();
+                    return msg;
+                }
+            }
+            return nullptr;
+        }
+
+        // false when the message does not fit a class or the budget, the caller frees it then
+        bool Put (message * msg)
+        {
+            size_t capacity = msg->get_raw_payload ().capacity ();
+            size_t index = ClassOf (capacity);
+            if (index == MESSAGE_POOL_CLASS_COUNT || capacity > MESSAGE_POOL_LARGEST_BUFFER ||
+                cached_bytes + capacity > MESSAGE_POOL_THREAD_BYTES) {
+                return false;
+            }
+
+            // back to the state a new message starts in - the strings keep their buffers
+            msg->get_raw_payload ().clear ();
+            msg->set_header (std::string ());
+            msg->set_prepared (false);
+            msg->set_fin (true);
+            msg->set_terminal (false);
+            msg->set_compressed (false);
+
+            classes[index].push_back (msg);
+            cached_bytes += capacity;
+            return true;
+        }
+    };
+
+} // namespace MessagePool
+
+/*
+* Drop in for websocketpp::message_buffer::alloc::con_msg_manager, see QuizServerConfig / QuizClientConfig.
+*
+* Messages are made without a back pointer to their manager - websocketpp never calls message::recycle,
+* and a pooled message outlives the connection that first took it.
+*/
+template <typename message>
+class PooledConMsgManager : public websocketpp::lib::enable_shared_from_this<PooledConMsgManager<message>> {
+public:
+    typedef PooledConMsgManager<message> type;
+    typedef websocketpp::lib::shared_ptr<PooledConMsgManager> ptr;
+    typedef websocketpp::lib::weak_ptr<PooledConMsgManager> weak_ptr;
+    typedef typename message::ptr message_ptr;
+
+    message_ptr get_message ()
+    {
+        return Acquire (websocketpp::frame::opcode::text, 0, false);
+    }
+
+    message_ptr get_message (websocketpp::frame::opcode::value op, size_t size)
+    {
+        return Acquire (op, size, true);
+    }
+
+    bool recycle (message *)
+    {
+        return false;
+    }
+
+private:
+    struct Recycler {
+        void operator() (message * msg) const
+        {
+            auto * cache = MessagePool::ThreadCache<message>::Local ();
+            if (cache && cache->Put (msg)) {
+                return;
+            }
+            MessagePool::freed_total.fetch_add (1, std::memory_order_relaxed);
+            delete msg;
+        }
+    };
+
+    static message_ptr Acquire (websocketpp::frame::opcode::value op, size_t size, bool has_opcode)
+    {
+        auto * cache = MessagePool::ThreadCache<message>::Local ();
+        message * msg = cache ? cache->Take (size) : nullptr;
+
+        if (msg) {
+            if (has_opcode) {
+                msg->set_opcode (op);
+            }
+            return message_ptr (msg, Recycler (), MessagePool::BlockAllocator<message> ());
+        }
+
+        MessagePool::created_total.fetch_add (1, std::memory_order_relaxed);
+        if (has_opcode) {
+            // at least the smallest class, so the buffer can come back into the cache
+            msg = new message (ptr (), op, std::max<size_t> (size, MESSAGE_POOL_SMALLEST_CLASS));
+        } else {
+            msg = new message (ptr ());
+            msg->get_raw_payload ().reserve (MESSAGE_POOL_SMALLEST_CLASS);
+        }
+
+        return message_ptr (msg, Recycler (), MessagePool::BlockAllocator<message> ());
+    }
+};
+
+// websocketpp's message parameterised with the pooled manager, plug both into an endpoint config
+typedef websocketpp::message_buffer::message<PooledConMsgManager> PooledMessage;
+typedef PooledConMsgManager<PooledMessage> PooledConMsgManagerType;
+typedef websocketpp::message_buffer::alloc::endpoint_msg_manager<PooledConMsgManagerType> PooledEndpointMsgManagerType;
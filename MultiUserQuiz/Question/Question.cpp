@@ -1,10 +1,11 @@
 #include "Question.h"
+#include "StringArena.h"
 
-Question::Question (unsigned int questionID, string questionText, vector<string> options, unordered_set<int> correctOptions)
+Question::Question (unsigned int questionID, string_view questionText, const vector<string> & options, unsigned char correctOptions)
 {
     this->exclquesID = questionID;
-    this->questionText = questionText;
-    this->quesOptions = options;
+    SetQuestionText (questionText);
+    SetQuestionOptions (options);
     this->correctOptions = correctOptions;
 }
 
@@ -18,21 +19,26 @@ unsigned int Question::GetQuestionID () const
     return questionID;
 }
 
-string Question::GetQuestionText () const
+string_view Question::GetQuestionText () const
 {
     return questionText;
 }
 
-vector<string> Question::GetQuestionOptions () const
+span<const string_view> Question::GetQuestionOptions () const
 {
-    return quesOptions;
+    return span<const string_view> (quesOptions.data (), optionCount);
 }
 
-unordered_set<int> Question::GetCorrectOptions () const
+unsigned int Question::GetOptionCount () const
+{
+    return optionCount;
+}
+
+unsigned char Question::GetCorrectOptions () const
 {
     // TODO: debug check for empty correct option for a question
 #ifdef DEBUG
-    if (correctOptions.empty ()) 
+    if (correctOptions == 0)
     {
         // something is wrong with this question
     }
@@ -46,29 +52,34 @@ void Question::SetQuestionID (unsigned int questionID)
     this->questionID = questionID;
 }
 
-void Question::SetQuestionText (string & questionText)
+void Question::SetQuestionText (string_view questionText)
 {
-    this->questionText = questionText;
+    this->questionText = StringArena::GetInstance ().Intern (questionText);
 }
 
-void Question::SetQuestionOptions (vector<string> options)
+void Question::SetQuestionOptions (const vector<string> & options)
 {
-    // TODO make sure it is moved instead of copied.
-    this->quesOptions = options;
+    optionCount = 0;
+    quesOptions = {};
+
+    for (const string & option : options) {
+        AddQuestionOption (option);
+    }
 }
 
-void Question::SetCorrectOptions (unordered_set<int> correctOptions)
+void Question::SetCorrectOptions (unsigned char correctOptions)
 {
     this->correctOptions = correctOptions;
 }
 
-void Question::AddQuestionOption (string option)
+void Question::AddQuestionOption (string_view option)
 {
-    if (quesOptions.size () > 4) {
+    if (optionCount >= MAX_QUESTION_OPTIONS) {
 
         // log here - TODO: add your logger class and add here.
+        return;
     }
-    quesOptions.push_back (option);
+    quesOptions[optionCount++] = StringArena::GetInstance ().Intern (option);
 }
 
 void Question::DisplayQuestion () const
@@ -83,15 +94,17 @@ void Question::DisplayQuestion () const
 void Question::DisplayCorrectAnswers () const
 {
     std::cout << "Correct Option(s): ";
-    for (int i : correctOptions) {
-        std::cout << static_cast<char>('A' + i) << " ";
+    for (int i = 0; i < MAX_QUESTION_OPTIONS; i++) {
+        if (IsCorrect (i)) {
+            std::cout << static_cast<char>('A' + i) << " ";
+        }
     }
     std::cout << std::endl;
 }
 
-bool Question::IsCorrect (string option) const
+bool Question::IsCorrect (string_view option) const
 {
-    for (int i = 0; i < quesOptions.size (); i++) {
+    for (int i = 0; i < optionCount; i++) {
 
         if (quesOptions[i] == option) {
 
@@ -106,12 +119,12 @@ bool Question::IsCorrect (string option) const
 /*
 *  Method to check the answer based on the index selected.
 * @param:   index - index of the quesoption
-* 
+*
 * Checks the question option index is part of the correct options. This can be used to check
 * if single answer and not multioption answer.
-* 
+*
 */
 bool Question::IsCorrect (int index) const
 {
-    return correctOptions.find (index) != correctOptions.end ();
+    return index >= 0 && index < MAX_QUESTION_OPTIONS && (correctOptions & (1u << index)) != 0;
 }
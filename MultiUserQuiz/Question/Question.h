@@ -1,34 +1,39 @@
 #pragma once
 #include <iostream>
-#include <unordered_set>
+#include <array>
+#include <span>
 #include <vector>
 #include <string>
+#include <string_view>
 using namespace std;
 
+#define MAX_QUESTION_OPTIONS    4
+
 class Question {
 
 public:
                         // Constructor and Destructor
                         Question            () = default;
                         Question            (const Question &) = default;
-                        Question            (unsigned int questionID, string questionText, vector<string> options, unordered_set<int> correctOptions);
+                        Question            (unsigned int questionID, string_view questionText, const vector<string> & options, unsigned char correctOptions);
                         ~Question           ();
 
-                        // Getters
+                        // Getters - the strings live in the StringArena, nothing is copied
     unsigned int        GetQuestionID       () const;
-    string              GetQuestionText     () const;
-    vector<string>      GetQuestionOptions  () const;
-    unordered_set<int>  GetCorrectOptions   () const;
+    string_view         GetQuestionText     () const;
+    span<const string_view> GetQuestionOptions () const;   // the GetOptionCount () options in use
+    unsigned int        GetOptionCount      () const;
+    unsigned char       GetCorrectOptions   () const;
 
                         // Setters  
     void                SetQuestionID       (unsigned int questionID);
-    void                SetQuestionText     (string & questionText);
-    void                SetQuestionOptions  (vector<string> options);
-    void                SetCorrectOptions   (unordered_set<int> correctOptions);
+    void                SetQuestionText     (string_view questionText);
+    void                SetQuestionOptions  (const vector<string> & options);
+    void                SetCorrectOptions   (unsigned char correctOptions);
 
-    void                AddQuestionOption   (string option);
+    void                AddQuestionOption   (string_view option);
 
-    bool                IsCorrect           (string option) const;
+    bool                IsCorrect           (string_view option) const;
     bool                IsCorrect           (int index) const;
 
                         // Diplay methods
@@ -37,15 +42,14 @@ public:
 
 private:
 
-    unsigned int        questionID;             // Unique ID for the question and also serves as question number.
-    unsigned int        exclquesID;             // Question number in excel.
-    string              questionText;
-
-    //TODO: Should option be made set? so that only unique options are allowed. But this should lead to parsing failure.
-    // We will keep it as vector only as 4 elements are only there and our use case would be to access at index at max, so should be fine.
-    // As far as detecting duplicate options while parsing , we can handle it while parsing only.
+    unsigned int        questionID = 0;         // Unique ID for the question and also serves as question number.
+    unsigned int        exclquesID = 0;         // Question number in excel.
+    string_view         questionText;
 
-    vector<string>      quesOptions;            // stores the options A,B,C,D string
-    unordered_set<int>  correctOptions;         // stores the index of quesOptions index - which are correct answers - this will be zero based index. 
-                                                // lets say if A & C are correct answers then it will store 0 and 2 in the set (correctOptions).
+    // The views point into the StringArena, so a question owns no heap memory at all and a 100k bank
+    // is one contiguous array of these plus the arena blocks.
+    array<string_view, MAX_QUESTION_OPTIONS> quesOptions {};   // stores the options A,B,C,D string
+    unsigned char       optionCount = 0;
+    unsigned char       correctOptions = 0;     // bit i set when option i is a correct answer - zero based like the option index.
+                                                // lets say if A & C are correct answers then it will be 0b0101.
 };
\ No newline at end of file
@@ -1,8 +1,9 @@
 #include "QuestionBank.h"
+#include <algorithm>
 
 QuestionBank::QuestionBank (): vIsInitialized(false)
 {
-    // nothing
+    current = std::make_shared<const Snapshot> ();
 }
 
 QuestionBank::~QuestionBank ()
@@ -16,137 +17,210 @@ QuestionBank & QuestionBank::GetInstance ()
     return instance;
 }
 
-bool QuestionBank::AddQuestionToBank (std::shared_ptr<Question> ques)
+// --- Snapshot ---
+
+unsigned int QuestionBank::Snapshot::AddQuestion (std::shared_ptr<Question> ques)
 {
-        std::unique_lock        ulock (mtx);
         unsigned int            newId;
 
     // Generate a new Question ID
     newId = static_cast<unsigned int>(quesmap.size ()) + 1;
 
     ques->SetQuestionID (newId);
+    quesmap.emplace (newId, std::move (ques));
+
+    return newId;
+}
 
-    auto [it, inserted] = quesmap.emplace (newId, std::move (ques));
+std::shared_ptr<const Question> QuestionBank::Snapshot::GetQuestionById (unsigned int id) const
+{
+    auto itr = quesmap.find (id);
 
-    return inserted;  // true if inserted successfully, false if an issue occurred
+    // adding constness to the shared pointer - so that the caller cannot modify the question object.
+    return (itr != quesmap.end ()) ? std::const_pointer_cast<const Question>(itr->second) : nullptr;
 }
 
-bool QuestionBank::UpdateQuestionById (unsigned int id, std::shared_ptr<Question> ques)
+unsigned char QuestionBank::Snapshot::GetCorrectOptionsById (unsigned int id) const
 {
-        std::unique_lock    ulock (mtx);
-        quesmap_itr         itr;
+    auto itr = quesmap.find (id);
+    return (itr != quesmap.end () && itr->second) ? itr->second->GetCorrectOptions () : 0;
+}
 
-    if (quesmap.empty ()) {
-        // Question Bank is empty
-        return false;
+std::vector<unsigned char> QuestionBank::Snapshot::GetCorrectOptionsByIds (const std::vector<unsigned int> & ids) const
+{
+        std::vector<unsigned char>          correct_opts;
+
+    correct_opts.reserve (ids.size ());
+
+    for (unsigned int id : ids) {
+        correct_opts.push_back (GetCorrectOptionsById (id));
     }
+    return correct_opts;
+}
+
+unsigned int QuestionBank::Snapshot::TotalQuestionCount () const
+{
+    return static_cast<unsigned int>(quesmap.size ());
+}
+
+// --- Diff ---
 
-    itr = quesmap.find (id);
+bool QuestionBank::Diff::IsEmpty () const
+{
+    return text_changed.empty () && key_changed.empty () && added.empty () && removed.empty ();
+}
 
-    // the question is found and nobody else is referencing this question except the QuestionBank itself
-    if (itr != quesmap.end () && itr->second.use_count () == 1) {
+bool QuestionBank::Diff::IsTextOnly () const
+{
+    return key_changed.empty () && added.empty () && removed.empty ();
+}
 
-        ques->SetQuestionID (id);
+nlohmann::json QuestionBank::Diff::ToJson () const
+{
+    return {
+        {"text_changed", text_changed},
+        {"key_changed", key_changed},
+        {"added", added},
+        {"removed", removed}
+    };
+}
 
-        itr->second = std::move (ques);
+// --- Bank ---
 
-        //itr->second = ques; // update the question in the map
-        return true;
-    }
+std::shared_ptr<const QuestionBank::Snapshot> QuestionBank::GetSnapshot () const
+{
+    return std::atomic_load (&current);
+}
 
-    // question id not present to alter.
-    return false;
+std::shared_ptr<QuestionBank::Snapshot> QuestionBank::CopySnapshot () const
+{
+    return std::make_shared<Snapshot> (*GetSnapshot ());
 }
 
-bool QuestionBank::RemoveQuestionById (unsigned int id)
+QuestionBank::Diff QuestionBank::Compare (const Snapshot & from, const Snapshot & to)
 {
-        std::unique_lock    ulock (mtx);
-        quesmap_citr        itr;
+        Diff        diff;
 
-    if (quesmap.empty ()) {
-        // Question Bank is empty
-        return false;
-    }
+    for (const auto & [id, ques] : to.quesmap) {
+
+        auto itr = from.quesmap.find (id);
+        if (itr == from.quesmap.end ()) {
+            diff.added.push_back (id);
+            continue;
+        }
 
-    itr = quesmap.find (id);
+        const Question & old_ques = *itr->second;
+        if (old_ques.GetCorrectOptions () != ques->GetCorrectOptions ()) {
+            diff.key_changed.push_back (id);
+        } else if (old_ques.GetQuestionText () != ques->GetQuestionText () ||
+                   !std::ranges::equal (old_ques.GetQuestionOptions (), ques->GetQuestionOptions ())) {
+            diff.text_changed.push_back (id);
+        }
+    }
 
-    // the question is found and nobody else is referencing this question except the QuestionBank itself
-    if (itr != quesmap.end () && itr->second.use_count () == 1) {
+    for (const auto & [id, ques] : from.quesmap) {
+        if (to.quesmap.find (id) == to.quesmap.end ()) {
+            diff.removed.push_back (id);
+        }
+    }
 
-        quesmap.erase (itr);
-        return true;
+    for (auto * ids : {&diff.text_changed, &diff.key_changed, &diff.added, &diff.removed}) {
+        std::sort (ids->begin (), ids->end ());
     }
+    return diff;
+}
 
-    return false;
+QuestionBank::Diff QuestionBank::PublishSnapshot (std::shared_ptr<Snapshot> next)
+{
+        std::lock_guard<std::mutex>     wlock (write_mtx);
+        std::shared_ptr<const Snapshot> prev = GetSnapshot ();
+
+    Diff diff = Compare (*prev, *next);
+    next->version = prev->version + 1;
+    std::atomic_store (&current, std::shared_ptr<const Snapshot> (std::move (next)));
+
+    return diff;
 }
 
-std::shared_ptr<const Question> QuestionBank::GetQuestionById (unsigned int id)
+// copies the bank for one question - a whole bank is built in a Snapshot and published once instead
+bool QuestionBank::AddQuestionToBank (std::shared_ptr<Question> ques)
 {
-        std::shared_lock    lck (mtx);
-        quesmap_citr        itr;
+        std::lock_guard<std::mutex>     wlock (write_mtx);
+        std::shared_ptr<Snapshot>       next = CopySnapshot ();
 
-    if (quesmap.empty ()) {
-        // Question Bank is empty
-        return nullptr;
-    }
-    itr = quesmap.find (id);
+    next->AddQuestion (std::move (ques));
+    next->version = current->version + 1;
+    std::atomic_store (&current, std::shared_ptr<const Snapshot> (std::move (next)));
 
-    if (itr != quesmap.end ()) {
+    return true;
+}
 
-        std::shared_ptr<Question> sp = itr->second;
-        if (sp == nullptr) {
-            // the stored question has been deleted.
-            return nullptr;
-        }
+bool QuestionBank::UpdateQuestionById (unsigned int id, std::shared_ptr<Question> ques)
+{
+        std::lock_guard<std::mutex>     wlock (write_mtx);
 
-        // adding constness to the shared pointer - so that the caller cannot modify the question object.
-        return std::const_pointer_cast<const Question>(sp);
+    if (GetSnapshot ()->quesmap.count (id) == 0) {
+        // question id not present to alter.
+        return false;
     }
-    return nullptr;
+
+    // whoever still holds the old question keeps it, the new snapshot gets the replacement
+    std::shared_ptr<Snapshot> next = CopySnapshot ();
+
+    ques->SetQuestionID (id);
+    next->quesmap[id] = std::move (ques);
+    next->version = current->version + 1;
+    std::atomic_store (&current, std::shared_ptr<const Snapshot> (std::move (next)));
+
+    return true;
 }
 
-unordered_set<int> QuestionBank::GetCorrectOptionsById (unsigned int id)
+bool QuestionBank::RemoveQuestionById (unsigned int id)
 {
-        std::shared_lock    lck (mtx);
-        quesmap_citr        itr;
+        std::lock_guard<std::mutex>     wlock (write_mtx);
 
-    if (quesmap.empty ()) {
-        // Question Bank is empty
-        goto err_end;
+    if (GetSnapshot ()->quesmap.count (id) == 0) {
+        return false;
     }
 
-     itr = quesmap.find (id);
+    std::shared_ptr<Snapshot> next = CopySnapshot ();
 
-    if (itr != quesmap.end()) {
+    next->quesmap.erase (id);
+    next->version = current->version + 1;
+    std::atomic_store (&current, std::shared_ptr<const Snapshot> (std::move (next)));
 
-        std::shared_ptr<Question> sp = itr->second;
-        if (sp == nullptr) {
-            // the stored question has been deleted.
-            goto err_end;
-        }
-        return sp->GetCorrectOptions ();
-    }
+    return true;
+}
+
+std::shared_ptr<const Question> QuestionBank::GetQuestionById (unsigned int id)
+{
+    return GetSnapshot ()->GetQuestionById (id);
+}
+
+std::vector<unsigned char> QuestionBank::GetCorrectOptionsByIds (const std::vector<unsigned int> & ids) const
+{
+    return GetSnapshot ()->GetCorrectOptionsByIds (ids);
+}
 
-err_end: 
-    return unordered_set<int> ();
+unsigned char QuestionBank::GetCorrectOptionsById (unsigned int id)
+{
+    return GetSnapshot ()->GetCorrectOptionsById (id);
 }
 
 unsigned int QuestionBank::TotalQuestionCount () const
 {
-    return static_cast<unsigned int>(quesmap.size());
+    return GetSnapshot ()->TotalQuestionCount ();
 }
 
 void QuestionBank::ResetQuestionBank ()
 {
-        std::unique_lock    ulock (mtx);
-
-    // empties the map and should reduce the reference count hence leading to destruction of questions.
-    quesmap.clear ();
+    // the questions go away once the last holder of the old snapshot lets go of it
+    PublishSnapshot (std::make_shared<Snapshot> ());
 }
 
 bool QuestionBank::IsQuestionBankEmpty () const
 {
-    return quesmap.empty();
+    return GetSnapshot ()->quesmap.empty ();
 }
 
 bool QuestionBank::IsQuestionBankInitialized () const
@@ -1,26 +1,65 @@
 #pragma once
+#include <memory>
+#include <mutex>
 #include <unordered_map>
-#include <shared_mutex>
+#include <vector>
+#include <nlohmann/json.hpp>
 #include "Question.h"
 
 using quesmap_citr = std::unordered_map<unsigned int, std::shared_ptr<Question>>::const_iterator;
 using quesmap_itr = std::unordered_map<unsigned int, std::shared_ptr<Question>>::iterator;
 
 /**
-* QuestionBank will be a singleton class holding all the questions, and 
+* QuestionBank will be a singleton class holding all the questions, and
 * it will be the single point of contact for all the questions.
 * Server and client amy have its own question bank object.
 * It will be initialized/instantiated at startup.
-* 
-* This class will hold all the questions and will be object and it will return reference or pointer 
+*
+* This class will hold all the questions and will be object and it will return reference or pointer
 * of the Question object when requested.
-* 
+*
 * Question bank will update the question id of the question object as per the map count or number of items added till now,
 * this also means the question object will come with empty question id to QuestionBank.
-* 
+*
+* The questions are held in an immutable Snapshot. A change never touches the published snapshot, it
+* builds a new one and swaps the pointer, so readers never wait for a writer - not even while a reload
+* parses a large file. Whoever needs several lookups to agree (e.g. a user's whole exam) holds on to
+* one snapshot instead of going through the bank every time.
 */
 class QuestionBank {
 public:
+
+    /*
+    * One version of the bank. Never modified once published.
+    */
+    struct Snapshot {
+            unsigned long long                  version = 0;
+
+            unsigned int                        AddQuestion                 (std::shared_ptr<Question> ques);   // next free id
+
+            std::shared_ptr<const Question>     GetQuestionById             (unsigned int id) const;
+            unsigned char                       GetCorrectOptionsById       (unsigned int id) const;
+            std::vector<unsigned char>          GetCorrectOptionsByIds      (const std::vector<unsigned int> & ids) const;
+            unsigned int                        TotalQuestionCount          () const;
+
+            unordered_map <unsigned int, std::shared_ptr<Question>>  quesmap;                   //< Holds all the questions for the quiz
+    };
+
+    /*
+    * What a new snapshot changes, by question id. Wording fixes keep ids and answer keys, so they
+    * are safe to show to users in the middle of their exam - everything else is not.
+    */
+    struct Diff {
+            std::vector<unsigned int>           text_changed;       //< question or option wording, same answer key
+            std::vector<unsigned int>           key_changed;
+            std::vector<unsigned int>           added;
+            std::vector<unsigned int>           removed;
+
+            bool                                IsEmpty                     () const;
+            bool                                IsTextOnly                  () const;
+            nlohmann::json                      ToJson                      () const;
+    };
+
     static  QuestionBank &                      GetInstance         ();
 
             // the actual object should be moved or should it be pointer, or should we allocate question object dynamically and let the quesmap hold the pointer?
@@ -28,9 +67,18 @@ public:
             bool                                UpdateQuestionById          (unsigned int id, std::shared_ptr<Question> ques);
             bool                                RemoveQuestionById          (unsigned int id);
 
+            // the current version - lock free for the caller, hold it as long as the lookups must agree
+            std::shared_ptr<const Snapshot>     GetSnapshot                 () const;
+
+            // replaces the whole bank in one step, the new snapshot gets the next version number
+            Diff                                PublishSnapshot             (std::shared_ptr<Snapshot> next);
+    static  Diff                                Compare                     (const Snapshot & from, const Snapshot & to);
+
             std::shared_ptr<const Question>     GetQuestionById             (unsigned int id);
 
-            unordered_set<int>                  GetCorrectOptionsById       (unsigned int id);
+            // answer keys as option bitmasks (bit i = option i), 0 for a missing id
+            unsigned char                       GetCorrectOptionsById       (unsigned int id);
+            std::vector<unsigned char>          GetCorrectOptionsByIds      (const std::vector<unsigned int> & ids) const;
 
             unsigned int                        TotalQuestionCount          () const;
             void                                ResetQuestionBank           ();
@@ -38,6 +86,7 @@ public:
             bool                                IsQuestionBankEmpty         () const;
             bool                                IsQuestionBankInitialized   () const;
             void                                SetQuestionBankInitialized  (bool pIsInitialized);
+
 private:
                                                 QuestionBank                ();
                                                 ~QuestionBank               ();
@@ -45,15 +94,15 @@ private:
                                                 QuestionBank                (const QuestionBank &) = delete;
             QuestionBank &                      operator =                  (const QuestionBank &)  = delete;
 
+            // copy of the current snapshot for a single question change - copy on write, the published one stays as is
+            std::shared_ptr<Snapshot>           CopySnapshot                () const;
+
             // we have chosen shared_ptr as we wanted to return the question outside this class using GetQuestionById function.
             // where now it is returning shared_ptr outside, but after adding constness. This will ensure the object is not updated outside the class.
             // But on using shared_ptr we have the flexibility on the life of shared_ptr(question) - because it has reference count internally.
-            // so we will update or remove this question only if its reference count is 1, which means this question is no where else reffered outside this class.
-            // and lets say when question bank is destroyed, we will not delete the question object, as it will be deleted by the shared_ptr destructor. 
-            // So if any of the question is referred outside and question bank gets destroyed, the externally referred question will be not be deleted, but the reference 
-            // count will be decremented and when finally the external reference goes out of scope or is deleted, then the 
-            // shared ptr ref count will go to zero and the question will be deleted.
-            unordered_map <unsigned int, std::shared_ptr<Question>>  quesmap;                   //< Holds all the questions for the quiz
-            mutable shared_mutex                mtx;
+            // A snapshot and everything in it stays alive until the last reader lets go of it, so replacing or removing a
+            // question never pulls it from under somebody who is still using it.
+            std::shared_ptr<const Snapshot>     current;                                        //< only touched through std::atomic_load / atomic_store
+            std::mutex                          write_mtx;                                      //< serializes the writers, readers never take it
             bool                                vIsInitialized;                                 //< Flag to indicate if the question bank is initialized or not
-};
\ No newline at end of file
+};
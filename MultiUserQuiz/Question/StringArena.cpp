@@ -0,0 +1,83 @@
+#include "StringArena.h"
+#include <cstring>
+
+#define ARENA_BLOCK_SIZE        (64 * 1024)             // one block holds a few hundred questions
+#define ARENA_LARGE_STRING      (ARENA_BLOCK_SIZE / 4)  // bigger strings get a block of their own
+
+StringArena & StringArena::GetInstance ()
+{
+    static StringArena instance;
+    return instance;
+}
+
+StringArena::StringArena ()
+{
+    cursor = nullptr;
+    remaining = bytesUsed = bytesReserved = 0;
+}
+
+char * StringArena::Allocate (size_t size)
+{
+    // a large string must not waste the rest of the current block, it gets its own
+    if (size > ARENA_LARGE_STRING) {
+        blocks.push_back (std::make_unique<char[]> (size));
+        bytesReserved += size;
+        return blocks.back ().get ();
+    }
+
+    if (size > remaining) {
+        blocks.push_back (std::make_unique<char[]> (ARENA_BLOCK_SIZE));
+        bytesReserved += ARENA_BLOCK_SIZE;
+        cursor = blocks.back ().get ();
+        remaining = ARENA_BLOCK_SIZE;
+    }
+
+    char * mem = cursor;
+    cursor += size;
+    remaining -= size;
+    return mem;
+}
+
+std::string_view StringArena::Copy (std::string_view str)
+{
+    char * mem = Allocate (str.size ());
+    memcpy (mem, str.data (), str.size ());
+    bytesUsed += str.size ();
+    return std::string_view (mem, str.size ());
+}
+
+std::string_view StringArena::Intern (std::string_view str)
+{
+    if (str.empty ()) {
+        return std::string_view ();
+    }
+
+        std::lock_guard<std::mutex>     lck (mtx);
+
+    auto itr = interned.find (str);
+    if (itr != interned.end ()) {
+        return *itr;
+    }
+
+    std::string_view stored = Copy (str);
+    interned.insert (stored);
+    return stored;
+}
+
+size_t StringArena::GetBytesUsed () const
+{
+    std::lock_guard<std::mutex> lck (mtx);
+    return bytesUsed;
+}
+
+size_t StringArena::GetBytesReserved () const
+{
+    std::lock_guard<std::mutex> lck (mtx);
+    return bytesReserved;
+}
+
+size_t StringArena::GetStringCount () const
+{
+    std::lock_guard<std::mutex> lck (mtx);
+    return interned.size ();
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/*
+* Append only storage for the question bank strings.
+*
+* Question text and options are copied once into large blocks and handed out as string_views, so a
+* question carries no heap blocks of its own and its strings sit next to each other in memory.
+* Every string is interned - the many "True", "False", "None of the above" of a large bank are stored
+* once, and so is a question text that is loaded again.
+*
+* Nothing is ever freed before the process exits, so the views stay valid for as long as anybody
+* holds a question. A reload only adds the strings that are new or were edited, reloading the same
+* file (RELOAD_BANK, the file watcher) adds nothing - the arena is bounded by the distinct texts
+* ever loaded, not by the number of reloads.
+*/
+class StringArena {
+public:
+    static  StringArena &                       GetInstance     ();
+
+            std::string_view                    Intern          (std::string_view str);
+
+            // footprint - bytes handed out, bytes reserved in blocks, distinct strings
+            size_t                              GetBytesUsed    () const;
+            size_t                              GetBytesReserved() const;
+            size_t                              GetStringCount  () const;     // interned ones
+
+private:
+                                                StringArena     ();
+                                                StringArena     (const StringArena &) = delete;
+            StringArena &                       operator =      (const StringArena &) = delete;
+
+            char *                              Allocate        (size_t size);
+            std::string_view                    Copy            (std::string_view str);
+
+            std::vector<std::unique_ptr<char[]>> blocks;
+            char *                              cursor;             //< free space in the current block
+            size_t                              remaining;
+            size_t                              bytesUsed;
+            size_t                              bytesReserved;
+            std::unordered_set<std::string_view> interned;          //< views into the blocks, hashed by content
+    mutable std::mutex                          mtx;
+};
@@ -0,0 +1,101 @@
+#include "QuizClock.h"
+#include <chrono>
+
+std::atomic<long long>      QuizClock::tick_ms {0};
+std::atomic<long long>      QuizClock::wall_offset_ms {0};
+std::atomic<bool>           QuizClock::is_ticking {false};
+
+std::mutex                  QuizClock::ticker_mutex;
+std::condition_variable     QuizClock::ticker_cv;
+std::thread                 QuizClock::ticker;
+bool                        QuizClock::is_stopping = false;
+
+long long QuizClock::ReadMonotonicMs ()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now ().time_since_epoch ())
+        .count ();
+}
+
+long long QuizClock::ReadWallMs ()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now ().time_since_epoch ())
+        .count ();
+}
+
+long long QuizClock::NowMs ()
+{
+    if (is_ticking.load (std::memory_order_acquire)) {
+        return tick_ms.load (std::memory_order_relaxed);
+    }
+    return ReadMonotonicMs ();
+}
+
+long long QuizClock::WallNowMs ()
+{
+    return ToWallMs (NowMs ());
+}
+
+long long QuizClock::ToWallMs (long long monotonic_ms)
+{
+    if (is_ticking.load (std::memory_order_acquire)) {
+        return monotonic_ms + wall_offset_ms.load (std::memory_order_relaxed);
+    }
+    return monotonic_ms + (ReadWallMs () - ReadMonotonicMs ());
+}
+
+long long QuizClock::FromWallMs (long long wall_ms)
+{
+    return wall_ms - ToWallMs (0);
+}
+
+long long QuizClock::Refresh ()
+{
+    long long now = ReadMonotonicMs ();
+
+    // the offset first, a reader that sees the new tick sees the offset that goes with it
+    wall_offset_ms.store (ReadWallMs () - now, std::memory_order_relaxed);
+
+    // several threads may refresh, the tick only ever moves forward
+    long long published = tick_ms.load (std::memory_order_relaxed);
+    while (published < now && !tick_ms.compare_exchange_weak (published, now, std::memory_order_release)) {
+    }
+    return now > published ? now : published;
+}
+
+void QuizClock::TickLoop (long long resolution_ms)
+{
+    std::unique_lock<std::mutex> lock (ticker_mutex);
+    while (!ticker_cv.wait_for (lock, std::chrono::milliseconds (resolution_ms), [] { return is_stopping; })) {
+        Refresh ();
+    }
+}
+
+void QuizClock::Start (long long resolution_ms)
+{
+    std::lock_guard<std::mutex> lock (ticker_mutex);
+    if (ticker.joinable () || resolution_ms <= 0) {
+        return;
+    }
+
+    // readers switch over only once a tick is published
+    Refresh ();
+    is_ticking.store (true, std::memory_order_release);
+    is_stopping = false;
+    ticker = std::thread (&QuizClock::TickLoop, resolution_ms);
+}
+
+void QuizClock::Stop ()
+{
+    {
+        std::lock_guard<std::mutex> lock (ticker_mutex);
+        if (!ticker.joinable ()) {
+            return;
+        }
+        is_stopping = true;
+        is_ticking.store (false, std::memory_order_release);
+    }
+    ticker_cv.notify_all ();
+    ticker.join ();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+* Process wide millisecond clock for every timing check on the server.
+*
+* NowMs is monotonic (steady_clock), so deadlines computed from it do not move when the wall clock
+* is stepped (NTP, an admin fixing the time) in the middle of an exam. Once Start is called a ticker
+* thread publishes the tick every resolution_ms and a read is a single relaxed load. Before that,
+* and in a process that never starts it (the client), NowMs reads steady_clock itself.
+*
+* Monotonic values mean nothing outside this process. Times that leave it - sent to a client,
+* written to the state file, put in a resume token - are converted with ToWallMs / FromWallMs at
+* that boundary, against the wall clock as of the latest tick.
+*/
+class QuizClock {
+
+    static std::atomic<long long>   tick_ms;
+    static std::atomic<long long>   wall_offset_ms;         // wall - monotonic, as of the latest tick
+    static std::atomic<bool>        is_ticking;
+
+    static std::mutex               ticker_mutex;
+    static std::condition_variable  ticker_cv;
+    static std::thread              ticker;
+    static bool                     is_stopping;
+
+    static long long    ReadMonotonicMs     ();
+    static long long    ReadWallMs          ();
+    static void         TickLoop            (long long resolution_ms);
+
+public:
+    static long long    NowMs               ();
+    static long long    WallNowMs           ();
+
+    static long long    ToWallMs            (long long monotonic_ms);
+    static long long    FromWallMs          (long long wall_ms);
+
+    // publishes a fresh tick right away and returns it
+    static long long    Refresh             ();
+
+    static void         Start               (long long resolution_ms);
+    static void         Stop                ();
+};
@@ -8,8 +8,13 @@ namespace QuizHelper
 {
     eQuesAttemptStatus ValidateUserAnswer (const Answer & ans)
     {
-            QuestionBank & qb                       = QuestionBank::GetInstance ();
-            std::unordered_set<int> correct_opts    = qb.GetCorrectOptionsById (ans.GetQuestionId ());
+        QuestionBank & qb = QuestionBank::GetInstance ();
+        return ValidateUserAnswer (ans, qb.GetCorrectOptionsById (ans.GetQuestionId ()));
+    }
+
+    // Variant for callers that already hold the answer key, e.g. batch submissions fetching all keys in one go.
+    eQuesAttemptStatus ValidateUserAnswer (const Answer & ans, unsigned char correct_opts)
+    {
             std::array<bool, 4> selected_ans        = ans.GetSelectedOp ();
             bool has_correct                        = false;
             bool has_incorrect                      = false;
@@ -18,7 +23,11 @@ namespace QuizHelper
             return UNATTEMPTED;  // No answer selected
         }
 
-        for (int option_idx : correct_opts) {
+        for (int option_idx = 0; option_idx < MAX_QUESTION_OPTIONS; ++option_idx) {
+
+            if (!(correct_opts & (1u << option_idx))) {
+                continue;
+            }
 
             if (selected_ans[option_idx]) {
                 has_correct = true;
@@ -56,7 +65,7 @@ namespace QuizHelper
         std::vector<std::string> options = {option_a, option_b, option_c, option_d};
 
         // Parse correct options - supports both "A,C" and "1,3"
-        std::unordered_set<int> correct_options;
+        unsigned char correct_options = 0;
         std::istringstream iss (correct_options_str);
         std::string token;
 
@@ -82,21 +91,9 @@ namespace QuizHelper
             if (index < 0 || index > 3) {
                 return nullptr; // Invalid correct option
             }
-            correct_options.insert (index);
+            correct_options |= static_cast<unsigned char>(1u << index);
         }
 
         return std::make_shared<Question> (question_id, question_text, options, correct_options);
     }
-
-    long long timestamp_in_ms (std::chrono::system_clock::time_point tp)
-    {
-        return std::chrono::duration_cast<std::chrono::milliseconds>(
-            tp.time_since_epoch ())
-            .count ();
-    }
-
-    long long get_current_time_in_ms ()
-    {
-        return timestamp_in_ms (std::chrono::system_clock::now ());
-    }
 }
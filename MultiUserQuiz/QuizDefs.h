@@ -4,6 +4,27 @@
 #include <sstream>
 
 #define MAX_NUMBER_OF_CORRECT_OPTION        3
+#define MAX_BATCH_SIZE                      1000        // max questions / answers carried by one FETCH_QUESTIONS or SUBMIT_ANSWERS
+#define DEFAULT_COMPRESSION_THRESHOLD       256         // bytes - smaller websocket payloads are not worth deflating
+#define DEFAULT_SEND_BUFFER_BYTES           (64 * 1024) // bytes a connection may have in flight before we start queueing
+#define DEFAULT_SEND_QUEUE_BYTES            (256 * 1024)// bytes a connection may have queued before it is evicted
+#define DEFAULT_SLOW_CONSUMER_TIMEOUT_MS    10000       // how long a connection may keep a backlog before it is evicted
+#define DEFAULT_HANDSHAKE_RATE              0           // websocket handshakes admitted per second, 0 = unlimited
+#define DEFAULT_LOGIN_RATE                  0           // LOGIN commands admitted per second, 0 = unlimited
+#define DEFAULT_RESUME_TOKEN_TTL_SEC        900         // how long a LOGIN_OK resume token can be used to RESUME
+#define DEFAULT_LEADERBOARD_TOP             10          // entries returned when LEADERBOARD does not say
+#define MAX_LEADERBOARD_TOP                 100         // cap on the entries one LEADERBOARD response / push carries
+#define DEFAULT_LEADERBOARD_PUSH_INTERVAL_MS 1000       // min gap between two leaderboard pushes to subscribers
+#define DEFAULT_ANALYTICS_FILE              "item_analytics.csv"    // per question statistics written at quiz end
+#define DEFAULT_RESULTS_FILE                "quiz_results.muqr"     // every user's final result, columnar
+#define DEFAULT_ARCHIVE_FILE                "quiz_users.muqa"       // finished users moved out of memory after an export
+#define DEFAULT_QUESTION_BANK_FILE          "QuizBank.xlsx"
+#define DEFAULT_BANK_WATCH_INTERVAL_MS      0           // how often the bank file is checked for changes, 0 = only on RELOAD_BANK
+#define DEFAULT_REACTOR_SHARDS              1           // 1 = one reactor shared by every io thread, 0 = one reactor per hardware thread
+#define DEFAULT_HASH_THREADS                0           // password hashing threads, 0 = half the hardware threads
+#define DEFAULT_HASH_QUEUE_LIMIT            512         // logins waiting for a hashing thread before LOGIN is told to retry
+#define DEFAULT_CREDENTIAL_CACHE_TTL_SEC    300         // how long a verified password lets the same user in without hashing
+#define CLOCK_TICK_MS                       5           // resolution of QuizClock on the server - how stale a timing check may be
 
 enum eQuizMode {
     BULLET_TIMER_MODE,          // User has limited time per question
@@ -23,6 +44,7 @@ enum eQuesAttemptStatus {
 namespace QuizHelper {
 
     eQuesAttemptStatus ValidateUserAnswer               (const Answer & ans);
+    eQuesAttemptStatus ValidateUserAnswer               (const Answer & ans, unsigned char correct_opts);
 
     std::shared_ptr<Question> MakeQuestionFromExcelRow  (const std::string & question_number_str,
                                                          const std::string & question_text, 
@@ -31,8 +53,4 @@ namespace QuizHelper {
                                                          const std::string & option_c, 
                                                          const std::string & option_d, 
                                                          const std::string & correct_options_str);
-
-    long long           timestamp_in_ms                 (std::chrono::system_clock::time_point tp);
-    
-    long long           get_current_time_in_ms          ();
 }
\ No newline at end of file
@@ -249,17 +249,29 @@ bool QuizMgr::InitializeQuizConfigs ()
         return false;
     }
 
+    // Apply logging settings before anything starts logging from the I/O threads
+    Logger & logger = Logger::GetInstance ();
+    logger.SetLevel (config.GetLogLevel ());
+    logger.SetFormat (config.GetLogFormat ());
+
+    if (!logger.SetOutputFile (config.GetLogFile ())) {
+        std::cerr << "Could not open log file: " << config.GetLogFile () << ", logging to stdout." << std::endl;
+    }
+
     return true;
 }
 
-bool QuizMgr::InitializeQuestionBank (const std::string & excelFileName)
+/*
+* Parses the excel file into a snapshot that is not published yet - used at startup and for a live reload,
+* where the current bank keeps serving until the new one is complete.
+*/
+bool QuizMgr::LoadQuestionBank (const std::string & excelFileName, QuestionBank::Snapshot & snapshot)
 {
     xlnt::workbook  wb;
-    QuestionBank &  qb = QuestionBank::GetInstance ();
 
     try {
 
-        wb.load ("QuizBank.xlsx");
+        wb.load (excelFileName);
 
         xlnt::worksheet ws = wb.active_sheet ();
 
@@ -295,18 +307,15 @@ bool QuizMgr::InitializeQuestionBank (const std::string & excelFileName)
                                                                                   option_d, correct_options);
 
                 if (ques) {
-                    // Add Question to Question Bank
-                    if (!qb.AddQuestionToBank (ques)) {
-                        std::cerr << "Failed to add question to bank." << std::endl;
-                        return false;
-                    }
+                    // Add Question to the snapshot
+                    snapshot.AddQuestion (ques);
 
                 } else {
                     std::cerr << "Failed to create question from row." << std::endl;
                     return false;
                 }
             }
-            // 'ques' is now out of scope, only the QuestionBank holds it
+            // 'ques' is now out of scope, only the snapshot holds it
         }
 
     } catch (const std::exception & e) {
@@ -316,6 +325,21 @@ bool QuizMgr::InitializeQuestionBank (const std::string & excelFileName)
         return false;
     }
 
+    return true;
+}
+
+bool QuizMgr::InitializeQuestionBank (const std::string & excelFileName)
+{
+    QuestionBank &  qb = QuestionBank::GetInstance ();
+    auto            snapshot = std::make_shared<QuestionBank::Snapshot> ();
+
+    if (!LoadQuestionBank (excelFileName, *snapshot)) {
+        return false;
+    }
+
+    // the whole bank goes live in one step
+    qb.PublishSnapshot (snapshot);
+
     // Mark Question Bank as initialized
     qb.SetQuestionBankInitialized (true);
 
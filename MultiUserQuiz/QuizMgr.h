@@ -31,6 +31,7 @@ class QuizMgr {
                 void        CreateNewUser           ();
                 bool        InitializeQuizConfigs   ();
                 bool        InitializeQuestionBank  (const std::string & excelFileName);
+    static      bool        LoadQuestionBank        (const std::string & excelFileName, QuestionBank::Snapshot & snapshot);
                 Answer      WaitForUserAnswer       (unsigned int pQuesId);
                 void        OnTimerExpired          ();
 
@@ -1,6 +1,7 @@
 #include "Result.h"
 #include "../Config/QuizConfig.h"
 
+std::function<void (const AnswerTransition &)> Result::transitionObserver;
 
 Result::Result () : vTotalTimeElapsed (0), 
                     vTotalTimeLimit (0),
@@ -42,11 +43,15 @@ long long Result::GetTimeElapsedInQuiz () const
     return vTotalTimeElapsed;
 }
 
-std::vector<unsigned int> Result::GetUnattemptedQuestionIds () const
+void Result::Reserve (unsigned int questionCount)
 {
-    std::vector<unsigned int> unattempted;
+    attempt_map.reserve (questionCount);
+    tracker_map.reserve (questionCount);
+}
 
-    const auto totalQuestions = QuestionBank::GetInstance ().TotalQuestionCount ();
+std::vector<unsigned int> Result::GetUnattemptedQuestionIds (unsigned int totalQuestions) const
+{
+    std::vector<unsigned int> unattempted;
 
     for (unsigned int id = 1; id <= totalQuestions; ++id) {
 
@@ -60,10 +65,124 @@ std::vector<unsigned int> Result::GetUnattemptedQuestionIds () const
     return unattempted;
 }
 
-eQuesAttemptStatus Result::AddAnswer (Answer & ans)
+/*
+* { "score", "elapsed", "limit", "attempts": [ { "id", "status", "options": [idx..] } ] }
+* Scores are stored as is rather than re-graded, so a restart never changes a user's result.
+*/
+nlohmann::json Result::Serialize () const
+{
+    nlohmann::json attempts = nlohmann::json::array ();
+
+    for (const auto & [quesId, status] : tracker_map) {
+
+        nlohmann::json options = nlohmann::json::array ();
+        auto it = attempt_map.find (quesId);
+        if (it != attempt_map.end ()) {
+            array<bool, 4> selected = it->second.GetSelectedOp ();
+            for (int i = 0; i < 4; ++i) {
+                if (selected[i]) {
+                    options.push_back (i);
+                }
+            }
+        }
+
+        attempts.push_back ({{"id", quesId}, {"status", static_cast<int>(status)}, {"options", options}});
+    }
+
+    return {
+        {"score", vCurrScore},
+        {"elapsed", vTotalTimeElapsed},
+        {"limit", vTotalTimeLimit},
+        {"attempts", attempts}
+    };
+}
+
+void Result::Restore (const nlohmann::json & state)
+{
+    vCurrScore = state.value ("score", 0.0);
+    vTotalTimeElapsed = state.value ("elapsed", 0LL);
+    vTotalTimeLimit = state.value ("limit", 0LL);
+
+    attempt_map.clear ();
+    tracker_map.clear ();
+
+    for (const auto & attempt : state.value ("attempts", nlohmann::json::array ())) {
+
+        unsigned int quesId = attempt.value ("id", 0u);
+        eQuesAttemptStatus status = static_cast<eQuesAttemptStatus>(attempt.value ("status", static_cast<int>(UNATTEMPTED)));
+
+        if (status != UNATTEMPTED) {
+            Answer ans (quesId);
+            for (int op : attempt.value ("options", std::vector<int>{})) {
+                ans.SetSelectedOp (op);
+            }
+            attempt_map[quesId] = ans;
+        }
+        tracker_map[quesId] = status;
+    }
+}
+
+void Result::ExportColumns (size_t userIndex, size_t userCount, unsigned int questionCount,
+                            unsigned char * statusColumns, unsigned char * maskColumns) const
+{
+    // only the attempted questions are touched, the caller pre fills the columns with UNATTEMPTED
+    for (const auto & [quesId, status] : tracker_map) {
+
+        if (quesId == 0 || quesId > questionCount) {
+            continue;
+        }
+
+        size_t cell = (quesId - 1) * userCount + userIndex;
+        statusColumns[cell] = static_cast<unsigned char>(status);
+
+        auto it = attempt_map.find (quesId);
+        if (it != attempt_map.end ()) {
+            array<bool, 4> selected = it->second.GetSelectedOp ();
+            unsigned char mask = 0;
+            for (int i = 0; i < 4; ++i) {
+                if (selected[i]) {
+                    mask |= static_cast<unsigned char>(1 << i);
+                }
+            }
+            maskColumns[cell] = mask;
+        }
+    }
+}
+
+eQuesAttemptStatus Result::AddAnswer (Answer & ans, const QuestionBank::Snapshot & bank)
+{
+    return RecordAnswer (ans, QuizHelper::ValidateUserAnswer (ans, bank.GetCorrectOptionsById (ans.GetQuestionId ())));
+}
+
+/*
+* Grades a whole batch against answer keys fetched from the question bank in one go,
+* then records them in order - so a later answer to the same question wins, like separate submits.
+*/
+std::vector<eQuesAttemptStatus> Result::AddAnswers (std::vector<Answer> & answers, const QuestionBank::Snapshot & bank)
+{
+        std::vector<unsigned int>           quesIds;
+        std::vector<eQuesAttemptStatus>     statuses;
+
+    quesIds.reserve (answers.size ());
+    statuses.reserve (answers.size ());
+
+    for (const Answer & ans : answers) {
+        quesIds.push_back (ans.GetQuestionId ());
+    }
+
+    std::vector<unsigned char> correctOpts = bank.GetCorrectOptionsByIds (quesIds);
+
+    for (size_t i = 0; i < answers.size (); ++i) {
+        statuses.push_back (RecordAnswer (answers[i], QuizHelper::ValidateUserAnswer (answers[i], correctOpts[i])));
+    }
+
+    return statuses;
+}
+
+eQuesAttemptStatus Result::RecordAnswer (Answer & ans, eQuesAttemptStatus newStatus)
 {
         unsigned int quesId = ans.GetQuestionId ();
-        eQuesAttemptStatus newStatus = QuizHelper::ValidateUserAnswer (ans);
+        AnswerTransition transition {quesId, UNATTEMPTED, newStatus, {}, ans.GetSelectedOp (), 0};
 
     auto it = tracker_map.find (quesId);
 
@@ -83,8 +202,16 @@ eQuesAttemptStatus Result::AddAnswer (Answer & ans)
             case PARTIALLY_CORRECT:  vCurrScore -= partialReward; break;
             default: break;
         }
+
+        transition.oldStatus = it->second;
+        auto attemptIt = attempt_map.find (quesId);
+        if (attemptIt != attempt_map.end ()) {
+            transition.oldOptions = attemptIt->second.GetSelectedOp ();
+        }
     }
 
+    transition.restScore = vCurrScore;
+
     // Apply new score based on new status
     switch (newStatus) {
         case CORRECT:            vCurrScore += correctReward; break;
@@ -101,9 +228,18 @@ eQuesAttemptStatus Result::AddAnswer (Answer & ans)
     // Always record status
     tracker_map[quesId] = newStatus;
 
+    if (transitionObserver) {
+        transitionObserver (transition);
+    }
+
     return newStatus;
 }
 
+void Result::SetTransitionObserver (std::function<void (const AnswerTransition &)> observer)
+{
+    transitionObserver = observer;
+}
+
 double Result::GetCurrentScore () const
 {
     return vCurrScore;
@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <functional>
 #include <vector>
 #include <unordered_map>
 #include "../Answer/Answer.h"
@@ -7,6 +8,19 @@
 
 using namespace std;
 
+/*
+* One recorded change of a user's answer to a question - what the answer was, what it is now
+* and the user's score without this question. Reported to the transition observer, if any.
+*/
+struct AnswerTransition {
+    unsigned int                quesId;
+    eQuesAttemptStatus          oldStatus;          // UNATTEMPTED for a first answer
+    eQuesAttemptStatus          newStatus;
+    array<bool, 4>              oldOptions;
+    array<bool, 4>              newOptions;
+    double                      restScore;
+};
+
 /*
 * Result class serves as storage of the result and also keeps score
 * and the attempted answers gets recorded here.
@@ -21,7 +35,9 @@ public:
                                 Result                  ();
                                 ~Result                 ();
 
-    eQuesAttemptStatus          AddAnswer               (Answer & ans);
+    // graded against the given version of the bank, see User::PinQuestionBank
+    eQuesAttemptStatus          AddAnswer               (Answer & ans, const QuestionBank::Snapshot & bank);
+    std::vector<eQuesAttemptStatus> AddAnswers          (std::vector<Answer> & answers, const QuestionBank::Snapshot & bank);
     double                      GetCurrentScore         () const;
 
     void                        PrintFinalResult        (bool pShowDetailedResult) const;
@@ -32,10 +48,30 @@ public:
     void                        AddToElapsedTime        (long long pTimeElapsedMs);
     long long                   GetTimeElapsedInQuiz    () const;
 
-    std::vector<unsigned int>   GetUnattemptedQuestionIds () const;
+    std::vector<unsigned int>   GetUnattemptedQuestionIds (unsigned int totalQuestions) const;
+
+    // no rehash while the exam is answered
+    void                        Reserve                 (unsigned int questionCount);
+
+    // persistence - used to hand the user state over to a restarted server
+    nlohmann::json              Serialize               () const;
+    void                        Restore                 (const nlohmann::json & state);
+
+    // called for every answer that changes what is recorded, from the grading thread.
+    // Install once at startup before any answer is graded - it is not guarded by a lock.
+    static void                 SetTransitionObserver   (std::function<void (const AnswerTransition &)> observer);
+
+    // bulk export - writes status / option mask (bit i = option i) of question q to column q at userIndex,
+    // columns are questionCount long arrays of userCount entries each. Unanswered cells are left alone.
+    void                        ExportColumns           (size_t userIndex, size_t userCount, unsigned int questionCount,
+                                                         unsigned char * statusColumns, unsigned char * maskColumns) const;
 
 private:
 
+    eQuesAttemptStatus          RecordAnswer            (Answer & ans, eQuesAttemptStatus newStatus);
+
+    static std::function<void (const AnswerTransition &)> transitionObserver;
+
     // Store attempted answer and map question id to selected answer
     unordered_map <unsigned int, Answer> attempt_map;
     // Store question id and its status
@@ -0,0 +1,144 @@
+// AnswerJournal.cpp
+#include "AnswerJournal.hpp"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "Logger.h"
+
+static const char * LOG_COMPONENT = "AnswerJournal";
+
+AnswerJournal::~AnswerJournal ()
+{
+    Close ();
+}
+
+bool AnswerJournal::Open (const std::string & path)
+{
+    if (file) {
+        return true;
+    }
+
+    file = std::fopen (path.c_str (), "ab");
+    if (!file) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Could not open answer journal %s", path.c_str ());
+        return false;
+    }
+
+    is_stopping = false;
+    writer = std::thread (&AnswerJournal::WriteLoop, this);
+    QUIZ_LOG_INFO (LOG_COMPONENT, "Journaling answers to %s", path.c_str ());
+    return true;
+}
+
+void AnswerJournal::Close ()
+{
+    {
+        std::lock_guard<std::mutex> lock (pending_mutex);
+        is_stopping = true;
+    }
+    pending_cv.notify_all ();
+
+    if (writer.joinable ()) {
+        writer.join ();
+    }
+    if (file) {
+        std::fclose (file);
+        file = nullptr;
+    }
+}
+
+void AnswerJournal::Commit (std::string record, std::function<void (bool)> on_done)
+{
+    {
+        std::lock_guard<std::mutex> lock (pending_mutex);
+        if (!is_stopping && file) {
+            pending.push_back ({std::move (record), std::move (on_done)});
+            pending_cv.notify_one ();
+            return;
+        }
+    }
+
+    // nothing will write it any more
+    on_done (false);
+}
+
+Await<bool> AnswerJournal::Commit (std::string record)
+{
+    return Await<bool> ([this, record = std::move (record)] (Await<bool>::Resume resume) mutable {
+        Commit (std::move (record), std::move (resume));
+    });
+}
+
+void AnswerJournal::Truncate ()
+{
+    std::lock_guard<std::mutex> lock (pending_mutex);
+    if (!is_stopping && file) {
+        pending.push_back ({std::string (), [] (bool) { }, true});
+        pending_cv.notify_one ();
+    }
+}
+
+void AnswerJournal::WriteLoop ()
+{
+    std::vector<PendingRecord> batch;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock (pending_mutex);
+            pending_cv.wait (lock, [this] () { return is_stopping || !pending.empty (); });
+            if (pending.empty ()) {
+                return;
+            }
+            // everything that queued up during the previous sync goes out in this one
+            batch.swap (pending);
+        }
+
+        bool is_durable = WriteBatch (batch);
+        for (auto & entry : batch) {
+            entry.on_done (is_durable);
+        }
+        batch.clear ();
+    }
+}
+
+bool AnswerJournal::WriteBatch (const std::vector<PendingRecord> & batch)
+{
+    for (const auto & entry : batch) {
+        if (entry.is_truncate) {
+            // appends go on from the new end, the start of the file
+            if (std::fflush (file) != 0 ||
+#ifdef _WIN32
+                _chsize_s (_fileno (file), 0) != 0) {
+#else
+                ftruncate (fileno (file), 0) != 0) {
+#endif
+                QUIZ_LOG_ERROR (LOG_COMPONENT, "Answer journal truncate failed");
+                return false;
+            }
+            continue;
+        }
+        if (std::fwrite (entry.record.data (), 1, entry.record.size (), file) != entry.record.size () ||
+            std::fputc ('\n', file) == EOF) {
+            QUIZ_LOG_ERROR (LOG_COMPONENT, "Answer journal write failed");
+            return false;
+        }
+    }
+
+    if (std::fflush (file) != 0) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Answer journal flush failed");
+        return false;
+    }
+
+#ifdef _WIN32
+    int sync_result = _commit (_fileno (file));
+#else
+    int sync_result = fsync (fileno (file));
+#endif
+    if (sync_result != 0) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Answer journal sync failed");
+        return false;
+    }
+    return true;
+}
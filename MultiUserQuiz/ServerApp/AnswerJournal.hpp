@@ -0,0 +1,64 @@
+// AnswerJournal.hpp
+#pragma once
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HandlerTask.hpp"
+
+/*
+* Write ahead log of the running exam - one json line per START_QUIZ (the user's exam setup) and per
+* SUBMIT_ANSWER, an answer on disk before it is graded and acknowledged. After a crash the next start
+* replays the file (QuizController::RecoverFromJournal), so no answer a client was told about is lost.
+* Once the exam has ended and its results are exported the file is emptied again.
+*
+* Commits are grouped: a writer thread takes everything queued since its last round, writes it and syncs
+* the file once for the whole batch. A slow disk then costs latency per answer but not throughput, as long
+* as the handlers waiting on it do not hold a thread - see QuizController::SubmitAnswerAsync.
+*/
+class AnswerJournal {
+
+    struct PendingRecord {
+        std::string record;
+        std::function<void (bool)> on_done;
+        bool is_truncate = false;
+    };
+
+    std::FILE * file = nullptr;
+    std::thread writer;
+
+    std::mutex pending_mutex;
+    std::condition_variable pending_cv;
+    std::vector<PendingRecord> pending;
+    bool is_stopping = false;
+
+    void WriteLoop ();
+    bool WriteBatch (const std::vector<PendingRecord> & batch);
+
+public:
+    AnswerJournal () = default;
+    ~AnswerJournal ();
+
+    AnswerJournal (const AnswerJournal &) = delete;
+    AnswerJournal & operator= (const AnswerJournal &) = delete;
+
+    // appends to path, false when it cannot be opened
+    bool Open (const std::string & path);
+
+    // commits what is queued and stops the writer
+    void Close ();
+
+    bool IsOpen () const { return file != nullptr; }
+
+    // on_done (is_durable) runs on the writer thread once the record is synced, or could not be
+    void Commit (std::string record, std::function<void (bool)> on_done);
+
+    // co_await form of the above - the handler resumes through its task's executor
+    Await<bool> Commit (std::string record);
+
+    // empties the file once everything queued before is written - the exam it covered is over
+    void Truncate ();
+};
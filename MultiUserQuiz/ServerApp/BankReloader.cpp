@@ -0,0 +1,141 @@
+// BankReloader.cpp
+#include "BankReloader.hpp"
+#include <chrono>
+#include <filesystem>
+#include "ItemAnalytics.hpp"
+#include "SessionManager.hpp"
+#include "../QuizMgr.h"
+#include "Logger.h"
+
+static const char * LOG_COMPONENT = "BankReloader";
+
+std::unique_ptr<BankReloader> BankReloader::instance = nullptr;
+std::mutex BankReloader::instance_mutex;
+
+BankReloader & BankReloader::GetInstance ()
+{
+    std::lock_guard<std::mutex> lock (instance_mutex);
+    if (!instance) {
+        instance = std::unique_ptr<BankReloader> (new BankReloader ());
+    }
+    return *instance;
+}
+
+BankReloader::~BankReloader ()
+{
+    Stop ();
+}
+
+bool BankReloader::RequestReload (const std::string & path, ReloadCallback on_done)
+{
+    std::lock_guard<std::mutex> lock (reload_mutex);
+
+    if (is_reloading.exchange (true)) {
+        return false;
+    }
+
+    // the previous reload is finished, only its thread is left to collect
+    if (worker.joinable ()) {
+        worker.join ();
+    }
+
+    worker = std::thread ([this, path, on_done = std::move (on_done)] () {
+        Reload (path, on_done);
+        is_reloading.store (false);
+    });
+    return true;
+}
+
+void BankReloader::Reload (const std::string & path, const ReloadCallback & on_done)
+{
+    ReloadResult result {false, path, "", 0, 0, {}, 0, 0};
+    QuestionBank & qb = QuestionBank::GetInstance ();
+
+    // parse off to the side - readers keep using the current snapshot meanwhile
+    auto started = std::chrono::steady_clock::now ();
+    auto next = std::make_shared<QuestionBank::Snapshot> ();
+    bool is_parsed = QuizMgr::LoadQuestionBank (path, *next);
+    result.parse_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now () - started).count ();
+
+    if (!is_parsed || next->TotalQuestionCount () == 0) {
+        result.error = is_parsed ? "Question bank is empty" : "Question bank could not be parsed";
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Reload of %s failed: %s", path.c_str (), result.error.c_str ());
+        if (on_done) {
+            on_done (result);
+        }
+        return;
+    }
+
+    result.question_count = next->TotalQuestionCount ();
+    result.diff = qb.PublishSnapshot (next);
+    result.version = next->version;
+    result.is_ok = true;
+
+    // nothing but wording changed - the fix reaches the running exams too. Otherwise the ids now stand
+    // for other questions or keys, the item statistics of the old ones would mix in.
+    if (result.diff.IsTextOnly ()) {
+        for (const auto & user : SessionManager::GetInstance ().GetAllUsers ()) {
+            if (user->GetQuestionBank ()->version == result.version - 1) {
+                user->PinQuestionBank (next);
+                ++result.repinned;
+            }
+        }
+    } else {
+        ItemAnalytics::GetInstance ().Reset ();
+    }
+
+    QUIZ_LOG_INFO (LOG_COMPONENT, "Question bank v%llu published from %s in %lld ms: %u questions, %zu reworded, %zu new keys, %zu added, %zu removed, %zu exams moved over",
+                   result.version, path.c_str (), result.parse_ms, result.question_count, result.diff.text_changed.size (),
+                   result.diff.key_changed.size (), result.diff.added.size (), result.diff.removed.size (), result.repinned);
+
+    if (on_done) {
+        on_done (result);
+    }
+}
+
+void BankReloader::StartWatch (const std::string & path, long long interval_ms)
+{
+    std::lock_guard<std::mutex> lock (watch_mutex);
+    if (watcher.joinable () || interval_ms <= 0) {
+        return;
+    }
+    watcher = std::thread (&BankReloader::WatchLoop, this, path, interval_ms);
+}
+
+void BankReloader::WatchLoop (std::string path, long long interval_ms)
+{
+    std::error_code ec;
+    auto last_write = std::filesystem::last_write_time (path, ec);
+
+    std::unique_lock<std::mutex> lock (watch_mutex);
+    while (!watch_cv.wait_for (lock, std::chrono::milliseconds (interval_ms), [this] { return is_stopping; })) {
+
+        auto write_time = std::filesystem::last_write_time (path, ec);
+        if (ec || write_time == last_write) {
+            continue;
+        }
+
+        // a refused request (reload still running) is retried on the next tick
+        if (RequestReload (path, nullptr)) {
+            last_write = write_time;
+        }
+    }
+}
+
+void BankReloader::Stop ()
+{
+    {
+        std::lock_guard<std::mutex> lock (watch_mutex);
+        is_stopping = true;
+    }
+    watch_cv.notify_all ();
+
+    if (watcher.joinable ()) {
+        watcher.join ();
+    }
+
+    std::lock_guard<std::mutex> lock (reload_mutex);
+    if (worker.joinable ()) {
+        worker.join ();
+    }
+}
@@ -0,0 +1,69 @@
+// BankReloader.hpp
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "QuestionBank.h"
+
+/*
+* Live reload of the question bank - on the admin's RELOAD_BANK or when the watched file changes.
+*
+* The file is parsed on a worker thread into a new snapshot while the current one keeps serving,
+* then published in one pointer swap. Running exams are pinned to the snapshot they started on, so
+* their ids and answer keys never change under them:
+*
+*   wording only (typo fixes)      the pins move forward - every user sees the fix right away
+*   answer keys, added / removed   the pins stay - running exams finish on their version, new ones get the new bank
+*
+* One reload at a time, a request while one is running is refused.
+*/
+class BankReloader {
+
+public:
+    struct ReloadResult {
+        bool is_ok;
+        std::string file;
+        std::string error;
+        unsigned long long version;         // of the published snapshot
+        unsigned int question_count;
+        QuestionBank::Diff diff;
+        size_t repinned;                    // running exams moved onto the new snapshot
+        long long parse_ms;
+    };
+
+    using ReloadCallback = std::function<void (const ReloadResult &)>;
+
+private:
+    static std::unique_ptr<BankReloader> instance;
+    static std::mutex instance_mutex;
+
+    std::mutex reload_mutex;                // guards worker
+    std::thread worker;
+    std::atomic<bool> is_reloading {false};
+
+    std::mutex watch_mutex;
+    std::condition_variable watch_cv;
+    std::thread watcher;
+    bool is_stopping = false;
+
+    BankReloader () = default;
+
+    void Reload (const std::string & path, const ReloadCallback & on_done);
+    void WatchLoop (std::string path, long long interval_ms);
+
+public:
+    ~BankReloader ();
+
+    static BankReloader & GetInstance ();
+
+    // false when a reload is already running
+    bool RequestReload (const std::string & path, ReloadCallback on_done);
+
+    // polls the file's modification time and reloads when it changes
+    void StartWatch (const std::string & path, long long interval_ms);
+    void Stop ();
+};
@@ -1,17 +1,43 @@
 // ConnectionManager.cpp
 #include "ConnectionManager.hpp"
-#include <iostream>
+#include "Logger.h"
+#include "QuizClock.h"
+
+static const char * LOG_COMPONENT = "ConnectionManager";
+
+#define SEND_PUMP_INTERVAL_MS           20          // how often backlogged connections are retried
+#define SEND_STATS_LOG_INTERVAL_MS      10000
+#define HANDOFF_TIMEOUT_MS              30000       // how long a new process waits for the old one to drain
+#define DRAIN_CLOSE_TIMEOUT_MS          5000        // how long the old process waits for its clients to go
+#define DRAIN_RETRY_AFTER_MS            250         // Retry-After handed out while no process admits
+#define DRAIN_EXIT_DELAY_MS             100         // lets the handover reply go out before the io threads stop
+#define TLS_SESSION_CACHE_SIZE          20480       // one per seat of a full exam hall, with room to spare
+#define TLS_CIPHER_LIST                 "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:" \
+                                        "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:" \
+                                        "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:" \
+                                        "HIGH:!aNULL:!MD5:!RC4:!3DES"
 
 ConnectionManager::ConnectionManager ()
-    : quiz_controller (std::make_unique<QuizController> ())
-{ }
+    : quiz_controller (std::make_unique<QuizController> ()),
+    send_buffer_bytes (DEFAULT_SEND_BUFFER_BYTES),
+    send_queue_bytes (DEFAULT_SEND_QUEUE_BYTES),
+    slow_consumer_timeout_ms (DEFAULT_SLOW_CONSUMER_TIMEOUT_MS),
+    last_stats_log_ms (0),
+    leaderboard_push_interval_ms (DEFAULT_LEADERBOARD_PUSH_INTERVAL_MS)
+{
+    // server pushes (quiz timeouts etc) are coalesced per type - only the latest status matters to a slow client
+    SessionManager::GetInstance ().SetNotifier ([this] (connection_hdl hdl, const std::string & message) {
+        std::string notification = json ({{"type", "NOTIFICATION"}, {"event", message}}).dump ();
+        Send (hdl, notification, "NOTIFICATION");
+    });
+}
 
 ConnectionManager::~ConnectionManager ()
 {
     StopServer ();
 }
 
-std::shared_ptr<asio::ssl::context> ConnectionManager::OnTlsInit (connection_hdl hdl)
+std::shared_ptr<asio::ssl::context> ConnectionManager::BuildTlsContext ()
 {
     auto ctx = std::make_shared<asio::ssl::context> (asio::ssl::context::tlsv12);
     try {
@@ -23,76 +49,720 @@ std::shared_ptr<asio::ssl::context> ConnectionManager::OnTlsInit (connection_hdl
         ctx->use_certificate_chain_file ("server.crt");
         ctx->use_private_key_file ("server.key", asio::ssl::context::pem);
 
-        std::cout << "TLS init succeeded." << std::endl;
+        // AEAD suites first and in our order - AES-GCM runs on AES-NI, ChaCha20 is for clients without it
+        SSL_CTX * native = ctx->native_handle ();
+        SSL_CTX_set_options (native, SSL_OP_CIPHER_SERVER_PREFERENCE);
+        if (!SSL_CTX_set_cipher_list (native, TLS_CIPHER_LIST)) {
+            QUIZ_LOG_WARN (LOG_COMPONENT, "Cipher list rejected, using the OpenSSL defaults");
+        }
+
+        // resumed sessions skip the key exchange - a reconnect storm after a network blip stays cheap
+        SSL_CTX_set_session_cache_mode (native, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size (native, TLS_SESSION_CACHE_SIZE);
+
+        QUIZ_LOG_DEBUG (LOG_COMPONENT, "TLS init succeeded.");
     } catch (std::exception & e) {
-        std::cout << "TLS init failed: " << e.what () << std::endl;
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "TLS init failed: %s", e.what ());
+    }
+
+    /*
+    * Kernel TLS would need OpenSSL 3 (SSL_OP_ENABLE_KTLS) and a socket BIO, but we link 1.1.1 and
+    * asio's ssl stream feeds OpenSSL through memory BIOs, so the keys never reach the socket.
+    * The option is accepted and reported, records stay in userspace.
+    */
+    if (QuizConfig::GetInstance ().IsKernelTlsEnabled ()) {
+        QUIZ_LOG_WARN (LOG_COMPONENT, "KernelTls requested but not available with %s over asio streams, "
+                       "TLS records stay in userspace", OpenSSL_version (OPENSSL_VERSION));
     }
     return ctx;
 }
 
+std::shared_ptr<asio::ssl::context> ConnectionManager::OnTlsInit (connection_hdl hdl)
+{
+    return tls_context;
+}
+
 void ConnectionManager::OnMessage (server * s, connection_hdl hdl, server::message_ptr msg)
+{
+    websocketpp::lib::error_code ec;
+    server::connection_ptr con = s->get_con_from_hdl (hdl, ec);
+    if (ec) {
+        return;
+    }
+
+    if (Logger::GetInstance ().IsEnabled (LOG_LEVEL_TRACE)) {
+        QUIZ_LOG_TRACE (LOG_COMPONENT, "[MESSAGE] From %s: %s",
+                        con->get_remote_endpoint ().c_str (), msg->get_payload ().c_str ());
+    }
+
+    // a suspended handler holds the connection's later requests back, responses keep the request order
+    bool is_over_budget = false;
+    {
+        std::lock_guard<std::mutex> lock (con->request_mutex);
+        if (con->is_request_pending) {
+            con->deferred_bytes += msg->get_payload ().size ();
+            is_over_budget = con->deferred_bytes > send_queue_bytes;
+            if (!is_over_budget) {
+                con->deferred_requests.push_back (msg->get_payload ());
+                return;
+            }
+        }
+    }
+
+    if (is_over_budget) {
+        EvictSlowConsumer (con, "too many requests queued behind a pending one");
+        return;
+    }
+
+    HandleRequest (con, hdl, msg->get_payload ());
+}
+
+bool ConnectionManager::HandleRequest (server::connection_ptr con, connection_hdl hdl, const std::string & payload)
 {
     try {
-#ifdef DEBUG
-        server::connection_ptr con = s->get_con_from_hdl (hdl);
-        std::string client_info = con->get_remote_endpoint ();
-        std::cout << "[MESSAGE] From " << client_info << ": " << msg->get_payload () << std::endl;
-#endif
+        // the per question traffic skips the json DOM, the rest (and anything odd) is parsed in full
+        std::string & response = ResponseWriter::ThreadBuffer ();
+        ResponseWriter writer (response);
+        HandlerTask task;
+        bool is_async;
 
-        json request = json::parse (msg->get_payload ());
-        json response = quiz_controller->ProcessRequest (hdl, request);
+        DecodedRequest decoded;
+        if (RequestDecoder::Decode (payload, decoded)) {
+            is_async = quiz_controller->ProcessRequestAsync (hdl, decoded, task);
+            if (!is_async) {
+                quiz_controller->ProcessRequest (hdl, decoded, writer);
+            }
+        } else {
+            json request = json::parse (payload);
+            is_async = quiz_controller->ProcessRequestAsync (hdl, request, task);
+            if (!is_async) {
+                quiz_controller->ProcessRequest (hdl, request, writer);
+            }
+        }
+
+        if (!is_async) {
+            Send (hdl, response);
+            return true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock (con->request_mutex);
+            con->is_request_pending = true;
+        }
 
-        s->send (hdl, response.dump (), websocketpp::frame::opcode::text);
+        // may finish right here (a rejected answer never waits), otherwise the journal writer or hashing thread
+        // that completes the wait only posts the rest of the handler to the connection's strand
+        task.Start ([this, con, hdl] (std::string & async_response, std::exception_ptr error) {
+            if (error) {
+                QUIZ_LOG_ERROR (LOG_COMPONENT, "Async handler failed");
+                std::string error_response = json ({{"type", "ERROR"}, {"message", "Internal server error"}}).dump ();
+                Send (hdl, error_response);
+            } else {
+                Send (hdl, async_response);
+            }
+            RunDeferred (con, hdl);
+        }, [con] (std::function<void ()> resume) {
+            con->get_strand ()->post (std::move (resume));
+        });
+        return false;
 
     } catch (const std::exception & e) {
-        std::cerr << "Message handling exception: " << e.what () << std::endl;
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Message handling exception: %s", e.what ());
+
+        std::string error_response = json ({{"type", "ERROR"}, {"message", "Internal server error"}}).dump ();
+        Send (hdl, error_response);
+    }
+    return true;
+}
+
+void ConnectionManager::RunDeferred (server::connection_ptr con, connection_hdl hdl)
+{
+    for (;;) {
+        std::string payload;
+        bool is_drained = false;
+        bool is_closed = false;
+        {
+            std::lock_guard<std::mutex> lock (con->request_mutex);
+            is_closed = con->is_closed;
+            if (is_closed || con->deferred_requests.empty ()) {
+                con->is_request_pending = false;
+                con->deferred_requests.clear ();
+                con->deferred_bytes = 0;
+                is_drained = true;
+            } else {
+                payload = std::move (con->deferred_requests.front ());
+                con->deferred_requests.pop_front ();
+                con->deferred_bytes -= payload.size ();
+            }
+        }
+
+        if (is_drained) {
+            // OnClose left the disconnect to this handler - it may have bound a session (LOGIN) meanwhile
+            if (is_closed) {
+                quiz_controller->OnDisconnect (hdl);
+            }
+            return;
+        }
+
+        // suspended again - that handler's completion picks up the rest
+        if (!HandleRequest (con, hdl, payload)) {
+            return;
+        }
+    }
+}
+
+void ConnectionManager::SendText (server::connection_ptr con, std::string & payload)
+{
+    // websocketpp only reads the payload to frame it into its own outgoing message, so it is lent for
+    // the send and taken back - the caller's buffer keeps its capacity and nothing is copied here
+    server::message_ptr msg = con->get_message (websocketpp::frame::opcode::text, 0);
+    msg->get_raw_payload ().swap (payload);
+
+    // set_compressed is only a request, websocketpp ignores it when the peer did not negotiate deflate
+    bool is_deflated = con->is_compression_enabled && msg->get_payload ().size () >= con->compression_threshold;
+    msg->set_compressed (is_deflated);
+    (is_deflated ? bytes_sent_deflated : bytes_sent_plain).fetch_add (msg->get_payload ().size (), std::memory_order_relaxed);
+
+    websocketpp::lib::error_code ec = con->send (msg);
+    msg->get_raw_payload ().swap (payload);
+    if (ec) {
+        QUIZ_LOG_WARN (LOG_COMPONENT, "Send failed: %s", ec.message ().c_str ());
+    }
+}
+
+/*
+* Sends straight through while the connection keeps up, queues once websocketpp holds more than
+* send_buffer_bytes for it. Queued messages go out in order from the pump timer.
+*/
+void ConnectionManager::Send (connection_hdl hdl, std::string & payload, const std::string & coalesce_key)
+{
+    websocketpp::lib::error_code ec;
+    server::connection_ptr con = ws_server.get_con_from_hdl (hdl, ec);
+    if (ec) {
+        QUIZ_LOG_DEBUG (LOG_COMPONENT, "Dropping message for closed connection: %s", ec.message ().c_str ());
+        return;
+    }
+
+    bool is_over_budget = false;
+    {
+        std::lock_guard<std::mutex> lock (con->send_mutex);
+        if (con->is_evicted) {
+            return;
+        }
+
+        if (con->send_queue.empty () && con->get_buffered_amount () < send_buffer_bytes) {
+            SendText (con, payload);
+            return;
+        }
+
+        if (!coalesce_key.empty ()) {
+            for (auto & queued : con->send_queue) {
+                if (queued.coalesce_key == coalesce_key) {
+                    long long delta = static_cast<long long>(payload.size ()) - static_cast<long long>(queued.payload.size ());
+                    con->queued_bytes += delta;
+                    queued_bytes.fetch_add (delta, std::memory_order_relaxed);
+                    queued.payload = payload;
+                    coalesced_total.fetch_add (1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+
+        if (con->send_queue.empty ()) {
+            con->backlog_since_ms = QuizClock::NowMs ();
+        }
+        con->send_queue.push_back ({payload, coalesce_key});
+        con->queued_bytes += payload.size ();
+        queued_messages.fetch_add (1, std::memory_order_relaxed);
+        queued_bytes.fetch_add (payload.size (), std::memory_order_relaxed);
+
+        is_over_budget = con->queued_bytes > send_queue_bytes;
+    }
+
+    if (is_over_budget) {
+        EvictSlowConsumer (con, "send queue over budget");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock (backlogged_mutex);
+    backlogged.insert (hdl);
+}
+
+// Moves queued messages to websocketpp while it is under budget. Returns true once the queue is empty.
+bool ConnectionManager::DrainQueue (server::connection_ptr con)
+{
+    std::lock_guard<std::mutex> lock (con->send_mutex);
 
-        json error_response = {{"type", "ERROR"}, {"message", "Internal server error"}};
-        s->send (hdl, error_response.dump (), websocketpp::frame::opcode::text);
+    while (!con->send_queue.empty () && con->get_buffered_amount () < send_buffer_bytes) {
+        auto & front = con->send_queue.front ();
+        SendText (con, front.payload);
+
+        con->queued_bytes -= front.payload.size ();
+        queued_messages.fetch_sub (1, std::memory_order_relaxed);
+        queued_bytes.fetch_sub (front.payload.size (), std::memory_order_relaxed);
+        con->send_queue.pop_front ();
+    }
+
+    if (con->send_queue.empty ()) {
+        con->backlog_since_ms = 0;
+        return true;
     }
+    return false;
+}
+
+void ConnectionManager::DiscardQueue (server::connection_ptr con)
+{
+    std::lock_guard<std::mutex> lock (con->send_mutex);
+
+    queued_messages.fetch_sub (static_cast<long long>(con->send_queue.size ()), std::memory_order_relaxed);
+    queued_bytes.fetch_sub (static_cast<long long>(con->queued_bytes), std::memory_order_relaxed);
+    con->send_queue.clear ();
+    con->queued_bytes = 0;
+    con->backlog_since_ms = 0;
+}
+
+void ConnectionManager::EvictSlowConsumer (server::connection_ptr con, const char * reason)
+{
+    {
+        std::lock_guard<std::mutex> lock (con->send_mutex);
+        if (con->is_evicted) {
+            return;
+        }
+        con->is_evicted = true;
+    }
+
+    DiscardQueue (con);
+    evicted_total.fetch_add (1, std::memory_order_relaxed);
+    QUIZ_LOG_WARN (LOG_COMPONENT, "Evicting slow consumer %s: %s", con->get_remote_endpoint ().c_str (), reason);
+
+    // 1013 tells the client to come back later, OnClose then runs the normal disconnect bookkeeping
+    websocketpp::lib::error_code ec;
+    con->close (websocketpp::close::status::try_again_later, "Slow consumer", ec);
+    if (ec) {
+        QUIZ_LOG_WARN (LOG_COMPONENT, "Close of slow consumer failed: %s", ec.message ().c_str ());
+    }
+}
+
+void ConnectionManager::SchedulePump ()
+{
+    if (is_stopping) {
+        return;
+    }
+    pump_timer = ws_server.set_timer (SEND_PUMP_INTERVAL_MS,
+                                      std::bind (&ConnectionManager::OnPumpTimer, this, std::placeholders::_1));
+}
+
+void ConnectionManager::OnPumpTimer (const websocketpp::lib::error_code & ec)
+{
+    if (ec || is_stopping) {
+        return;
+    }
+
+    std::vector<connection_hdl> pending;
+    {
+        std::lock_guard<std::mutex> lock (backlogged_mutex);
+        pending.assign (backlogged.begin (), backlogged.end ());
+    }
+
+    long long now_ms = QuizClock::NowMs ();
+    std::vector<connection_hdl> done;
+
+    for (auto & hdl : pending) {
+        websocketpp::lib::error_code con_ec;
+        server::connection_ptr con = ws_server.get_con_from_hdl (hdl, con_ec);
+        if (con_ec || DrainQueue (con)) {
+            done.push_back (hdl);
+            continue;
+        }
+
+        long long backlog_since_ms;
+        {
+            std::lock_guard<std::mutex> lock (con->send_mutex);
+            backlog_since_ms = con->backlog_since_ms;
+        }
+        if (backlog_since_ms && now_ms - backlog_since_ms > slow_consumer_timeout_ms) {
+            EvictSlowConsumer (con, "backlog not drained in time");
+            done.push_back (hdl);
+        }
+    }
+
+    if (!done.empty ()) {
+        std::lock_guard<std::mutex> lock (backlogged_mutex);
+        for (auto & hdl : done) {
+            backlogged.erase (hdl);
+        }
+    }
+
+    if (now_ms - last_stats_log_ms >= SEND_STATS_LOG_INTERVAL_MS) {
+        last_stats_log_ms = now_ms;
+        SendQueueStats stats = GetSendQueueStats ();
+        QUIZ_LOG (stats.backlogged_connections ? LOG_LEVEL_INFO : LOG_LEVEL_DEBUG, LOG_COMPONENT,
+                  "Send queues: %zu backlogged connections, %lld messages, %lld bytes, %llu coalesced, %llu evicted",
+                  stats.backlogged_connections, stats.queued_messages, stats.queued_bytes,
+                  stats.coalesced_total, stats.evicted_total);
+
+        MessagePool::Stats pool = MessagePool::GetStats ();
+        QUIZ_LOG_DEBUG (LOG_COMPONENT, "Message pool: %llu messages created, %llu freed", pool.created, pool.freed);
+    }
+
+    SchedulePump ();
+}
+
+void ConnectionManager::ScheduleLeaderboardPush ()
+{
+    if (is_stopping) {
+        return;
+    }
+    leaderboard_timer = ws_server.set_timer (leaderboard_push_interval_ms,
+                                             std::bind (&ConnectionManager::OnLeaderboardTimer, this, std::placeholders::_1));
+}
+
+void ConnectionManager::OnLeaderboardTimer (const websocketpp::lib::error_code & ec)
+{
+    if (ec || is_stopping) {
+        return;
+    }
+
+    Leaderboard & board = Leaderboard::GetInstance ();
+    unsigned long long version = board.GetVersion ();
+    std::vector<std::pair<std::string, size_t>> subscribers;
+
+    if (version != last_pushed_version) {
+        subscribers = board.GetSubscribers ();
+    }
+
+    if (!subscribers.empty ()) {
+        size_t max_k = 0;
+        for (const auto & subscriber : subscribers) {
+            max_k = std::max (max_k, subscriber.second);
+        }
+
+        // one walk of the tree for the largest k, every smaller k is a prefix of it
+        std::vector<Leaderboard::Entry> top = board.GetTop (max_k);
+        std::unordered_map<size_t, std::string> top_by_k;
+        size_t total = board.GetSize ();
+        SessionManager & session_mgr = SessionManager::GetInstance ();
+
+        for (const auto & [username, k] : subscribers) {
+            connection_hdl hdl;
+            if (!session_mgr.GetConnectionHandle (username, hdl)) {
+                continue;   // subscribed but not connected right now
+            }
+
+            std::string & top_json = top_by_k[k];
+            if (top_json.empty ()) {
+                std::vector<Leaderboard::Entry> prefix (top.begin (), top.begin () + std::min (k, top.size ()));
+                top_json = QuizController::BuildLeaderboardEntries (prefix).dump ();
+            }
+
+            unsigned int rank = 0;
+            size_t ignored_total;
+            board.GetRank (username, rank, ignored_total);
+
+            std::string payload = "{\"type\":\"LEADERBOARD\",\"version\":" + std::to_string (version) +
+                ",\"total\":" + std::to_string (total) + ",\"rank\":" + std::to_string (rank) +
+                ",\"top\":" + top_json + "}";
+            Send (hdl, payload, "LEADERBOARD");
+        }
+    }
+
+    last_pushed_version = version;
+    ScheduleLeaderboardPush ();
+}
+
+ConnectionManager::SendQueueStats ConnectionManager::GetSendQueueStats ()
+{
+    SendQueueStats stats;
+    {
+        std::lock_guard<std::mutex> lock (backlogged_mutex);
+        stats.backlogged_connections = backlogged.size ();
+    }
+    stats.queued_messages = queued_messages.load (std::memory_order_relaxed);
+    stats.queued_bytes = queued_bytes.load (std::memory_order_relaxed);
+    stats.coalesced_total = coalesced_total.load (std::memory_order_relaxed);
+    stats.evicted_total = evicted_total.load (std::memory_order_relaxed);
+    return stats;
+}
+
+void ConnectionManager::SetCompression (connection_hdl hdl, bool is_enabled, size_t threshold)
+{
+    websocketpp::lib::error_code ec;
+    server::connection_ptr con = ws_server.get_con_from_hdl (hdl, ec);
+    if (ec) {
+        return;
+    }
+
+    con->is_compression_enabled = is_enabled;
+    con->compression_threshold = threshold;
 }
 
 void ConnectionManager::OnOpen (server * s, connection_hdl hdl)
 {
     auto con = s->get_con_from_hdl (hdl);
-    std::string remote = con->get_remote_endpoint ();
-    std::cout << "[CONNECTED] " << remote << std::endl;
+    QuizConfig & cfg = QuizConfig::GetInstance ();
+
+    // an empty extensions header in our handshake response means the client did not offer deflate
+    con->is_compression_enabled = cfg.IsCompressionEnabled () &&
+                                  !con->get_response_header ("Sec-WebSocket-Extensions").empty ();
+    con->compression_threshold = cfg.GetCompressionThreshold ();
+
+    if (Logger::GetInstance ().IsEnabled (LOG_LEVEL_INFO)) {
+        QUIZ_LOG_INFO (LOG_COMPONENT, "[CONNECTED] %s%s", con->get_remote_endpoint ().c_str (),
+                       con->is_compression_enabled ? " (permessage-deflate)" : "");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock (open_connections_mutex);
+        open_connections.insert (hdl);
+    }
 
     quiz_controller->OnConnect (hdl);
 }
 
+/*
+* Runs before the websocket upgrade is accepted. Over the handshake rate the upgrade is refused with
+* 503 and a jittered Retry-After - seconds in the standard header, milliseconds in X-Retry-After-Ms
+* for our own client which reconnects on its own after that delay.
+*/
+bool ConnectionManager::OnValidate (server * s, connection_hdl hdl)
+{
+    long long retry_after_ms = DRAIN_RETRY_AFTER_MS;
+    if (is_admitting && handshake_bucket.TryAcquire (retry_after_ms)) {
+        return true;
+    }
+
+    retry_after_ms = TokenBucket::JitterRetryDelay (retry_after_ms);
+    handshakes_refused.fetch_add (1, std::memory_order_relaxed);
+
+    auto con = s->get_con_from_hdl (hdl);
+    con->set_status (websocketpp::http::status_code::service_unavailable);
+    con->append_header ("Retry-After", std::to_string ((retry_after_ms + 999) / 1000));
+    con->append_header ("X-Retry-After-Ms", std::to_string (retry_after_ms));
+
+    QUIZ_LOG_SAMPLED (LOG_LEVEL_INFO, 100, LOG_COMPONENT, "Handshake rate exceeded, refused %llu so far (retry after %lld ms)",
+                      handshakes_refused.load (), retry_after_ms);
+    return false;
+}
+
 void ConnectionManager::OnClose (server * s, connection_hdl hdl)
 {
     auto con = s->get_con_from_hdl (hdl);
-    std::string remote = con->get_remote_endpoint ();
-    std::cout << "[DISCONNECTED] " << remote << std::endl;
+    QUIZ_LOG_INFO (LOG_COMPONENT, "[DISCONNECTED] %s", con->get_remote_endpoint ().c_str ());
+
+    // whatever is still queued can never be delivered - release it now rather than with the connection object
+    DiscardQueue (con);
+    {
+        std::lock_guard<std::mutex> lock (backlogged_mutex);
+        backlogged.erase (hdl);
+    }
+
+    // requests queued behind a suspended handler never run, and while it is suspended the disconnect
+    // waits for it - it still works on the user (grading, a LOGIN binding the session)
+    bool is_request_pending;
+    {
+        std::lock_guard<std::mutex> lock (con->request_mutex);
+        con->is_closed = true;
+        con->deferred_requests.clear ();
+        con->deferred_bytes = 0;
+        is_request_pending = con->is_request_pending;
+    }
+    if (!is_request_pending) {
+        quiz_controller->OnDisconnect (hdl);
+    }
 
-    quiz_controller->OnDisconnect (hdl);
+    {
+        std::lock_guard<std::mutex> lock (open_connections_mutex);
+        open_connections.erase (hdl);
+    }
+    open_connections_cv.notify_all ();
+}
+
+/*
+* New process side of the handover - runs while this process already listens with admission closed.
+* Without a running server to take over from it just opens admission and starts fresh.
+*/
+void ConnectionManager::TakeOver ()
+{
+    QuizConfig & cfg = QuizConfig::GetInstance ();
+    long long started_ms = QuizClock::NowMs ();
+    std::string state_path;
+
+    if (ServerHandoff::RequestTakeover (cfg.GetHandoffSocket (), state_path, HANDOFF_TIMEOUT_MS)) {
+        if (quiz_controller->LoadState (state_path)) {
+            QUIZ_LOG_INFO (LOG_COMPONENT, "Took over from the previous server in %lld ms",
+                           QuizClock::NowMs () - started_ms);
+        } else {
+            QUIZ_LOG_ERROR (LOG_COMPONENT, "Could not load handed over state from %s", state_path.c_str ());
+        }
+    } else {
+        // nobody to take over from - the last server may have crashed mid exam
+        quiz_controller->RecoverFromJournal ();
+    }
+
+    is_admitting = true;
+    ServeHandoff ();
+}
+
+void ConnectionManager::ServeHandoff ()
+{
+    handoff.Serve (QuizConfig::GetInstance ().GetHandoffSocket (), [this] () {
+        std::string state_path = Drain ();
+
+        ws_server.set_timer (DRAIN_EXIT_DELAY_MS, [this] (const websocketpp::lib::error_code &) {
+            ForEachEndpoint ([] (server & endpoint) {
+                endpoint.stop ();
+            });
+        });
+        return state_path;
+    });
+}
+
+/*
+* Old process side - stop accepting (the new process already listens on the same port), send every
+* client away with 1012 so it reconnects to the new process, wait for the disconnect bookkeeping
+* to settle the users' elapsed time and only then persist them.
+*/
+std::string ConnectionManager::Drain ()
+{
+    long long started_ms = QuizClock::NowMs ();
+    is_admitting = false;
+    is_drained = true;
+
+    websocketpp::lib::error_code ec;
+    ForEachEndpoint ([&ec] (server & endpoint) {
+        endpoint.stop_listening (ec);
+    });
+
+    std::vector<connection_hdl> targets;
+    {
+        std::lock_guard<std::mutex> lock (open_connections_mutex);
+        targets.assign (open_connections.begin (), open_connections.end ());
+    }
+
+    for (auto & hdl : targets) {
+        ws_server.close (hdl, websocketpp::close::status::service_restart, "Server restarting", ec);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock (open_connections_mutex);
+        if (!open_connections_cv.wait_for (lock, std::chrono::milliseconds (DRAIN_CLOSE_TIMEOUT_MS),
+                                           [this] () { return open_connections.empty (); })) {
+            QUIZ_LOG_WARN (LOG_COMPONENT, "%zu connections still open after drain timeout", open_connections.size ());
+        }
+    }
+
+    std::string state_path = QuizConfig::GetInstance ().GetStateFile ();
+    if (!quiz_controller->SaveState (state_path)) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Could not persist users to %s", state_path.c_str ());
+    }
+
+    QUIZ_LOG_INFO (LOG_COMPONENT, "Drained %zu connections in %lld ms", targets.size (),
+                   QuizClock::NowMs () - started_ms);
+    return state_path;
+}
+
+void ConnectionManager::InitEndpoint (server & endpoint, asio::io_context * io)
+{
+    endpoint.set_access_channels (websocketpp::log::alevel::none);
+    if (io) {
+        endpoint.init_asio (io);
+    } else {
+        endpoint.init_asio ();
+    }
+    endpoint.set_tls_init_handler (std::bind (&ConnectionManager::OnTlsInit, this, std::placeholders::_1));
+    endpoint.set_message_handler (std::bind (&ConnectionManager::OnMessage, this, &endpoint, std::placeholders::_1, std::placeholders::_2));
+    endpoint.set_open_handler (std::bind (&ConnectionManager::OnOpen, this, &endpoint, std::placeholders::_1));
+    endpoint.set_close_handler (std::bind (&ConnectionManager::OnClose, this, &endpoint, std::placeholders::_1));
+    endpoint.set_validate_handler (std::bind (&ConnectionManager::OnValidate, this, &endpoint, std::placeholders::_1));
+
+#ifndef _WIN32
+    // lets the shards, and the old and the new process during a restart handover, listen on the same port
+    endpoint.set_tcp_pre_bind_handler ([] (std::shared_ptr<asio::ip::tcp::acceptor> acceptor) {
+        asio::error_code opt_ec;
+        acceptor->set_option (asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> (true), opt_ec);
+        return websocketpp::lib::error_code (opt_ec.value (), std::system_category ());
+    });
+#endif
+}
+
+void ConnectionManager::ForEachEndpoint (const std::function<void (server &)> & fn)
+{
+    fn (ws_server);
+    for (auto & shard : shards) {
+        fn (*shard);
+    }
 }
 
-void ConnectionManager::StartServer (int port)
+void ConnectionManager::StartServer (int port, bool is_takeover)
 {
     try {
-        ws_server.set_access_channels (websocketpp::log::alevel::none);
-        ws_server.init_asio ();
-        ws_server.set_tls_init_handler (std::bind (&ConnectionManager::OnTlsInit, this, std::placeholders::_1));
-        ws_server.set_message_handler (std::bind (&ConnectionManager::OnMessage, this, &ws_server, std::placeholders::_1, std::placeholders::_2));
-        ws_server.set_open_handler (std::bind (&ConnectionManager::OnOpen, this, &ws_server, std::placeholders::_1));
-        ws_server.set_close_handler (std::bind (&ConnectionManager::OnClose, this, &ws_server, std::placeholders::_1));
+        QuizConfig & cfg = QuizConfig::GetInstance ();
+        send_buffer_bytes = cfg.GetSendBufferBytes ();
+        send_queue_bytes = cfg.GetSendQueueBytes ();
+        slow_consumer_timeout_ms = cfg.GetSlowConsumerTimeoutMs ();
+        handshake_bucket.Configure (cfg.GetHandshakeRate (), cfg.GetHandshakeBurst ());
+        leaderboard_push_interval_ms = cfg.GetLeaderboardPushIntervalMs ();
+        tls_context = BuildTlsContext ();
 
-        ws_server.listen (port);
-        ws_server.start_accept ();
+        const int num_threads = std::max (1u, std::thread::hardware_concurrency ());
+        int shard_count = cfg.GetReactorShards ();
+        if (shard_count == 0) {
+            shard_count = num_threads;
+        }
+#ifdef _WIN32
+        shard_count = 1;                    // no SO_REUSEPORT to spread the accepts
+#endif
 
-        // Create thread pool
-        const int num_threads = std::thread::hardware_concurrency ();
+        if (shard_count > 1) {
+            // concurrency hint 1 - each loop is run by one thread and skips waking the others
+            for (int i = 0; i < shard_count; ++i) {
+                reactor_io.push_back (std::make_unique<asio::io_context> (1));
+            }
+            InitEndpoint (ws_server, reactor_io[0].get ());
+            for (int i = 1; i < shard_count; ++i) {
+                shards.push_back (std::make_unique<server> ());
+                InitEndpoint (*shards.back (), reactor_io[i].get ());
+            }
+        } else {
+            InitEndpoint (ws_server, nullptr);
+        }
 
-        for (int i = 0; i < num_threads; ++i) {
-            thread_pool.emplace_back ([this] () {
-                ws_server.run ();
-                                      });
+        // before the first client gets in, so nobody sees the exam half rebuilt
+        if (!is_takeover) {
+            quiz_controller->RecoverFromJournal ();
         }
 
-        std::cout << "Server started on port " << port << " with " << num_threads << " threads" << std::endl;
+        is_admitting = !is_takeover;
+        ForEachEndpoint ([port] (server & endpoint) {
+            endpoint.listen (port);
+            endpoint.start_accept ();
+        });
+        SchedulePump ();
+        ScheduleLeaderboardPush ();
+
+        if (is_takeover) {
+            takeover_thread = std::thread (&ConnectionManager::TakeOver, this);
+        } else {
+            ServeHandoff ();
+        }
+
+        // Create thread pool - one thread per shard, or every core on the single shared reactor
+        if (shards.empty ()) {
+            for (int i = 0; i < num_threads; ++i) {
+                thread_pool.emplace_back ([this] () {
+                    ws_server.run ();
+                                          });
+            }
+        } else {
+            ForEachEndpoint ([this] (server & endpoint) {
+                thread_pool.emplace_back ([&endpoint] () {
+                    endpoint.run ();
+                                          });
+            });
+        }
+
+        QUIZ_LOG_INFO (LOG_COMPONENT, "Server started on port %d with %zu threads, %d reactor shards",
+                       port, thread_pool.size (), shard_count > 1 ? shard_count : 1);
 
         // Join threads
         for (auto & t : thread_pool) {
@@ -102,17 +772,34 @@ void ConnectionManager::StartServer (int port)
         }
 
     } catch (const std::exception & e) {
-        std::cerr << "Server error: " << e.what () << std::endl;
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Server error: %s", e.what ());
     }
 }
 
 void ConnectionManager::StopServer ()
 {
-    // Force end all active quizzes before shutdown
-    QuizStateManager::GetInstance ().ForceEndAllQuizzes ();
+    is_stopping = true;
+    if (pump_timer) {
+        pump_timer->cancel ();
+    }
+    if (leaderboard_timer) {
+        leaderboard_timer->cancel ();
+    }
+
+    handoff.Stop ();
+    if (takeover_thread.joinable ()) {
+        takeover_thread.join ();
+    }
+
+    // Force end all active quizzes before shutdown - unless they were handed over to a new process
+    if (!is_drained) {
+        QuizStateManager::GetInstance ().ForceEndAllQuizzes ();
+    }
 
     // Stop WebSocket server
-    ws_server.stop ();
+    ForEachEndpoint ([] (server & endpoint) {
+        endpoint.stop ();
+    });
 
     // Join all threads
     for (auto & t : thread_pool) {
@@ -122,4 +809,8 @@ void ConnectionManager::StopServer ()
     }
 
     thread_pool.clear ();
+
+    QUIZ_LOG_INFO (LOG_COMPONENT, "Payload bytes sent: %llu deflated, %llu plain",
+                   bytes_sent_deflated.load (), bytes_sent_plain.load ());
+    Logger::GetInstance ().Flush ();
 }
\ No newline at end of file
@@ -1,33 +1,204 @@
 #pragma once
 #include <websocketpp/config/asio.hpp>
 #include <websocketpp/server.hpp>
+#ifdef QUIZ_WS_COMPRESSION
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#endif
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <thread>
 #include <vector>
+#include "MessagePool.h"
 #include "QuizController.hpp"
+#include "TokenBucket.hpp"
+#include "ServerHandoff.hpp"
 
-using server = websocketpp::server<websocketpp::config::asio_tls>;
+/*
+* Server endpoint config - the stock TLS config plus per connection settings,
+* and permessage-deflate when the build has zlib (QUIZ_WS_COMPRESSION, see CMakeLists.txt).
+* Deflate keeps its window across messages (context takeover), so the json keys and question
+* wording repeated on every QUESTION frame compress against the earlier frames of the same connection.
+* Frame buffers are recycled through per thread size class caches (MessagePool).
+*/
+struct QuizServerConfig : public websocketpp::config::asio_tls {
+    typedef QuizServerConfig type;
+
+    typedef PooledMessage message_type;
+    typedef PooledConMsgManagerType con_msg_manager_type;
+    typedef PooledEndpointMsgManagerType endpoint_msg_manager_type;
+
+    // A message waiting for the connection's socket to drain
+    struct OutboundMessage {
+        std::string payload;
+        std::string coalesce_key;           // a newer message with the same key replaces this one, empty = never
+    };
+
+    // mixed into every connection object
+    struct connection_base {
+        bool is_compression_enabled = false;
+        size_t compression_threshold = DEFAULT_COMPRESSION_THRESHOLD;
+
+        // outbound queue - used only while websocketpp already holds more than the send buffer budget
+        std::mutex send_mutex;
+        std::deque<OutboundMessage> send_queue;
+        size_t queued_bytes = 0;
+        long long backlog_since_ms = 0;     // when the queue last went from empty to non empty
+        bool is_evicted = false;
+
+        // requests that arrived while one of this connection's handlers was suspended, run in order after it.
+        // Capped at the send queue budget, a client pipelining past it is evicted like a slow consumer.
+        std::mutex request_mutex;
+        bool is_request_pending = false;
+        bool is_closed = false;             // OnClose ran - the pending handler's completion does the disconnect
+        std::deque<std::string> deferred_requests;
+        size_t deferred_bytes = 0;
+    };
+
+#ifdef QUIZ_WS_COMPRESSION
+    struct permessage_deflate_config { };
+    typedef websocketpp::extensions::permessage_deflate::enabled<permessage_deflate_config> permessage_deflate_type;
+#endif
+};
+
+using server = websocketpp::server<QuizServerConfig>;
 using connection_hdl = websocketpp::connection_hdl;
 
 class ConnectionManager {
 
 private:
     std::unique_ptr<QuizController> quiz_controller;
+
+    /*
+    * Reactor shards - with ReactorShards > 1 the port is served by that many endpoints, each on its own
+    * io_context run by exactly one thread, all listening with SO_REUSEPORT so the kernel spreads the
+    * accepts. A connection then lives on one event loop: no epoll shared between threads, no wakeups of
+    * other threads per completion, and a burst on one shard never stalls the others.
+    * ws_server is shard 0 and owns the timers. Connection handles work with any endpoint, so lookups and
+    * sends go through ws_server whichever shard the connection is on.
+    * With one shard (the default, and always on Windows) every io thread runs ws_server as before.
+    * reactor_io is declared first so it outlives the endpoints.
+    */
+    std::vector<std::unique_ptr<asio::io_context>> reactor_io;
     server ws_server;
+    std::vector<std::unique_ptr<server>> shards;
     std::vector<std::thread> thread_pool;
 
-    // TLS configuration
+    void InitEndpoint (server & endpoint, asio::io_context * io);
+    void ForEachEndpoint (const std::function<void (server &)> & fn);
+
+    /*
+    * TLS configuration - one context for every connection, built by StartServer. Reading the certificate
+    * and key per handshake cost more than the handshake itself, and a shared context lets a reconnecting
+    * client resume its session instead of doing the full key exchange again.
+    */
+    std::shared_ptr<asio::ssl::context> tls_context;
+    std::shared_ptr<asio::ssl::context> BuildTlsContext ();
     std::shared_ptr<asio::ssl::context> OnTlsInit (connection_hdl hdl);
 
     // WebSocket event handlers
     void OnMessage (server * s, connection_hdl hdl, server::message_ptr msg);
     void OnOpen (server * s, connection_hdl hdl);
     void OnClose (server * s, connection_hdl hdl);
+    bool OnValidate (server * s, connection_hdl hdl);
+
+    // Runs one request, false when its handler suspended - its completion then carries on with RunDeferred
+    bool HandleRequest (server::connection_ptr con, connection_hdl hdl, const std::string & payload);
+    void RunDeferred (server::connection_ptr con, connection_hdl hdl);
+
+    // Admission control for websocket handshakes - smooths the exam start rush instead of letting it spike the CPU
+    TokenBucket handshake_bucket;
+    std::atomic<unsigned long long> handshakes_refused {0};
+
+    // Hands a text frame to websocketpp, deflated if the connection negotiated it and the payload is above its threshold.
+    // payload is only lent to the message and comes back unchanged.
+    void SendText (server::connection_ptr con, std::string & payload);
+
+    // Outbound byte counters, split by whether the payload was handed to deflate
+    std::atomic<unsigned long long> bytes_sent_plain {0};
+    std::atomic<unsigned long long> bytes_sent_deflated {0};
+
+    /*
+    * Backpressure - websocketpp buffers without limit, so every send goes through Send () which
+    * queues behind a connection whose in flight bytes are over send_buffer_bytes. The queue is capped at
+    * send_queue_bytes, status pushes with the same coalesce key replace each other, and a connection that
+    * overflows or keeps a backlog for slow_consumer_timeout_ms is closed. The client then reconnects and
+    * continues through the usual LOGIN / CONTINUE_QUIZ path.
+    */
+    size_t send_buffer_bytes;
+    size_t send_queue_bytes;
+    long long slow_consumer_timeout_ms;
+
+    std::set<connection_hdl, std::owner_less<connection_hdl>> backlogged;
+    std::mutex backlogged_mutex;
+    server::timer_ptr pump_timer;
+    std::atomic<bool> is_stopping {false};
+
+    // Gauges and counters, see GetSendQueueStats
+    std::atomic<long long> queued_messages {0};
+    std::atomic<long long> queued_bytes {0};
+    std::atomic<unsigned long long> coalesced_total {0};
+    std::atomic<unsigned long long> evicted_total {0};
+    long long last_stats_log_ms;
+
+    // payload is lent like in SendText (copied when it has to queue), it comes back unchanged
+    void Send (connection_hdl hdl, std::string & payload, const std::string & coalesce_key = "");
+    bool DrainQueue (server::connection_ptr con);
+    void DiscardQueue (server::connection_ptr con);
+    void EvictSlowConsumer (server::connection_ptr con, const char * reason);
+    void SchedulePump ();
+    void OnPumpTimer (const websocketpp::lib::error_code & ec);
+
+    /*
+    * Leaderboard pushes - every leaderboard_push_interval_ms, if the ranking moved, each subscriber gets
+    * its top k and own rank. The top k array is serialized once per distinct k, and the pushes are coalesced
+    * so a slow subscriber only ever holds the latest snapshot.
+    */
+    long long leaderboard_push_interval_ms;
+    unsigned long long last_pushed_version = 0;
+    server::timer_ptr leaderboard_timer;
+
+    void ScheduleLeaderboardPush ();
+    void OnLeaderboardTimer (const websocketpp::lib::error_code & ec);
+
+    /*
+    * Restart handover (see ServerHandoff) - while is_admitting is false new handshakes get 503,
+    * is_drained makes StopServer leave the quizzes running for the process that took over.
+    */
+    ServerHandoff handoff;
+    std::thread takeover_thread;
+    std::atomic<bool> is_admitting {true};
+    std::atomic<bool> is_drained {false};
+
+    std::set<connection_hdl, std::owner_less<connection_hdl>> open_connections;
+    std::mutex open_connections_mutex;
+    std::condition_variable open_connections_cv;
+
+    void TakeOver ();
+    void ServeHandoff ();
+    std::string Drain ();
 
 public:
     ConnectionManager ();
     ~ConnectionManager ();
 
-    void StartServer (int port = 9002);
+    // is_takeover - take the port and the users over from a running server instead of starting fresh
+    void StartServer (int port = 9002, bool is_takeover = false);
     void StopServer ();
+
+    // Per connection tuning - a threshold of 0 deflates everything
+    void SetCompression (connection_hdl hdl, bool is_enabled, size_t threshold);
+
+    struct SendQueueStats {
+        long long queued_messages;
+        long long queued_bytes;
+        size_t backlogged_connections;
+        unsigned long long coalesced_total;
+        unsigned long long evicted_total;
+    };
+    SendQueueStats GetSendQueueStats ();
 };
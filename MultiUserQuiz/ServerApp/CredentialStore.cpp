@@ -0,0 +1,358 @@
+// CredentialStore.cpp
+#include "CredentialStore.hpp"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include "QuizClock.h"
+#include "Logger.h"
+
+static const char * LOG_COMPONENT = "CredentialStore";
+
+#define SCRYPT_DEFAULT_N        16384       // 16 MB and ~50 ms per check with r = 8
+#define SCRYPT_DEFAULT_R        8
+#define SCRYPT_DEFAULT_P        1
+#define SCRYPT_SALT_BYTES       16
+#define SCRYPT_KEY_BYTES        32
+#define SCRYPT_MAX_MEM          (256ULL << 20)  // records asking for more are refused at load
+#define CACHE_KEY_BYTES         32
+
+namespace {
+
+    std::string ToHex (const std::string & data)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve (data.size () * 2);
+        for (unsigned char byte : data) {
+            hex += digits[byte >> 4];
+            hex += digits[byte & 0x0f];
+        }
+        return hex;
+    }
+
+    bool FromHex (const std::string & hex, std::string & out)
+    {
+        auto nibble = [] (char ch) {
+            if (ch >= '0' && ch <= '9') {
+                return ch - '0';
+            }
+            if (ch >= 'a' && ch <= 'f') {
+                return ch - 'a' + 10;
+            }
+            if (ch >= 'A' && ch <= 'F') {
+                return ch - 'A' + 10;
+            }
+            return -1;
+        };
+
+        if (hex.empty () || hex.size () % 2 != 0) {
+            return false;
+        }
+        out.clear ();
+        for (size_t i = 0; i < hex.size (); i += 2) {
+            int hi = nibble (hex[i]);
+            int lo = nibble (hex[i + 1]);
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            out += static_cast<char>((hi << 4) | lo);
+        }
+        return true;
+    }
+
+    std::string RandomBytes (size_t count)
+    {
+        std::string bytes (count, '\0');
+        if (RAND_bytes (reinterpret_cast<unsigned char *>(&bytes[0]), static_cast<int>(count)) != 1) {
+            // no entropy from OpenSSL - still better than a fixed value
+            std::random_device rd;
+            for (auto & byte : bytes) {
+                byte = static_cast<char>(rd ());
+            }
+        }
+        return bytes;
+    }
+
+} // anonymous namespace
+
+CredentialStore::~CredentialStore ()
+{
+    Stop ();
+}
+
+bool CredentialStore::Derive (const std::string & password, const Record & params, std::string & key)
+{
+    key.assign (SCRYPT_KEY_BYTES, '\0');
+    return EVP_PBE_scrypt (password.data (), password.size (),
+                           reinterpret_cast<const unsigned char *>(params.salt.data ()), params.salt.size (),
+                           params.N, params.r, params.p, SCRYPT_MAX_MEM,
+                           reinterpret_cast<unsigned char *>(&key[0]), key.size ()) == 1;
+}
+
+bool CredentialStore::ParseRecord (const std::string & line, std::string & username, Record & record)
+{
+    std::vector<std::string> fields;
+    std::stringstream ss (line);
+    std::string field;
+    while (std::getline (ss, field, ':')) {
+        fields.push_back (field);
+    }
+
+    if (fields.size () != 7 || fields[0].empty () || fields[1] != "scrypt") {
+        return false;
+    }
+
+    try {
+        record.N = std::stoull (fields[2]);
+        record.r = static_cast<uint32_t>(std::stoul (fields[3]));
+        record.p = static_cast<uint32_t>(std::stoul (fields[4]));
+    } catch (...) {
+        return false;
+    }
+    if (!FromHex (fields[5], record.salt) || !FromHex (fields[6], record.key)) {
+        return false;
+    }
+
+    // a null key only checks the cost parameters against SCRYPT_MAX_MEM
+    if (EVP_PBE_scrypt (nullptr, 0, nullptr, 0, record.N, record.r, record.p, SCRYPT_MAX_MEM, nullptr, 0) != 1) {
+        return false;
+    }
+
+    username = fields[0];
+    return true;
+}
+
+bool CredentialStore::Load (const std::string & path, size_t thread_count, size_t queue_limit, long long remember_ms)
+{
+    if (is_loaded) {
+        return true;
+    }
+
+    std::ifstream in (path);
+    if (!in) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Could not open credential file %s", path.c_str ());
+        return false;
+    }
+
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline (in, line)) {
+        ++line_no;
+        if (!line.empty () && line.back () == '\r') {
+            line.pop_back ();
+        }
+        if (line.empty () || line[0] == '#') {
+            continue;
+        }
+
+        std::string username;
+        Record record;
+        if (!ParseRecord (line, username, record)) {
+            QUIZ_LOG_WARN (LOG_COMPONENT, "Skipping malformed credential at %s:%zu", path.c_str (), line_no);
+            continue;
+        }
+        records[username] = std::move (record);
+    }
+
+    if (records.empty ()) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "No usable credentials in %s", path.c_str ());
+        return false;
+    }
+
+    dummy.N = SCRYPT_DEFAULT_N;
+    dummy.r = SCRYPT_DEFAULT_R;
+    dummy.p = SCRYPT_DEFAULT_P;
+    dummy.salt = RandomBytes (SCRYPT_SALT_BYTES);
+    dummy.key = RandomBytes (SCRYPT_KEY_BYTES);
+
+    cache_key = RandomBytes (CACHE_KEY_BYTES);
+    cache_ttl_ms = remember_ms;
+    max_queued = std::max<size_t> (queue_limit, 1);
+
+    is_stopping = false;
+    for (size_t i = 0; i < std::max<size_t> (thread_count, 1); ++i) {
+        workers.emplace_back (&CredentialStore::WorkLoop, this);
+    }
+    is_loaded = true;
+
+    QUIZ_LOG_INFO (LOG_COMPONENT, "Loaded %zu credentials from %s, %zu hashing threads",
+                   records.size (), path.c_str (), workers.size ());
+    return true;
+}
+
+void CredentialStore::Stop ()
+{
+    {
+        std::lock_guard<std::mutex> lock (jobs_mutex);
+        is_stopping = true;
+    }
+    jobs_cv.notify_all ();
+
+    for (auto & worker : workers) {
+        if (worker.joinable ()) {
+            worker.join ();
+        }
+    }
+    workers.clear ();
+
+    // whatever was still queued is answered, nobody is left waiting on it
+    std::deque<Job> left;
+    {
+        std::lock_guard<std::mutex> lock (jobs_mutex);
+        left.swap (jobs);
+    }
+    for (auto & job : left) {
+        job.on_done (Outcome::BUSY);
+    }
+}
+
+void CredentialStore::Verify (const std::string & username, const std::string & password, std::function<void (Outcome)> on_done)
+{
+    if (IsRemembered (username, password)) {
+        cache_hits_total.fetch_add (1, std::memory_order_relaxed);
+        on_done (Outcome::OK);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock (jobs_mutex);
+        if (!is_stopping && jobs.size () < max_queued) {
+            jobs.push_back ({username, password, std::move (on_done)});
+            jobs_cv.notify_one ();
+            return;
+        }
+    }
+
+    refused_busy_total.fetch_add (1, std::memory_order_relaxed);
+    on_done (Outcome::BUSY);
+}
+
+Await<CredentialStore::Outcome> CredentialStore::Verify (std::string username, std::string password)
+{
+    return Await<Outcome> ([this, username = std::move (username), password = std::move (password)] (Await<Outcome>::Resume resume) {
+        Verify (username, password, std::move (resume));
+    });
+}
+
+void CredentialStore::WorkLoop ()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock (jobs_mutex);
+            jobs_cv.wait (lock, [this] () { return is_stopping || !jobs.empty (); });
+            if (is_stopping) {
+                return;
+            }
+            job = std::move (jobs.front ());
+            jobs.pop_front ();
+        }
+
+        Outcome outcome = Check (job.username, job.password);
+        job.on_done (outcome);
+    }
+}
+
+CredentialStore::Outcome CredentialStore::Check (const std::string & username, const std::string & password)
+{
+    auto it = records.find (username);
+    const Record & record = (it != records.end ()) ? it->second : dummy;
+
+    std::string key;
+    bool is_derived = Derive (password, record, key);
+    hashed_total.fetch_add (1, std::memory_order_relaxed);
+
+    bool is_match = is_derived && it != records.end () && key.size () == record.key.size () &&
+        CRYPTO_memcmp (key.data (), record.key.data (), key.size ()) == 0;
+    if (!is_match) {
+        return Outcome::FAILED;
+    }
+
+    Remember (username, password);
+    return Outcome::OK;
+}
+
+std::string CredentialStore::CacheDigest (const std::string & username, const std::string & password) const
+{
+    // the username is part of the message, so one digest cannot stand in for another user
+    std::string message = username;
+    message += '\0';
+    message += password;
+
+    unsigned char mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+    HMAC (EVP_sha256 (), cache_key.data (), static_cast<int>(cache_key.size ()),
+          reinterpret_cast<const unsigned char *>(message.data ()), message.size (), mac, &mac_len);
+    OPENSSL_cleanse (&message[0], message.size ());
+
+    return std::string (reinterpret_cast<const char *>(mac), mac_len);
+}
+
+bool CredentialStore::IsRemembered (const std::string & username, const std::string & password)
+{
+    if (cache_ttl_ms <= 0) {
+        return false;
+    }
+
+    std::string digest = CacheDigest (username, password);
+    long long now_ms = QuizClock::NowMs ();
+
+    std::lock_guard<std::mutex> lock (verified_mutex);
+    auto it = verified.find (username);
+    if (it == verified.end ()) {
+        return false;
+    }
+    if (it->second.expires_ms <= now_ms) {
+        verified.erase (it);
+        return false;
+    }
+    return it->second.digest.size () == digest.size () &&
+        CRYPTO_memcmp (it->second.digest.data (), digest.data (), digest.size ()) == 0;
+}
+
+void CredentialStore::Remember (const std::string & username, const std::string & password)
+{
+    if (cache_ttl_ms <= 0) {
+        return;
+    }
+
+    std::string digest = CacheDigest (username, password);
+    long long now_ms = QuizClock::NowMs ();
+
+    std::lock_guard<std::mutex> lock (verified_mutex);
+    verified[username] = {std::move (digest), now_ms + cache_ttl_ms};
+}
+
+void CredentialStore::Forget (const std::string & username)
+{
+    std::lock_guard<std::mutex> lock (verified_mutex);
+    verified.erase (username);
+}
+
+CredentialStore::Stats CredentialStore::GetStats () const
+{
+    return {hashed_total.load (), cache_hits_total.load (), refused_busy_total.load ()};
+}
+
+std::string CredentialStore::MakeRecord (const std::string & username, const std::string & password)
+{
+    if (username.empty () || username.find_first_of (":\r\n") != std::string::npos) {
+        return "";
+    }
+
+    Record record;
+    record.N = SCRYPT_DEFAULT_N;
+    record.r = SCRYPT_DEFAULT_R;
+    record.p = SCRYPT_DEFAULT_P;
+    record.salt = RandomBytes (SCRYPT_SALT_BYTES);
+    if (!Derive (password, record, record.key)) {
+        return "";
+    }
+
+    return username + ":scrypt:" + std::to_string (record.N) + ":" + std::to_string (record.r) + ":" +
+        std::to_string (record.p) + ":" + ToHex (record.salt) + ":" + ToHex (record.key);
+}
@@ -0,0 +1,122 @@
+// CredentialStore.hpp
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "HandlerTask.hpp"
+
+/*
+* Password check for LOGIN against a local credential file, one user per line ('#' starts a comment):
+*
+*   <username>:scrypt:<N>:<r>:<p>:<hex salt>:<hex derived key>
+*
+* scrypt is memory hard on purpose - tens of milliseconds and N * r * 128 bytes per check - so checks
+* never run on an io thread. A fixed pool of hashing threads works through a bounded queue, and when a
+* login wave fills the queue Verify answers BUSY right away so the client is told to retry, rather than
+* the wait growing without bound.
+*
+* A successful check is remembered for a while (an HMAC of the password under a per process key), so a
+* client reconnecting after a network blip gets in without hashing again. LOGOUT forgets it.
+*
+* Unknown users are hashed against a dummy record, the reply takes as long as for a wrong password.
+*
+*   MultiUserQuizServer --hash-password <username> <password>    prints a line for the file
+*/
+class CredentialStore {
+
+public:
+    enum class Outcome {
+        OK,
+        FAILED,
+        BUSY,               // the hashing queue is full, nothing was checked
+    };
+
+    struct Stats {
+        unsigned long long hashed;
+        unsigned long long cache_hits;
+        unsigned long long refused_busy;
+    };
+
+private:
+    struct Record {
+        uint64_t N = 0;
+        uint32_t r = 0;
+        uint32_t p = 0;
+        std::string salt;
+        std::string key;
+    };
+
+    // read only once Load returns
+    std::unordered_map<std::string, Record> records;
+    Record dummy;
+    bool is_loaded = false;
+
+    // verified logins - HMAC (cache_key, password) with its expiry
+    struct CachedLogin {
+        std::string digest;
+        long long expires_ms;
+    };
+    std::string cache_key;
+    long long cache_ttl_ms = 0;
+    std::unordered_map<std::string, CachedLogin> verified;
+    std::mutex verified_mutex;
+
+    // hashing pool
+    struct Job {
+        std::string username;
+        std::string password;
+        std::function<void (Outcome)> on_done;
+    };
+    std::deque<Job> jobs;
+    size_t max_queued = 0;
+    std::mutex jobs_mutex;
+    std::condition_variable jobs_cv;
+    std::vector<std::thread> workers;
+    bool is_stopping = false;
+
+    std::atomic<unsigned long long> hashed_total {0};
+    std::atomic<unsigned long long> cache_hits_total {0};
+    std::atomic<unsigned long long> refused_busy_total {0};
+
+    void WorkLoop ();
+    Outcome Check (const std::string & username, const std::string & password);
+    std::string CacheDigest (const std::string & username, const std::string & password) const;
+    bool IsRemembered (const std::string & username, const std::string & password);
+    void Remember (const std::string & username, const std::string & password);
+
+    static bool ParseRecord (const std::string & line, std::string & username, Record & record);
+    static bool Derive (const std::string & password, const Record & params, std::string & key);
+
+public:
+    CredentialStore () = default;
+    ~CredentialStore ();
+
+    CredentialStore (const CredentialStore &) = delete;
+    CredentialStore & operator= (const CredentialStore &) = delete;
+
+    // reads the file and starts the hashing threads, false (and nothing started) when it cannot be used
+    bool Load (const std::string & path, size_t thread_count, size_t queue_limit, long long remember_ms);
+    bool IsLoaded () const { return is_loaded; }
+    void Stop ();
+
+    // on_done runs right here for a remembered login or a full queue, otherwise on a hashing thread
+    void Verify (const std::string & username, const std::string & password, std::function<void (Outcome)> on_done);
+
+    // co_await form of the above
+    Await<Outcome> Verify (std::string username, std::string password);
+
+    // LOGOUT - the next login of this user is hashed again
+    void Forget (const std::string & username);
+
+    Stats GetStats () const;
+
+    // a credential file line with a fresh salt and the default cost, empty if the username cannot be stored
+    static std::string MakeRecord (const std::string & username, const std::string & password);
+};
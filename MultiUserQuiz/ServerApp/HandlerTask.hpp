@@ -0,0 +1,157 @@
+// HandlerTask.hpp
+#pragma once
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+/*
+* Return type of the request handlers that have to wait for something slow (a durable write, a remote
+* call) - a C++20 coroutine producing the response text. It is created suspended and Start runs it on the
+* calling thread up to its first co_await that does not complete on the spot. While suspended it holds
+* no thread. The operation it waits on completes on its own thread (the journal writer, a hashing thread),
+* which only hands the resumption to the executor given to Start - the handler and on_done then carry on
+* there (the connection's strand), never on the thread that completed the wait.
+*
+* Only the handlers that really wait are coroutines, everything else stays a plain call (see
+* QuizController::ProcessRequestAsync), so the per question fast path never allocates a frame.
+*/
+class HandlerTask {
+public:
+    // response is the handler's co_return value, error is set when it threw instead
+    using DoneCallback = std::function<void (std::string & response, std::exception_ptr error)>;
+    // runs the given function later on the thread(s) the handler belongs to
+    using Executor = std::function<void (std::function<void ()>)>;
+
+    struct promise_type {
+        std::string response;
+        std::exception_ptr error;
+        DoneCallback on_done;
+        Executor resume_on;         // empty = resume on the completing thread
+
+        HandlerTask get_return_object ()
+        {
+            return HandlerTask (std::coroutine_handle<promise_type>::from_promise (*this));
+        }
+
+        std::suspend_always initial_suspend () noexcept { return {}; }
+
+        // hands the result over and frees the frame - on_done may start the connection's next request
+        struct FinalAwaiter {
+            bool await_ready () noexcept { return false; }
+            void await_suspend (std::coroutine_handle<promise_type> handle) noexcept
+            {
+                promise_type & promise = handle.promise ();
+                DoneCallback on_done = std::move (promise.on_done);
+                std::string response = std::move (promise.response);
+                std::exception_ptr error = promise.error;
+                handle.destroy ();
+
+                if (on_done) {
+                    on_done (response, error);
+                }
+            }
+            void await_resume () noexcept { }
+        };
+
+        FinalAwaiter final_suspend () noexcept { return {}; }
+
+        void return_value (std::string value) { response = std::move (value); }
+        void unhandled_exception () { error = std::current_exception (); }
+    };
+
+    HandlerTask () = default;
+    HandlerTask (HandlerTask && other) noexcept : handle (std::exchange (other.handle, nullptr)) { }
+    HandlerTask & operator= (HandlerTask && other) noexcept
+    {
+        if (this != &other) {
+            Discard ();
+            handle = std::exchange (other.handle, nullptr);
+        }
+        return *this;
+    }
+    HandlerTask (const HandlerTask &) = delete;
+    HandlerTask & operator= (const HandlerTask &) = delete;
+
+    ~HandlerTask () { Discard (); }
+
+    // runs the handler, the frame owns itself from here on
+    void Start (DoneCallback on_done, Executor resume_on = nullptr)
+    {
+        std::coroutine_handle<promise_type> started = std::exchange (handle, nullptr);
+        started.promise ().on_done = std::move (on_done);
+        started.promise ().resume_on = std::move (resume_on);
+        started.resume ();
+    }
+
+private:
+    explicit HandlerTask (std::coroutine_handle<promise_type> h) : handle (h) { }
+
+    // a task that was never started is dropped with its frame
+    void Discard ()
+    {
+        if (handle) {
+            handle.destroy ();
+            handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/*
+* Awaits a callback style operation - start gets a resume function to call with the result once,
+* from any thread. Fits asio's completion handlers as they are:
+*
+*     asio::error_code ec = co_await Await<asio::error_code> ([&] (auto resume) { timer.async_wait (resume); });
+*
+* If the operation completes before the coroutine got to suspend, it just carries on without suspending.
+* Otherwise a HandlerTask is resumed through the executor it was started with.
+*/
+template <typename R>
+class Await {
+public:
+    using Resume = std::function<void (R)>;
+
+    explicit Await (std::function<void (Resume)> start_fn) : start (std::move (start_fn)) { }
+
+    bool await_ready () const noexcept { return false; }
+
+    template <typename Promise>
+    bool await_suspend (std::coroutine_handle<Promise> h)
+    {
+        handle = h;
+        if constexpr (std::is_same_v<Promise, HandlerTask::promise_type>) {
+            resume_on = h.promise ().resume_on;
+        }
+
+        start ([this] (R value) {
+            result = std::move (value);
+            // second one through resumes - here when the coroutine is already suspended
+            if (is_racing.exchange (true, std::memory_order_acq_rel)) {
+                if (resume_on) {
+                    // taken out first - once posted, the coroutine may run and free this awaiter right away
+                    HandlerTask::Executor post = std::move (resume_on);
+                    std::coroutine_handle<> suspended = handle;
+                    post ([suspended] () { suspended.resume (); });
+                } else {
+                    handle.resume ();
+                }
+            }
+        });
+        // false when the operation already completed, the coroutine then continues right away
+        return !is_racing.exchange (true, std::memory_order_acq_rel);
+    }
+
+    R await_resume () { return std::move (result); }
+
+private:
+    std::function<void (Resume)> start;
+    std::coroutine_handle<> handle;
+    HandlerTask::Executor resume_on;
+    std::atomic<bool> is_racing {false};
+    R result {};
+};
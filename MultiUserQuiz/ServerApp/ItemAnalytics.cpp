@@ -0,0 +1,297 @@
+// ItemAnalytics.cpp
+#include "ItemAnalytics.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+#define ITEM_INITIAL_CAPACITY   64
+
+std::unique_ptr<ItemAnalytics> ItemAnalytics::instance = nullptr;
+std::mutex ItemAnalytics::instance_mutex;
+
+namespace {
+
+    inline void Bump (std::atomic<long long> & counter, long long delta)
+    {
+        counter.store (counter.load (std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    inline long long Read (const std::atomic<long long> & counter)
+    {
+        return counter.load (std::memory_order_relaxed);
+    }
+
+    int TimeBucket (long long time_ms)
+    {
+        int bucket = 0;
+        while (bucket < ITEM_TIME_BUCKETS - 1 && time_ms >= (1LL << bucket)) {
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    // upper bound of the bucket holding the given fraction of the answers
+    long long TimePercentile (const std::array<long long, ITEM_TIME_BUCKETS> & buckets, long long count, double fraction)
+    {
+        if (count == 0) {
+            return 0;
+        }
+
+        long long target = static_cast<long long>(count * fraction);
+        long long seen = 0;
+        for (int i = 0; i < ITEM_TIME_BUCKETS; ++i) {
+            seen += buckets[i];
+            if (seen > target) {
+                return 1LL << i;
+            }
+        }
+        return 1LL << (ITEM_TIME_BUCKETS - 1);
+    }
+
+} // anonymous namespace
+
+ItemAnalytics & ItemAnalytics::GetInstance ()
+{
+    std::lock_guard<std::mutex> lock (instance_mutex);
+    if (!instance) {
+        instance = std::unique_ptr<ItemAnalytics> (new ItemAnalytics ());
+    }
+    return *instance;
+}
+
+ItemAnalytics::Shard & ItemAnalytics::GetThreadShard ()
+{
+    thread_local std::shared_ptr<Shard> shard;
+
+    if (!shard) {
+        shard = std::make_shared<Shard> ();
+        std::lock_guard<std::mutex> lock (shards_mutex);
+        shards.push_back (shard);
+    }
+    return *shard;
+}
+
+ItemAnalytics::QuestionCounters & ItemAnalytics::GetCounters (unsigned int question_id)
+{
+    Shard & shard = GetThreadShard ();
+    CounterTable * table = shard.table.load (std::memory_order_relaxed);
+
+    // reset since the last record - start over on empty counters. Readers may still be reading the
+    // old tables, so they are only freed under their lock.
+    unsigned long long current = generation.load (std::memory_order_acquire);
+    if (shard.generation.load (std::memory_order_relaxed) != current) {
+        std::lock_guard<std::mutex> lock (shards_mutex);
+        shard.table.store (nullptr, std::memory_order_relaxed);
+        shard.tables.clear ();
+        shard.generation.store (current, std::memory_order_relaxed);
+        table = nullptr;
+    }
+
+    if (!table || question_id >= table->capacity) {
+        // grow - copy what we have into a bigger zeroed table and publish it
+        size_t capacity = std::max<size_t> ({ITEM_INITIAL_CAPACITY, question_id + 1, table ? table->capacity * 2 : 0});
+        auto grown = std::make_unique<CounterTable> ();
+        grown->capacity = capacity;
+        grown->counters = std::make_unique<QuestionCounters[]> (capacity);
+
+        for (size_t q = 0; q < capacity; ++q) {
+            QuestionCounters & dst = grown->counters[q];
+            const QuestionCounters * src = table && q < table->capacity ? &table->counters[q] : nullptr;
+
+            auto copy = [] (std::atomic<long long> & to, const std::atomic<long long> * from) {
+                to.store (from ? Read (*from) : 0, std::memory_order_relaxed);
+            };
+            for (int i = 0; i < 4; ++i) {
+                copy (dst.option_picks[i], src ? &src->option_picks[i] : nullptr);
+            }
+            for (int i = 0; i < 3; ++i) {
+                copy (dst.status_count[i], src ? &src->status_count[i] : nullptr);
+            }
+            for (int i = 0; i < 2; ++i) {
+                copy (dst.rest_score_milli[i], src ? &src->rest_score_milli[i] : nullptr);
+                copy (dst.rest_score_count[i], src ? &src->rest_score_count[i] : nullptr);
+            }
+            for (int i = 0; i < ITEM_TIME_BUCKETS; ++i) {
+                copy (dst.time_buckets[i], src ? &src->time_buckets[i] : nullptr);
+            }
+            copy (dst.submissions, src ? &src->submissions : nullptr);
+            copy (dst.time_sum_ms, src ? &src->time_sum_ms : nullptr);
+            copy (dst.time_count, src ? &src->time_count : nullptr);
+        }
+
+        table = grown.get ();
+        shard.tables.push_back (std::move (grown));
+        shard.table.store (table, std::memory_order_release);
+    }
+    return table->counters[question_id];
+}
+
+void ItemAnalytics::RecordTransition (const AnswerTransition & transition)
+{
+    QuestionCounters & counters = GetCounters (transition.quesId);
+
+    if (transition.oldStatus != UNATTEMPTED) {
+        Bump (counters.status_count[transition.oldStatus], -1);
+        for (int i = 0; i < 4; ++i) {
+            if (transition.oldOptions[i]) {
+                Bump (counters.option_picks[i], -1);
+            }
+        }
+    }
+
+    if (transition.newStatus != UNATTEMPTED) {
+        Bump (counters.status_count[transition.newStatus], 1);
+        for (int i = 0; i < 4; ++i) {
+            if (transition.newOptions[i]) {
+                Bump (counters.option_picks[i], 1);
+            }
+        }
+
+        int group = transition.newStatus == CORRECT ? 0 : 1;
+        Bump (counters.rest_score_milli[group], static_cast<long long>(transition.restScore * 1000));
+        Bump (counters.rest_score_count[group], 1);
+    }
+
+    Bump (counters.submissions, 1);
+}
+
+void ItemAnalytics::RecordAnswerTime (unsigned int question_id, long long time_ms)
+{
+    if (time_ms < 0) {
+        return;
+    }
+
+    QuestionCounters & counters = GetCounters (question_id);
+    Bump (counters.time_buckets[TimeBucket (time_ms)], 1);
+    Bump (counters.time_sum_ms, time_ms);
+    Bump (counters.time_count, 1);
+}
+
+void ItemAnalytics::Reset ()
+{
+    generation.fetch_add (1, std::memory_order_acq_rel);
+}
+
+std::vector<ItemAnalytics::ItemStats> ItemAnalytics::Snapshot (unsigned int question_count) const
+{
+    // value initialized, all zero
+    std::vector<ItemStats> stats (question_count);
+    std::vector<long long> rest_sum (question_count * 2, 0);
+    std::vector<long long> rest_count (question_count * 2, 0);
+    std::vector<std::array<long long, ITEM_TIME_BUCKETS>> time_buckets (question_count);
+    std::vector<long long> time_sum (question_count, 0);
+
+    {
+        std::lock_guard<std::mutex> lock (shards_mutex);
+        unsigned long long current = generation.load (std::memory_order_acquire);
+        for (const auto & shard : shards) {
+            const CounterTable * table = shard->table.load (std::memory_order_acquire);
+            if (!table || shard->generation.load (std::memory_order_relaxed) != current) {
+                continue;
+            }
+
+            // question ids are 1 based
+            for (unsigned int q = 1; q <= question_count && q < table->capacity; ++q) {
+                const QuestionCounters & counters = table->counters[q];
+                ItemStats & item = stats[q - 1];
+
+                for (int i = 0; i < 4; ++i) {
+                    item.option_picks[i] += Read (counters.option_picks[i]);
+                }
+                item.correct += Read (counters.status_count[CORRECT]);
+                item.incorrect += Read (counters.status_count[INCORRECT]);
+                item.partial += Read (counters.status_count[PARTIALLY_CORRECT]);
+                item.submissions += Read (counters.submissions);
+                item.time_count += Read (counters.time_count);
+                time_sum[q - 1] += Read (counters.time_sum_ms);
+
+                for (int i = 0; i < 2; ++i) {
+                    rest_sum[(q - 1) * 2 + i] += Read (counters.rest_score_milli[i]);
+                    rest_count[(q - 1) * 2 + i] += Read (counters.rest_score_count[i]);
+                }
+                for (int i = 0; i < ITEM_TIME_BUCKETS; ++i) {
+                    time_buckets[q - 1][i] += Read (counters.time_buckets[i]);
+                }
+            }
+        }
+    }
+
+    for (unsigned int q = 0; q < question_count; ++q) {
+        ItemStats & item = stats[q];
+        item.question_id = q + 1;
+
+        // an answer given before a Reset and changed after it takes away what was never counted
+        for (long long & picks : item.option_picks) {
+            picks = std::max (0LL, picks);
+        }
+        item.correct = std::max (0LL, item.correct);
+        item.partial = std::max (0LL, item.partial);
+        item.incorrect = std::max (0LL, item.incorrect);
+
+        long long answered = item.correct + item.partial + item.incorrect;
+        item.difficulty = answered ? static_cast<double>(item.correct) / answered : 0;
+
+        long long n_correct = rest_count[q * 2];
+        long long n_other = rest_count[q * 2 + 1];
+        item.discrimination = (n_correct && n_other)
+            ? (rest_sum[q * 2] / 1000.0) / n_correct - (rest_sum[q * 2 + 1] / 1000.0) / n_other
+            : 0;
+
+        item.time_mean_ms = item.time_count ? time_sum[q] / item.time_count : 0;
+        item.time_p50_ms = TimePercentile (time_buckets[q], item.time_count, 0.5);
+        item.time_p90_ms = TimePercentile (time_buckets[q], item.time_count, 0.9);
+    }
+    return stats;
+}
+
+nlohmann::json ItemAnalytics::ToJson (const std::vector<ItemStats> & stats)
+{
+    nlohmann::json items = nlohmann::json::array ();
+
+    for (const ItemStats & item : stats) {
+        items.push_back ({
+            {"question_id", item.question_id},
+            {"option_picks", {item.option_picks[0], item.option_picks[1], item.option_picks[2], item.option_picks[3]}},
+            {"correct", item.correct},
+            {"partial", item.partial},
+            {"incorrect", item.incorrect},
+            {"submissions", item.submissions},
+            {"difficulty", item.difficulty},
+            {"discrimination", item.discrimination},
+            {"time_mean_ms", item.time_mean_ms},
+            {"time_p50_ms", item.time_p50_ms},
+            {"time_p90_ms", item.time_p90_ms}
+        });
+    }
+    return items;
+}
+
+bool ItemAnalytics::WriteCsv (const std::vector<ItemStats> & stats, const std::string & path)
+{
+    // like the results file - a failed write keeps the last good one
+    std::string tmp_path = path + ".tmp";
+    FILE * out = fopen (tmp_path.c_str (), "w");
+    if (!out) {
+        return false;
+    }
+
+    fprintf (out, "question_id,option_a,option_b,option_c,option_d,correct,partial,incorrect,submissions,"
+             "difficulty,discrimination,time_count,time_mean_ms,time_p50_ms,time_p90_ms\n");
+
+    for (const ItemStats & item : stats) {
+        fprintf (out, "%u,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%.4f,%.4f,%lld,%lld,%lld,%lld\n",
+                 item.question_id, item.option_picks[0], item.option_picks[1], item.option_picks[2], item.option_picks[3],
+                 item.correct, item.partial, item.incorrect, item.submissions,
+                 item.difficulty, item.discrimination, item.time_count, item.time_mean_ms, item.time_p50_ms, item.time_p90_ms);
+    }
+
+    bool is_ok = ferror (out) == 0;
+    is_ok = fclose (out) == 0 && is_ok;
+
+    if (!is_ok) {
+        std::remove (tmp_path.c_str ());
+        return false;
+    }
+    std::remove (path.c_str ());
+    return std::rename (tmp_path.c_str (), path.c_str ()) == 0;
+}
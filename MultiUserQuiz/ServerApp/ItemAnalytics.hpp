@@ -0,0 +1,102 @@
+// ItemAnalytics.hpp
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "Result.h"
+
+#define ITEM_TIME_BUCKETS       24          // time to answer histogram, bucket i counts answers below 2^i ms
+
+/*
+* Live per question statistics - how hard a question is, whether it separates strong from weak
+* candidates, how the options are picked and how long answering takes - maintained while the exam runs.
+*
+* Fed from Result's transition observer, so a changed answer moves its counts from the old status
+* and options to the new ones and the numbers always describe the answers currently on record.
+* Every grading thread writes only to its own shard (no locks, no shared cache lines), and a
+* read merges all shards. Nothing ever scans the users' answers.
+*
+* The numbers cover one exam on one bank - Reset starts them over when the next exam begins or a
+* reload gives the question ids other questions or keys. A shard left from before a reset is not
+* read, its owner swaps in empty counters the next time it records.
+*
+*   difficulty      share of current answers that are correct
+*   discrimination  mean rest score over correct submissions minus that over the other submissions - the
+*                   rest score is the user's score without this question at the time of answering
+*/
+class ItemAnalytics {
+
+public:
+    struct ItemStats {
+        unsigned int question_id;
+        long long option_picks[4];
+        long long correct;
+        long long partial;
+        long long incorrect;
+        long long submissions;
+        double difficulty;
+        double discrimination;
+        long long time_count;
+        long long time_mean_ms;
+        long long time_p50_ms;             // upper bound of the histogram bucket holding the median
+        long long time_p90_ms;
+    };
+
+private:
+    static std::unique_ptr<ItemAnalytics> instance;
+    static std::mutex instance_mutex;
+
+    // written only by the owning thread, so plain load + store instead of locked read modify write
+    struct QuestionCounters {
+        std::atomic<long long> option_picks[4];
+        std::atomic<long long> status_count[3];         // indexed by eQuesAttemptStatus: CORRECT, INCORRECT, PARTIALLY_CORRECT
+        std::atomic<long long> submissions;
+        std::atomic<long long> rest_score_milli[2];     // [0] correct answers, [1] the others
+        std::atomic<long long> rest_score_count[2];
+        std::atomic<long long> time_buckets[ITEM_TIME_BUCKETS];
+        std::atomic<long long> time_sum_ms;
+        std::atomic<long long> time_count;
+    };
+
+    struct CounterTable {
+        size_t capacity;
+        std::unique_ptr<QuestionCounters[]> counters;
+    };
+
+    /*
+    * A thread's counters, indexed by question id. Grows by publishing a bigger copy, the old tables are
+    * kept so a reader still holding one never touches freed memory.
+    */
+    struct Shard {
+        std::atomic<CounterTable *> table {nullptr};
+        std::atomic<unsigned long long> generation {0};
+        std::vector<std::unique_ptr<CounterTable>> tables;
+    };
+
+    std::vector<std::shared_ptr<Shard>> shards;
+    mutable std::mutex shards_mutex;        // only taken when a thread records for the first time or after a reset, and by readers
+    std::atomic<unsigned long long> generation {0};     // bumped by Reset
+
+    ItemAnalytics () = default;
+
+    Shard & GetThreadShard ();
+    QuestionCounters & GetCounters (unsigned int question_id);
+
+public:
+    static ItemAnalytics & GetInstance ();
+
+    // Writers - installed as Result's transition observer / called with the client reported answer time
+    void RecordTransition (const AnswerTransition & transition);
+    void RecordAnswerTime (unsigned int question_id, long long time_ms);
+
+    // Forgets everything recorded so far - the answers given before and changed after are counted only from their change
+    void Reset ();
+
+    // Readers - merge every shard
+    std::vector<ItemStats> Snapshot (unsigned int question_count) const;
+    static nlohmann::json ToJson (const std::vector<ItemStats> & stats);
+    static bool WriteCsv (const std::vector<ItemStats> & stats, const std::string & path);
+};
@@ -0,0 +1,221 @@
+// Leaderboard.cpp
+#include "Leaderboard.hpp"
+
+std::unique_ptr<Leaderboard> Leaderboard::instance = nullptr;
+std::mutex Leaderboard::instance_mutex;
+
+Leaderboard & Leaderboard::GetInstance ()
+{
+    std::lock_guard<std::mutex> lock (instance_mutex);
+    if (!instance) {
+        instance = std::unique_ptr<Leaderboard> (new Leaderboard ());
+    }
+    return *instance;
+}
+
+Leaderboard::Leaderboard ()
+    : root (-1),
+    rng (std::random_device {} ())
+{ }
+
+bool Leaderboard::IsAhead (const Node & a, const Node & b)
+{
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    if (a.elapsed_ms != b.elapsed_ms) {
+        return a.elapsed_ms < b.elapsed_ms;
+    }
+    return a.username < b.username;
+}
+
+unsigned int Leaderboard::SizeOf (int idx) const
+{
+    return idx < 0 ? 0 : nodes[idx].size;
+}
+
+void Leaderboard::Recount (int idx)
+{
+    nodes[idx].size = 1 + SizeOf (nodes[idx].left) + SizeOf (nodes[idx].right);
+}
+
+void Leaderboard::Split (int t, const Node & key, bool or_equal, int & l, int & r)
+{
+    if (t < 0) {
+        l = r = -1;
+        return;
+    }
+
+    bool goes_left = IsAhead (nodes[t], key) || (or_equal && nodes[t].username == key.username);
+    if (goes_left) {
+        Split (nodes[t].right, key, or_equal, nodes[t].right, r);
+        l = t;
+    } else {
+        Split (nodes[t].left, key, or_equal, l, nodes[t].left);
+        r = t;
+    }
+    Recount (t);
+}
+
+int Leaderboard::Merge (int l, int r)
+{
+    if (l < 0) {
+        return r;
+    }
+    if (r < 0) {
+        return l;
+    }
+
+    if (nodes[l].priority > nodes[r].priority) {
+        nodes[l].right = Merge (nodes[l].right, r);
+        Recount (l);
+        return l;
+    }
+    nodes[r].left = Merge (l, nodes[r].left);
+    Recount (r);
+    return r;
+}
+
+void Leaderboard::EraseNode (int idx)
+{
+    int l, mid, r;
+    Split (root, nodes[idx], false, l, r);
+    Split (r, nodes[idx], true, mid, r);     // mid is the node itself
+    root = Merge (l, r);
+
+    nodes[idx].username.clear ();
+    free_nodes.push_back (idx);
+}
+
+void Leaderboard::Update (const std::string & username, double score, long long elapsed_ms)
+{
+    std::lock_guard<std::mutex> lock (board_mutex);
+
+    auto it = user_to_node.find (username);
+    if (it != user_to_node.end ()) {
+        const Node & current = nodes[it->second];
+        if (current.score == score && current.elapsed_ms == elapsed_ms) {
+            return;
+        }
+        EraseNode (it->second);
+    }
+
+    int idx;
+    if (!free_nodes.empty ()) {
+        idx = free_nodes.back ();
+        free_nodes.pop_back ();
+    } else {
+        idx = static_cast<int>(nodes.size ());
+        nodes.emplace_back ();
+    }
+
+    Node & node = nodes[idx];
+    node.username = username;
+    node.score = score;
+    node.elapsed_ms = elapsed_ms;
+    node.priority = rng ();
+    node.size = 1;
+    node.left = node.right = -1;
+    user_to_node[username] = idx;
+
+    int l, r;
+    Split (root, nodes[idx], false, l, r);
+    root = Merge (Merge (l, idx), r);
+
+    version.fetch_add (1, std::memory_order_relaxed);
+}
+
+void Leaderboard::Remove (const std::string & username)
+{
+    std::lock_guard<std::mutex> lock (board_mutex);
+
+    auto it = user_to_node.find (username);
+    if (it == user_to_node.end ()) {
+        return;
+    }
+    EraseNode (it->second);
+    user_to_node.erase (it);
+
+    version.fetch_add (1, std::memory_order_relaxed);
+}
+
+bool Leaderboard::GetRank (const std::string & username, unsigned int & rank, size_t & total) const
+{
+    std::lock_guard<std::mutex> lock (board_mutex);
+
+    total = user_to_node.size ();
+    auto it = user_to_node.find (username);
+    if (it == user_to_node.end ()) {
+        return false;
+    }
+
+    // count everybody ahead of the user on the way down
+    const Node & key = nodes[it->second];
+    unsigned int ahead = 0;
+    int t = root;
+    while (t >= 0) {
+        if (IsAhead (nodes[t], key)) {
+            ahead += SizeOf (nodes[t].left) + 1;
+            t = nodes[t].right;
+        } else {
+            t = nodes[t].left;
+        }
+    }
+
+    rank = ahead + 1;
+    return true;
+}
+
+std::vector<Leaderboard::Entry> Leaderboard::GetTop (size_t k) const
+{
+    std::lock_guard<std::mutex> lock (board_mutex);
+
+    std::vector<Entry> top;
+    top.reserve (std::min (k, user_to_node.size ()));
+
+    // in order walk, stops after k nodes
+    std::vector<int> path;
+    int t = root;
+    while ((t >= 0 || !path.empty ()) && top.size () < k) {
+        while (t >= 0) {
+            path.push_back (t);
+            t = nodes[t].left;
+        }
+        t = path.back ();
+        path.pop_back ();
+
+        const Node & node = nodes[t];
+        top.push_back ({static_cast<unsigned int>(top.size () + 1), node.username, node.score, node.elapsed_ms});
+        t = node.right;
+    }
+    return top;
+}
+
+size_t Leaderboard::GetSize () const
+{
+    std::lock_guard<std::mutex> lock (board_mutex);
+    return user_to_node.size ();
+}
+
+unsigned long long Leaderboard::GetVersion () const
+{
+    return version.load (std::memory_order_relaxed);
+}
+
+void Leaderboard::Subscribe (const std::string & username, size_t k)
+{
+    std::lock_guard<std::mutex> lock (subscribers_mutex);
+    subscribers[username] = k;
+}
+
+void Leaderboard::Unsubscribe (const std::string & username)
+{
+    std::lock_guard<std::mutex> lock (subscribers_mutex);
+    subscribers.erase (username);
+}
+
+std::vector<std::pair<std::string, size_t>> Leaderboard::GetSubscribers () const
+{
+    std::lock_guard<std::mutex> lock (subscribers_mutex);
+    return std::vector<std::pair<std::string, size_t>> (subscribers.begin (), subscribers.end ());
+}
@@ -0,0 +1,91 @@
+// Leaderboard.hpp
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+* Live ranking of every user that started the quiz.
+*
+* Users are kept in an order statistic treap ordered by score (high first), then elapsed time
+* (fast first), then name, every node knowing the size of its subtree. A graded answer moves one
+* user - an erase and an insert, O(log n) - instead of re-sorting everybody:
+*
+*   Update (user, score, elapsed)   O(log n)
+*   GetRank (user)                  O(log n)
+*   GetTop (k)                      O(k + log n)
+*
+* Nodes live in one vector and link by index, so 100k users cost a single allocation and no pointer chasing across the heap.
+* Every change bumps the version, the push timer uses it to skip rounds where nothing moved.
+*
+* Subscriptions (user -> top k wanted) are kept here too, the ConnectionManager pushes the snapshots.
+*/
+class Leaderboard {
+
+public:
+    struct Entry {
+        unsigned int rank;
+        std::string username;
+        double score;
+        long long elapsed_ms;
+    };
+
+private:
+    static std::unique_ptr<Leaderboard> instance;
+    static std::mutex instance_mutex;
+
+    struct Node {
+        std::string username;
+        double score;
+        long long elapsed_ms;
+        unsigned int priority;
+        unsigned int size;
+        int left;
+        int right;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int> free_nodes;
+    std::unordered_map<std::string, int> user_to_node;
+    int root;
+    std::mt19937 rng;
+    mutable std::mutex board_mutex;
+
+    std::atomic<unsigned long long> version {0};
+
+    std::unordered_map<std::string, size_t> subscribers;
+    mutable std::mutex subscribers_mutex;
+
+    Leaderboard ();
+
+    // true when a ranks ahead of b
+    static bool IsAhead (const Node & a, const Node & b);
+    unsigned int SizeOf (int idx) const;
+    void Recount (int idx);
+
+    // Splits t into nodes ahead of the key (l) and the rest (r), or_equal moves the key itself to l
+    void Split (int t, const Node & key, bool or_equal, int & l, int & r);
+    int Merge (int l, int r);
+    void EraseNode (int idx);
+
+public:
+    static Leaderboard & GetInstance ();
+
+    void Update (const std::string & username, double score, long long elapsed_ms);
+    void Remove (const std::string & username);
+
+    // 1 based, false when the user is not ranked
+    bool GetRank (const std::string & username, unsigned int & rank, size_t & total) const;
+    std::vector<Entry> GetTop (size_t k) const;
+    size_t GetSize () const;
+    unsigned long long GetVersion () const;
+
+    // Live updates
+    void Subscribe (const std::string & username, size_t k);
+    void Unsubscribe (const std::string & username);
+    std::vector<std::pair<std::string, size_t>> GetSubscribers () const;
+};
@@ -1,14 +1,26 @@
 ﻿// MultiUserQuizServer.cpp : Defines the entry point for the application.
 
 #include "ConnectionManager.hpp"
+#include "BankReloader.hpp"
+#include "CredentialStore.hpp"
+#include "QuizClock.h"
 #include "../QuizMgr.h"
 
-const std::string gFilename = "QuizBank.xlsx";
-
-int main ()
+int main (int argc, char * argv[])
 {
     try {
 
+        // --hash-password <username> <password>: prints a CredentialFile line and exits
+        if (argc > 3 && std::string (argv[1]) == "--hash-password") {
+            std::string line = CredentialStore::MakeRecord (argv[2], argv[3]);
+            if (line.empty ()) {
+                std::cerr << "username must not be empty or contain ':'" << std::endl;
+                return -1;
+            }
+            std::cout << line << std::endl;
+            return 0;
+        }
+
         QuizMgr quiz;
 
         if (quiz.InitializeQuizConfigs () == false) {
@@ -16,13 +28,35 @@ int main ()
             return -1;
         }
 
-        if (quiz.InitializeQuestionBank (gFilename) == false) {
+        QuizConfig & cfg = QuizConfig::GetInstance ();
+        if (quiz.InitializeQuestionBank (cfg.GetQuestionBankFile ()) == false) {
             std::cerr << "error parsing question bank" << std::endl;
             return -1;
         }
 
+        // the expected candidates get their users now - START_QUIZ at T-0 then only claims one
+        std::string roster_file = cfg.GetRosterFile ();
+        if (!roster_file.empty ()) {
+            unsigned int ques_count = QuestionBank::GetInstance ().GetSnapshot ()->TotalQuestionCount ();
+            size_t provisioned = SessionManager::GetInstance ().ProvisionRoster (roster_file, ques_count);
+            if (provisioned == 0) {
+                std::cerr << "roster " << roster_file << " is missing or empty" << std::endl;
+            }
+        }
+
+        // edits to the bank file go live without a restart
+        BankReloader::GetInstance ().StartWatch (cfg.GetQuestionBankFile (), cfg.GetBankWatchIntervalMs ());
+
+        // --takeover: take the port and the users over from the running server (zero downtime restart)
+        bool is_takeover = argc > 1 && std::string (argv[1]) == "--takeover";
+
+        // every timing check reads the published tick instead of the system clock
+        QuizClock::Start (CLOCK_TICK_MS);
+
         ConnectionManager server;
-        server.StartServer (9002);
+        server.StartServer (9002, is_takeover);
+
+        QuizClock::Stop ();
 
     } catch (const std::exception & e) {
 
@@ -0,0 +1,140 @@
+// QuestionShuffle.cpp
+#include "QuestionShuffle.hpp"
+#include <random>
+#include <utility>
+
+#define SHUFFLE_FEISTEL_ROUNDS  4
+
+namespace {
+
+    // splitmix64 finalizer
+    inline unsigned long long Mix (unsigned long long x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+} // anonymous namespace
+
+QuestionShuffle::QuestionShuffle (unsigned long long seed, unsigned int question_count, bool is_shuffle_questions, bool is_shuffle_options)
+    : seed (seed),
+    question_count (question_count),
+    is_shuffle_questions (is_shuffle_questions && question_count > 1),
+    is_shuffle_options (is_shuffle_options),
+    half_bits (1)
+{
+    // smallest even bit width covering 0..N-1, so the walk below needs fewer than 4 steps on average
+    while ((1ULL << (half_bits * 2)) < question_count) {
+        ++half_bits;
+    }
+    half_mask = (1u << half_bits) - 1;
+}
+
+unsigned long long QuestionShuffle::NewSeed ()
+{
+    std::random_device rd;
+    return (static_cast<unsigned long long>(rd ()) << 32) ^ rd ();
+}
+
+unsigned int QuestionShuffle::Round (unsigned int round, unsigned int half) const
+{
+    return static_cast<unsigned int>(Mix (seed ^ (static_cast<unsigned long long>(round) << 32) ^ half)) & half_mask;
+}
+
+unsigned int QuestionShuffle::Encrypt (unsigned int value) const
+{
+    unsigned int left = value >> half_bits;
+    unsigned int right = value & half_mask;
+
+    for (unsigned int r = 0; r < SHUFFLE_FEISTEL_ROUNDS; ++r) {
+        unsigned int next = left ^ Round (r, right);
+        left = right;
+        right = next;
+    }
+    return (left << half_bits) | right;
+}
+
+unsigned int QuestionShuffle::Decrypt (unsigned int value) const
+{
+    unsigned int left = value >> half_bits;
+    unsigned int right = value & half_mask;
+
+    for (unsigned int r = SHUFFLE_FEISTEL_ROUNDS; r-- > 0;) {
+        unsigned int prev = right ^ Round (r, left);
+        right = left;
+        left = prev;
+    }
+    return (left << half_bits) | right;
+}
+
+unsigned int QuestionShuffle::ToBankId (unsigned int display_id) const
+{
+    if (!is_shuffle_questions || display_id == 0 || display_id > question_count) {
+        return display_id;
+    }
+
+    // cycle walk - the Feistel domain is bigger than N, step again until we land inside it
+    unsigned int value = display_id - 1;
+    do {
+        value = Encrypt (value);
+    } while (value >= question_count);
+    return value + 1;
+}
+
+unsigned int QuestionShuffle::ToDisplayId (unsigned int bank_id) const
+{
+    if (!is_shuffle_questions || bank_id == 0 || bank_id > question_count) {
+        return bank_id;
+    }
+
+    unsigned int value = bank_id - 1;
+    do {
+        value = Decrypt (value);
+    } while (value >= question_count);
+    return value + 1;
+}
+
+std::array<int, 4> QuestionShuffle::OptionOrder (unsigned int bank_id) const
+{
+    std::array<int, 4> order = {0, 1, 2, 3};
+
+    // Fisher Yates driven by one hash of (seed, question) - 4 * 3 * 2 draws, all 24 orders reachable
+    unsigned long long h = Mix (seed ^ Mix (bank_id));
+    for (int i = 3; i > 0; --i) {
+        std::swap (order[i], order[h % (i + 1)]);
+        h /= (i + 1);
+    }
+    return order;
+}
+
+int QuestionShuffle::ToBankOption (unsigned int bank_id, int display_option, unsigned int option_count) const
+{
+    if (!is_shuffle_options || option_count != 4 || display_option < 0 || display_option > 3) {
+        return display_option;
+    }
+    return OptionOrder (bank_id)[display_option];
+}
+
+int QuestionShuffle::ToDisplayOption (unsigned int bank_id, int bank_option, unsigned int option_count) const
+{
+    if (!is_shuffle_options || option_count != 4 || bank_option < 0 || bank_option > 3) {
+        return bank_option;
+    }
+
+    std::array<int, 4> order = OptionOrder (bank_id);
+    for (int i = 0; i < 4; ++i) {
+        if (order[i] == bank_option) {
+            return i;
+        }
+    }
+    return bank_option;
+}
+
+bool QuestionShuffle::IsIdentity () const
+{
+    return !is_shuffle_questions && !is_shuffle_options;
+}
@@ -0,0 +1,47 @@
+// QuestionShuffle.hpp
+#pragma once
+#include <array>
+
+/*
+* Per user question and option order, computed on the fly from the user's seed - nothing is copied
+* and nothing but the 64 bit seed is stored per user.
+*
+* The client only ever sees display ids 1..N and display option indices 0..3. The question order is
+* a keyed Feistel permutation of 0..N-1 (cycle walking on the next even bit width), so both ways of
+* the mapping cost a handful of multiplies. Options are one of the 24 orders of A-D, chosen from the
+* seed and the bank id so a question keeps its option order however often it is fetched.
+*
+* The controller maps ids and options into bank space when a request comes in, so grading, the
+* result tracker and the item analytics never see display values.
+*/
+class QuestionShuffle {
+
+public:
+    QuestionShuffle (unsigned long long seed, unsigned int question_count, bool is_shuffle_questions, bool is_shuffle_options);
+
+    static unsigned long long NewSeed ();
+
+    // 1 based ids, anything outside 1..N is returned unchanged
+    unsigned int ToBankId (unsigned int display_id) const;
+    unsigned int ToDisplayId (unsigned int bank_id) const;
+
+    // option indices, anything outside 0..3 is returned unchanged so validation still rejects it.
+    // Only questions with all four options are reordered, for the others both ways are the identity.
+    int ToBankOption (unsigned int bank_id, int display_option, unsigned int option_count) const;
+    int ToDisplayOption (unsigned int bank_id, int bank_option, unsigned int option_count) const;
+
+    bool IsIdentity () const;
+
+private:
+    unsigned long long seed;
+    unsigned int question_count;
+    bool is_shuffle_questions;
+    bool is_shuffle_options;
+    unsigned int half_bits;                 // Feistel works on two halves of this many bits
+    unsigned int half_mask;
+
+    unsigned int Round (unsigned int round, unsigned int half) const;
+    unsigned int Encrypt (unsigned int value) const;
+    unsigned int Decrypt (unsigned int value) const;
+    std::array<int, 4> OptionOrder (unsigned int bank_id) const;     // display index -> bank index
+};
@@ -1,29 +1,105 @@
 // QuizController.cpp
 #include "QuizController.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include "../QuizMgr.h"
+#include "Logger.h"
+#include "QuizClock.h"
+
+static const char * LOG_COMPONENT = "QuizController";
+
+#define LOGIN_BUSY_RETRY_MS     500         // base retry delay when every hashing thread is backed up
+#define TEST_PASSWORD           "1234"      // accepted for every user when no CredentialFile is configured
 
 QuizController::QuizController ()
     : session_mgr (SessionManager::GetInstance ()),
-    state_mgr (QuizStateManager::GetInstance ())
-{ }
-
-CommandType QuizController::ParseCommandType (const std::string & type) const
-{
-    static const std::unordered_map<std::string, CommandType> command_map = {
-        {"LOGIN", CommandType::LOGIN},
-        {"START_QUIZ", CommandType::START_QUIZ},
-        {"CONTINUE_QUIZ", CommandType::CONTINUE_QUIZ},
-        {"END_QUIZ", CommandType::END_QUIZ},
-        {"FETCH_QUESTION", CommandType::FETCH_QUESTION},
-        {"FETCH_UNATTEMPTED", CommandType::FETCH_UNATTEMPTED},
-        {"SUBMIT_ANSWER", CommandType::SUBMIT_ANSWER},
-        {"LOGOUT", CommandType::LOGOUT}
-    };
+    state_mgr (QuizStateManager::GetInstance ()),
+    login_bucket (QuizConfig::GetInstance ().GetLoginRate (), QuizConfig::GetInstance ().GetLoginBurst ()),
+    resume_tokens (QuizConfig::GetInstance ().GetResumeTokenTtlSec () * 1000)
+{
+    // item analytics follow every recorded answer change
+    Result::SetTransitionObserver ([] (const AnswerTransition & transition) {
+        ItemAnalytics::GetInstance ().RecordTransition (transition);
+                                   });
+
+    QuizConfig & cfg = QuizConfig::GetInstance ();
+
+    std::string archive_file = cfg.GetArchiveFile ();
+    if (!archive_file.empty () && !session_mgr.OpenArchive (archive_file)) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "User archive %s unusable, finished users stay in memory", archive_file.c_str ());
+    }
 
-    auto it = command_map.find (type);
-    return (it != command_map.end ()) ? it->second : CommandType::UNKNOWN;
+    std::string journal_file = cfg.GetAnswerJournalFile ();
+    if (!journal_file.empty ()) {
+        answer_journal.Open (journal_file);
+    }
+
+    // the io threads keep the other half of the cores during a login wave
+    std::string credential_file = cfg.GetCredentialFile ();
+    has_credential_file = !credential_file.empty ();
+    if (has_credential_file) {
+        size_t hash_threads = cfg.GetHashThreads ();
+        if (hash_threads == 0) {
+            hash_threads = std::max (1u, std::thread::hardware_concurrency () / 2);
+        }
+        if (!credentials.Load (credential_file, hash_threads, cfg.GetHashQueueLimit (), cfg.GetCredentialCacheTtlSec () * 1000)) {
+            QUIZ_LOG_ERROR (LOG_COMPONENT, "Credential file %s unusable, every LOGIN will fail", credential_file.c_str ());
+        }
+    } else {
+        QUIZ_LOG_WARN (LOG_COMPONENT, "No CredentialFile configured, LOGIN accepts the test password");
+    }
 }
 
+namespace {
+
+    // the json forms of the typed commands - same fields and defaults as RequestDecoder fills in
+    FetchQuestionCmd ToFetchQuestionCmd (const json & request)
+    {
+        FetchQuestionCmd cmd;
+        cmd.question_id = request.value ("question_id", 0);
+        cmd.is_prefetch = request.value ("prefetch", false);
+        return cmd;
+    }
+
+    SubmitAnswerCmd ToSubmitAnswerCmd (const json & request)
+    {
+        SubmitAnswerCmd cmd;
+        cmd.question_id = request.value ("question_id", 0);
+        for (int op : request.value ("selected_options", std::vector<int>{})) {
+            if (op >= 0 && op < 4) {
+                cmd.option_mask |= static_cast<unsigned char>(1u << op);
+            }
+        }
+        cmd.time_to_attempt_ms = request.value ("time_to_attempt_in_ms", 0LL);
+        return cmd;
+    }
+
+    // what the argument-less commands get when they arrive through the decoder
+    const json EMPTY_REQUEST = json::object ();
+
+    // deadlines are kept on the monotonic clock, the client gets them as wall time (0 = no deadline)
+    long long ToWireTime (long long monotonic_ms)
+    {
+        return monotonic_ms ? QuizClock::ToWallMs (monotonic_ms) : 0;
+    }
+
+    long long FromWireTime (long long wall_ms)
+    {
+        return wall_ms ? QuizClock::FromWallMs (wall_ms) : 0;
+    }
+
+    // one exam's output must not overwrite another's - "quiz_results.muqr" becomes "quiz_results_<exam>.muqr"
+    std::string ExamFile (const std::string & path, long long exam)
+    {
+        std::filesystem::path file (path);
+        std::filesystem::path named = file.parent_path () / file.stem ();
+        return named.string () + "_" + std::to_string (exam) + file.extension ().string ();
+    }
+
+} // anonymous namespace
+
 bool QuizController::IsCommandAllowed (CommandType cmd, const std::string & quiz_id) const
 {
     QuizState state = state_mgr.GetQuizState (quiz_id);
@@ -33,16 +109,30 @@ bool QuizController::IsCommandAllowed (CommandType cmd, const std::string & quiz
         state == QuizState::ENDED_FORCE_STOPPED ||
         state == QuizState::ENDED_COMPLETED) {
         return cmd == CommandType::LOGIN ||
+            cmd == CommandType::RESUME ||
             cmd == CommandType::END_QUIZ ||
+            cmd == CommandType::LEADERBOARD ||
+            cmd == CommandType::SUBSCRIBE_LEADERBOARD ||
+            cmd == CommandType::ITEM_STATS ||
+            cmd == CommandType::EXPORT_RESULTS ||
+            cmd == CommandType::RELOAD_BANK ||
             cmd == CommandType::LOGOUT;
     }
 
     // All commands allowed during active quiz
-    return state == QuizState::IN_PROGRESS || cmd == CommandType::LOGIN;
+    return state == QuizState::IN_PROGRESS || cmd == CommandType::LOGIN || cmd == CommandType::RESUME;
 }
 
-json QuizController::ProcessRequest (connection_hdl hdl, const json & request)
+/*
+* Requests may carry an optional unsigned "request_id". It is echoed back untouched in the response
+* (errors included), so a client can keep several requests in flight on one connection and match
+* each response to its request instead of relying on the response type or on ordering.
+*/
+void QuizController::ProcessRequest (connection_hdl hdl, const json & request, ResponseWriter & writer)
 {
+    writer.BeginObject ();
+    size_t mark = writer.Size ();
+
     try {
         std::string type_str = request.value ("type", "");
         CommandType cmd = ParseCommandType (type_str);
@@ -52,55 +142,346 @@ json QuizController::ProcessRequest (connection_hdl hdl, const json & request)
 
         // Check if command is allowed based on quiz state
         if (!IsCommandAllowed (cmd, quiz_id) && cmd != CommandType::LOGIN) {
-            return CreateErrorResponse ("Quiz has ended. Only result checking is allowed.");
+            WriteError (writer, "Quiz has ended. Only result checking is allowed.");
+        } else {
+            DispatchCommand (cmd, hdl, request, writer);
+        }
+    } catch (const std::exception & e) {
+        writer.Rewind (mark);
+        WriteError (writer, "Request processing failed: " + std::string (e.what ()));
+    }
+
+    auto id_it = request.find ("request_id");
+    if (id_it != request.end () && id_it->is_number_unsigned ()) {
+        writer.Field ("request_id", id_it->get<unsigned long long> ());
+    }
+
+    writer.EndObject ();
+}
+
+void QuizController::ProcessRequest (connection_hdl hdl, const DecodedRequest & request, ResponseWriter & writer)
+{
+    writer.BeginObject ();
+    size_t mark = writer.Size ();
+
+    try {
+        std::string quiz_id = "global_quiz";
+
+        if (!IsCommandAllowed (request.type, quiz_id)) {
+            WriteError (writer, "Quiz has ended. Only result checking is allowed.");
+        } else if (request.type == CommandType::FETCH_QUESTION) {
+            HandleFetchQuestion (hdl, request.fetch, writer);
+        } else if (request.type == CommandType::SUBMIT_ANSWER) {
+            HandleSubmitAnswer (hdl, request.submit, writer);
+        } else {
+            // the decoder only lets argument-less commands through besides the two above
+            DispatchCommand (request.type, hdl, EMPTY_REQUEST, writer);
+        }
+    } catch (const std::exception & e) {
+        writer.Rewind (mark);
+        WriteError (writer, "Request processing failed: " + std::string (e.what ()));
+    }
+
+    if (request.has_request_id) {
+        writer.Field ("request_id", request.request_id);
+    }
+
+    writer.EndObject ();
+}
+
+bool QuizController::ProcessRequestAsync (connection_hdl hdl, const DecodedRequest & request, HandlerTask & task)
+{
+    if (request.type != CommandType::SUBMIT_ANSWER || !answer_journal.IsOpen ()) {
+        return false;
+    }
+
+    task = SubmitAnswerAsync (hdl, request.submit, request.has_request_id, request.request_id);
+    return true;
+}
+
+bool QuizController::ProcessRequestAsync (connection_hdl hdl, const json & request, HandlerTask & task)
+{
+    if (!has_credential_file && !answer_journal.IsOpen ()) {
+        return false;
+    }
+
+    CommandType cmd = ParseCommandType (request.value ("type", ""));
+    bool is_async_login = cmd == CommandType::LOGIN && has_credential_file;
+    bool is_async_submit = (cmd == CommandType::SUBMIT_ANSWER || cmd == CommandType::SUBMIT_ANSWERS) && answer_journal.IsOpen ();
+    if (!is_async_login && !is_async_submit) {
+        return false;
+    }
+
+    auto id_it = request.find ("request_id");
+    bool has_request_id = id_it != request.end () && id_it->is_number_unsigned ();
+    unsigned long long request_id = has_request_id ? id_it->get<unsigned long long> () : 0;
+
+    if (is_async_login) {
+        task = LoginAsync (hdl, request.value ("username", ""), request.value ("password", ""), has_request_id, request_id);
+    } else if (cmd == CommandType::SUBMIT_ANSWERS) {
+        task = SubmitAnswersAsync (hdl, request, has_request_id, request_id);
+    } else {
+        task = SubmitAnswerAsync (hdl, ToSubmitAnswerCmd (request), has_request_id, request_id);
+    }
+    return true;
+}
+
+/*
+* The rate limit and a remembered login are answered on the spot, a real check suspends until a hashing
+* thread is done with it. The handler then resumes on the connection's strand, not the hashing thread, and
+* only there does CompleteLogin create the session - serialized with everything else on this connection.
+*/
+HandlerTask QuizController::LoginAsync (connection_hdl hdl, std::string username, std::string password, bool has_request_id, unsigned long long request_id)
+{
+    std::string response;
+    ResponseWriter writer (response);
+    writer.BeginObject ();
+    size_t mark = writer.Size ();
+
+    long long retry_after_ms;
+    if (!login_bucket.TryAcquire (retry_after_ms)) {
+        writer.Fields (RetryLoginResponse (retry_after_ms));
+    } else if (!credentials.IsLoaded ()) {
+        writer.Field ("type", "LOGIN_FAIL").Field ("reason", "Invalid credentials");
+    } else {
+        CredentialStore::Outcome outcome = co_await credentials.Verify (username, std::move (password));
+
+        try {
+            if (outcome == CredentialStore::Outcome::BUSY) {
+                writer.Fields (RetryLoginResponse (LOGIN_BUSY_RETRY_MS));
+            } else if (outcome == CredentialStore::Outcome::FAILED) {
+                writer.Field ("type", "LOGIN_FAIL").Field ("reason", "Invalid credentials");
+            } else {
+                writer.Fields (CompleteLogin (hdl, username));
+            }
+        } catch (const std::exception & e) {
+            writer.Rewind (mark);
+            WriteError (writer, "Request processing failed: " + std::string (e.what ()));
         }
+    }
+
+    if (has_request_id) {
+        writer.Field ("request_id", request_id);
+    }
+    writer.EndObject ();
+
+    co_return response;
+}
+
+/*
+* Write ahead - the answer is checked and resolved, journaled, and only once the journal has it on disk
+* graded and acknowledged. The coroutine owns its response buffer, the thread buffer of the thread it
+* started on is someone else's by the time it resumes.
+*/
+HandlerTask QuizController::SubmitAnswerAsync (connection_hdl hdl, SubmitAnswerCmd cmd, bool has_request_id, unsigned long long request_id)
+{
+    std::string response;
+    ResponseWriter writer (response);
+    writer.BeginObject ();
+    size_t mark = writer.Size ();
 
-        switch (cmd) {
-            case CommandType::LOGIN:
-                return HandleLogin (hdl, request);
-            case CommandType::START_QUIZ:
-                return HandleStartQuiz (hdl, request);
-            case CommandType::CONTINUE_QUIZ:
-                return HandleContinueQuiz (hdl, request);
-            case CommandType::END_QUIZ:
-                return HandleEndQuiz (hdl, request);
-            case CommandType::FETCH_QUESTION:
-                return HandleFetchQuestion (hdl, request);
-            case CommandType::FETCH_UNATTEMPTED:
-                return HandleFetchUnattempted (hdl, request);
-            case CommandType::SUBMIT_ANSWER:
-                return HandleSubmitAnswer (hdl, request);
-            case CommandType::LOGOUT:
-                return HandleLogout (hdl, request);
-            default:
-                return CreateErrorResponse ("Unknown command");
+    PreparedAnswer prepared;
+    bool is_prepared = false;
+    try {
+        if (!IsCommandAllowed (CommandType::SUBMIT_ANSWER, "global_quiz")) {
+            WriteError (writer, "Quiz has ended. Only result checking is allowed.");
+        } else {
+            is_prepared = PrepareSubmitAnswer (hdl, cmd, writer, prepared);
         }
     } catch (const std::exception & e) {
-        return CreateErrorResponse ("Request processing failed: " + std::string (e.what ()));
+        writer.Rewind (mark);
+        WriteError (writer, "Request processing failed: " + std::string (e.what ()));
     }
+
+    if (is_prepared) {
+        std::array<bool, 4> selected = prepared.answer.GetSelectedOp ();
+        json record = {
+            {"event", "answer"},
+            {"at", QuizClock::WallNowMs ()},
+            {"user", prepared.username},
+            {"question_id", prepared.bank_id},
+            {"selected_options", json::array ()},
+            {"time_to_attempt_in_ms", prepared.time_to_attempt_ms}
+        };
+        for (int op = 0; op < 4; ++op) {
+            if (selected[op]) {
+                record["selected_options"].push_back (op);
+            }
+        }
+
+        bool is_durable = co_await answer_journal.Commit (record.dump ());
+
+        try {
+            if (is_durable) {
+                ApplySubmitAnswer (prepared, writer);
+            } else {
+                WriteError (writer, "Answer could not be saved, please submit it again");
+            }
+        } catch (const std::exception & e) {
+            writer.Rewind (mark);
+            WriteError (writer, "Request processing failed: " + std::string (e.what ()));
+        }
+    }
+
+    if (has_request_id) {
+        writer.Field ("request_id", request_id);
+    }
+    writer.EndObject ();
+
+    co_return response;
+}
+
+// SUBMIT_ANSWERS the same way - one journal record for the whole batch, graded once it is on disk
+HandlerTask QuizController::SubmitAnswersAsync (connection_hdl hdl, json request, bool has_request_id, unsigned long long request_id)
+{
+    std::string response;
+    ResponseWriter writer (response);
+    writer.BeginObject ();
+    size_t mark = writer.Size ();
+
+    PreparedBatch prepared;
+    bool is_prepared = false;
+    try {
+        json error;
+        if (!IsCommandAllowed (CommandType::SUBMIT_ANSWERS, "global_quiz")) {
+            WriteError (writer, "Quiz has ended. Only result checking is allowed.");
+        } else if (PrepareSubmitAnswers (hdl, request, error, prepared)) {
+            is_prepared = true;
+        } else {
+            writer.Fields (error);
+        }
+    } catch (const std::exception & e) {
+        writer.Rewind (mark);
+        WriteError (writer, "Request processing failed: " + std::string (e.what ()));
+    }
+
+    if (is_prepared) {
+        bool is_durable = co_await answer_journal.Commit (JournalRecord (prepared).dump ());
+
+        try {
+            if (is_durable) {
+                writer.Fields (ApplySubmitAnswers (prepared));
+            } else {
+                WriteError (writer, "Answers could not be saved, please submit them again");
+            }
+        } catch (const std::exception & e) {
+            writer.Rewind (mark);
+            WriteError (writer, "Request processing failed: " + std::string (e.what ()));
+        }
+    }
+
+    if (has_request_id) {
+        writer.Field ("request_id", request_id);
+    }
+    writer.EndObject ();
+
+    co_return response;
 }
 
+// the handlers that still build a json response have its members copied into the open response object
+void QuizController::DispatchCommand (CommandType cmd, connection_hdl hdl, const json & request, ResponseWriter & writer)
+{
+    switch (cmd) {
+        case CommandType::LOGIN:
+            writer.Fields (HandleLogin (hdl, request));
+            break;
+        case CommandType::START_QUIZ:
+            writer.Fields (HandleStartQuiz (hdl, request));
+            break;
+        case CommandType::CONTINUE_QUIZ:
+            writer.Fields (HandleContinueQuiz (hdl, request));
+            break;
+        case CommandType::END_QUIZ:
+            writer.Fields (HandleEndQuiz (hdl, request));
+            break;
+        case CommandType::FETCH_QUESTION:
+            HandleFetchQuestion (hdl, ToFetchQuestionCmd (request), writer);
+            break;
+        case CommandType::FETCH_QUESTIONS:
+            HandleFetchQuestions (hdl, request, writer);
+            break;
+        case CommandType::FETCH_UNATTEMPTED:
+            writer.Fields (HandleFetchUnattempted (hdl, request));
+            break;
+        case CommandType::SUBMIT_ANSWER:
+            HandleSubmitAnswer (hdl, ToSubmitAnswerCmd (request), writer);
+            break;
+        case CommandType::SUBMIT_ANSWERS:
+            writer.Fields (HandleSubmitAnswers (hdl, request));
+            break;
+        case CommandType::LOGOUT:
+            writer.Fields (HandleLogout (hdl, request));
+            break;
+        case CommandType::RESUME:
+            writer.Fields (HandleResume (hdl, request));
+            break;
+        case CommandType::LEADERBOARD:
+            writer.Fields (HandleLeaderboard (hdl, request));
+            break;
+        case CommandType::SUBSCRIBE_LEADERBOARD:
+            writer.Fields (HandleSubscribeLeaderboard (hdl, request));
+            break;
+        case CommandType::ITEM_STATS:
+            writer.Fields (HandleItemStats (hdl, request));
+            break;
+        case CommandType::EXPORT_RESULTS:
+            writer.Fields (HandleExportResults (hdl, request));
+            break;
+        case CommandType::RELOAD_BANK:
+            writer.Fields (HandleReloadBank (hdl, request));
+            break;
+        default:
+            WriteError (writer, "Unknown command");
+            break;
+    }
+}
+
+// LOGIN without a credential file, see LoginAsync for the real one
 json QuizController::HandleLogin (connection_hdl hdl, const json & request)
 {
+    long long retry_after_ms;
+    if (!login_bucket.TryAcquire (retry_after_ms)) {
+        return RetryLoginResponse (retry_after_ms);
+    }
+
     std::string username = request.value ("username", "");
     std::string password = request.value ("password", "");
 
-    if (password != "1234") {
+    if (has_credential_file || password != TEST_PASSWORD) {
         return {{"type", "LOGIN_FAIL"}, {"reason", "Invalid credentials"}};
     }
 
+    return CompleteLogin (hdl, username);
+}
+
+json QuizController::RetryLoginResponse (long long retry_after_ms) const
+{
+    return {
+        {"type", "RETRY_AFTER"},
+        {"command", "LOGIN"},
+        {"retry_after_ms", TokenBucket::JitterRetryDelay (retry_after_ms)}
+    };
+}
+
+// the password is good - binds the connection to the user
+json QuizController::CompleteLogin (connection_hdl hdl, const std::string & username)
+{
     if (session_mgr.IsUserLoggedIn (username)) {
         return {{"type", "LOGIN_FAIL"}, {"reason", "User already logged in"}};
     }
 
-    // Check if reconnection
-    bool is_reconnection = session_mgr.GetUser (username) != nullptr;
-
     if (!session_mgr.AddSession (hdl, username)) {
         return {{"type", "LOGIN_FAIL"}, {"reason", "Session creation failed"}};
     }
 
-    json response = {{"type", "LOGIN_OK"}, {"welcome", username}};
+    // Check if reconnection - an archived user is brought back only now, once the session keeps it in memory
+    bool is_reconnection = session_mgr.LoadUser (username) != nullptr;
+
+    json response = {
+        {"type", "LOGIN_OK"},
+        {"welcome", username},
+        {"resume_token", resume_tokens.Issue (username)}
+    };
     if (is_reconnection) {
         response["note"] = "Reconnected";
     }
@@ -108,7 +489,7 @@ json QuizController::HandleLogin (connection_hdl hdl, const json & request)
     return response;
 }
 
-json QuizController::HandleStartQuiz (connection_hdl hdl, const json & request)
+json QuizController::HandleStartQuiz (connection_hdl hdl, const json &)
 {
     std::string error_msg;
     if (!session_mgr.ValidateSession (hdl, error_msg)) {
@@ -120,41 +501,56 @@ json QuizController::HandleStartQuiz (connection_hdl hdl, const json & request)
         return CreateErrorResponse ("Quiz already started");
     }
 
-    // Create user and initialize quiz
-    if (!session_mgr.CreateUser (username)) {
-        return CreateErrorResponse ("Failed to create user session");
-    }
+    // the exam runs on the bank as it is now, a later reload with new answer keys does not touch it
+    std::shared_ptr<const QuestionBank::Snapshot> bank = QuestionBank::GetInstance ().GetSnapshot ();
 
-    auto user = session_mgr.GetUser (username);
     QuizConfig & cfg = QuizConfig::GetInstance ();
     eQuizMode quiz_mode = cfg.GetQuizMode ();
-    unsigned int ques_count = QuestionBank::GetInstance ().TotalQuestionCount ();
-    long long time_allowed_in_ms = cfg.GetTimeAllowedBasedOnQuizMode () * 1000;
-
-    // Configure user based on quiz mode
-    if (quiz_mode != BULLET_TIMER_MODE) {
+    unsigned int ques_count = bank->TotalQuestionCount ();
 
-        user->SetTotalTimeLimit (time_allowed_in_ms);
-
-        if (quiz_mode == STRICT_TIME_BOUND_MODE) {
-            user->SetStartTimeInMs (QuizHelper::get_current_time_in_ms ());
-            user->SetEndTimeInMs (user->GetStartTimeInMs () + time_allowed_in_ms);
+    long long time_allowed_in_ms = cfg.GetTimeAllowedBasedOnQuizMode () * 1000;
 
-            // Start global quiz timer
-            std::string quiz_id = "global_quiz";
+    // Configure user based on quiz mode - worked out up front, CreateUser sets it all before others can see the user
+    long long total_time_ms = time_allowed_in_ms;
+    long long start_ms = 0;
+    long long end_ms = 0;
+    if (quiz_mode == BULLET_TIMER_MODE) {
+        total_time_ms = time_allowed_in_ms * ques_count;
+    } else if (quiz_mode == STRICT_TIME_BOUND_MODE) {
+        start_ms = QuizClock::NowMs ();
+        end_ms = start_ms + time_allowed_in_ms;
+    }
 
-            if (!state_mgr.IsQuizActive (quiz_id)) {
+    auto user = session_mgr.CreateUser (username, bank, QuestionShuffle::NewSeed (), total_time_ms, start_ms, end_ms);
+    if (!user) {
+        return CreateErrorResponse ("Failed to create user session");
+    }
 
-                state_mgr.StartQuiz (quiz_id, time_allowed_in_ms);
+    if (quiz_mode == STRICT_TIME_BOUND_MODE) {
+        // Start global quiz timer
+        std::string quiz_id = "global_quiz";
 
-                // Register notification callback
-                state_mgr.RegisterClient (quiz_id, [this] (const std::string & message) {
-                    session_mgr.NotifyAllUsers (message);
-                                          });
-            }
+        if (!state_mgr.IsQuizActive (quiz_id)) {
+            BeginExam ();
+            StartQuizTimer (quiz_id, time_allowed_in_ms);
         }
-    } else {
-        user->SetTotalTimeLimit (time_allowed_in_ms * ques_count);
+    }
+
+    UpdateLeaderboard (username, user);
+
+    // the user's exam setup goes ahead of its answers in the journal, RecoverFromJournal needs it first
+    if (answer_journal.IsOpen ()) {
+        json record = {
+            {"event", "start"},
+            {"at", QuizClock::WallNowMs ()},
+            {"user", username},
+            {"exam", exam_id.load ()},
+            {"seed", user->GetShuffleSeed ()},
+            {"start_time", ToWireTime (user->GetStartTimeInMs ())},
+            {"end_time", ToWireTime (user->GetEndTimeInMs ())},
+            {"total_time", user->GetTotalTimeLimit ()}
+        };
+        answer_journal.Commit (record.dump (), [] (bool) { });
     }
 
     return {
@@ -164,11 +560,11 @@ json QuizController::HandleStartQuiz (connection_hdl hdl, const json & request)
         {"is_multioption_allowed", cfg.IsMultiOptionSelect ()},
         {"is_kbc_mode", cfg.IsKBCMode ()},
         {"total_time", user->GetTotalTimeLimit ()},
-        {"end_time", user->GetEndTimeInMs ()}
+        {"end_time", ToWireTime (user->GetEndTimeInMs ())}
     };
 }
 
-json QuizController::HandleContinueQuiz (connection_hdl hdl, const json & request)
+json QuizController::HandleContinueQuiz (connection_hdl hdl, const json &)
 {
     std::string error_msg;
     if (!session_mgr.ValidateSession (hdl, error_msg)) {
@@ -199,18 +595,18 @@ json QuizController::HandleContinueQuiz (connection_hdl hdl, const json & reques
 
     return {
         {"type", "QUIZ_RESTARTED"},
-        {"total_questions", QuestionBank::GetInstance ().TotalQuestionCount ()},
+        {"total_questions", user->GetQuestionBank ()->TotalQuestionCount ()},
         {"quiz_mode", quiz_mode},
         {"is_multioption_allowed", cfg.IsMultiOptionSelect ()},
         {"is_kbc_mode", cfg.IsKBCMode ()},
         {"total_time", user->GetTotalTimeLimit ()},
         {"updated_elapsed_time", user->GetElapsedTime ()},
-        {"end_time", user->GetEndTimeInMs ()},
-        {"question_ids", unattempted}
+        {"end_time", ToWireTime (user->GetEndTimeInMs ())},
+        {"question_ids", ToDisplayIds (GetShuffle (user), unattempted)}
     };
 }
 
-json QuizController::HandleEndQuiz (connection_hdl hdl, const json & request)
+json QuizController::HandleEndQuiz (connection_hdl hdl, const json &)
 {
     std::string error_msg;
     if (!session_mgr.ValidateSession (hdl, error_msg)) {
@@ -223,54 +619,172 @@ json QuizController::HandleEndQuiz (connection_hdl hdl, const json & request)
     }
 
     // TODO: Generate and return quiz results
-    return {
+    json response = {
         {"type", "QUIZ_RESULT"},
         {"score", user->GetUserCurrentScore ()},
         {"total_time", user->GetTotalTimeLimit ()},
         {"elapsed_time", user->GetElapsedTime ()}
         // Add more result details as needed
     };
+
+    unsigned int rank;
+    size_t total;
+    if (Leaderboard::GetInstance ().GetRank (session_mgr.GetUsername (hdl), rank, total)) {
+        response["rank"] = rank;
+        response["total_ranked"] = total;
+    }
+    return response;
 }
 
-json QuizController::HandleFetchQuestion (connection_hdl hdl, const json & request)
+/*
+* FETCH_QUESTION - written straight from the pinned snapshot's Question (text and options are views
+* into the string arena), in the user's option order. Nothing is allocated for the response itself.
+*/
+void QuizController::HandleFetchQuestion (connection_hdl hdl, const FetchQuestionCmd & cmd, ResponseWriter & writer)
 {
     std::string error_msg;
     if (!session_mgr.ValidateSession (hdl, error_msg)) {
-        return CreateErrorResponse (error_msg);
+        WriteError (writer, error_msg);
+        return;
     }
 
     auto user = session_mgr.GetUserByHandle (hdl);
     if (!user) {
-        return CreateErrorResponse ("Start the quiz first");
+        WriteError (writer, "Start the quiz first");
+        return;
     }
 
-    unsigned int qid = request.value ("question_id", 0);
-    QuestionBank & qb = QuestionBank::GetInstance ();
+    unsigned int qid = cmd.question_id;
+    std::shared_ptr<const QuestionBank::Snapshot> bank = user->GetQuestionBank ();
 
-    if (qid <= 0 || qid > qb.TotalQuestionCount ()) {
-        return CreateErrorResponse ("Invalid question ID");
+    if (qid <= 0 || qid > bank->TotalQuestionCount ()) {
+        WriteError (writer, "Invalid question ID");
+        return;
     }
 
     if (CheckTimeElapsed (user, QuizConfig::GetInstance ().GetQuizMode ())) {
-        return CreateErrorResponse ("Quiz time has elapsed");
+        WriteError (writer, "Quiz time has elapsed");
+        return;
     }
 
-    user->SetLastActivityTimeInMs ();
+    // a prefetch is not the user looking at the question, it must not move the activity clock
+    if (!cmd.is_prefetch) {
+        user->SetLastActivityTimeInMs ();
+    }
 
-    auto question = qb.GetQuestionById (qid);
+    QuestionShuffle shuffle = GetShuffle (user);
+    unsigned int bank_id = shuffle.ToBankId (qid);
+    std::shared_ptr<const Question> ques = bank->GetQuestionById (bank_id);
+    if (!ques) {
+        WriteError (writer, "Invalid question ID");
+        return;
+    }
 
-    return {
-        {"type", "QUESTION"},
-        {"id", question->GetQuestionID ()},
-        {"text", question->GetQuestionText ()},
-        {"options", question->GetQuestionOptions ()},
-        {"total_time", user->GetTotalTimeLimit ()},
-        {"updated_elapsed_time", user->GetElapsedTime ()},
-        {"question_timer", CalculateQuestionTimer (user)}
-    };
+    writer.Field ("type", "QUESTION");
+    WriteQuestion (writer, shuffle, qid, bank_id, *ques);
+
+    writer.Field ("total_time", user->GetTotalTimeLimit ())
+        .Field ("updated_elapsed_time", user->GetElapsedTime ())
+        .Field ("question_timer", CalculateQuestionTimer (user));
+}
+
+// "id", "text" and "options" of one question, in the user's option order
+void QuizController::WriteQuestion (ResponseWriter & writer, const QuestionShuffle & shuffle, unsigned int display_id,
+                                    unsigned int bank_id, const Question & ques)
+{
+    std::span<const std::string_view> options = ques.GetQuestionOptions ();
+
+    writer.Field ("id", display_id)
+        .Field ("text", ques.GetQuestionText ());
+
+    writer.Key ("options").BeginArray ();
+    for (unsigned int i = 0; i < options.size (); ++i) {
+        writer.String (options[shuffle.ToBankOption (bank_id, i, ques.GetOptionCount ())]);
+    }
+    writer.EndArray ();
+}
+
+/*
+* FETCH_QUESTIONS - many questions in one frame.
+* Takes either "question_ids": [..] or an inclusive "from"/"to" range. The user is resolved and the
+* pinned snapshot looked up once for the whole batch, ids outside the bank are reported in "invalid_ids".
+* Like FETCH_QUESTION the questions are written straight from the arena views.
+* With "prefetch": true the client is filling its cache ahead of display, so user activity is not touched.
+*/
+void QuizController::HandleFetchQuestions (connection_hdl hdl, const json & request, ResponseWriter & writer)
+{
+    std::string error_msg;
+    if (!session_mgr.ValidateSession (hdl, error_msg)) {
+        WriteError (writer, error_msg);
+        return;
+    }
+
+    auto user = session_mgr.GetUserByHandle (hdl);
+    if (!user) {
+        WriteError (writer, "Start the quiz first");
+        return;
+    }
+
+    if (CheckTimeElapsed (user, QuizConfig::GetInstance ().GetQuizMode ())) {
+        WriteError (writer, "Quiz time has elapsed");
+        return;
+    }
+
+    std::vector<unsigned int> qids;
+    if (request.contains ("question_ids")) {
+        qids = request.value ("question_ids", std::vector<unsigned int>{});
+    } else {
+        unsigned int from = request.value ("from", 0u);
+        unsigned int to = request.value ("to", 0u);
+        if (from == 0 || to < from || to - from >= MAX_BATCH_SIZE) {
+            WriteError (writer, "Invalid question range");
+            return;
+        }
+        for (unsigned int qid = from; qid <= to; ++qid) {
+            qids.push_back (qid);
+        }
+    }
+
+    if (qids.empty () || qids.size () > MAX_BATCH_SIZE) {
+        WriteError (writer, "Batch must carry 1 to " + std::to_string (MAX_BATCH_SIZE) + " question ids");
+        return;
+    }
+
+    if (!request.value ("prefetch", false)) {
+        user->SetLastActivityTimeInMs ();
+    }
+
+    std::shared_ptr<const QuestionBank::Snapshot> bank = user->GetQuestionBank ();
+    QuestionShuffle shuffle = GetShuffle (user);
+    std::vector<unsigned int> invalid_ids;
+
+    writer.Field ("type", "QUESTIONS");
+    writer.Key ("questions").BeginArray ();
+    for (unsigned int qid : qids) {
+        unsigned int bank_id = shuffle.ToBankId (qid);
+        std::shared_ptr<const Question> ques = bank->GetQuestionById (bank_id);
+        if (!ques) {
+            invalid_ids.push_back (qid);
+            continue;
+        }
+        writer.BeginObject ();
+        WriteQuestion (writer, shuffle, qid, bank_id, *ques);
+        writer.EndObject ();
+    }
+    writer.EndArray ();
+
+    writer.Key ("invalid_ids").BeginArray ();
+    for (unsigned int qid : invalid_ids) {
+        writer.UInt (qid);
+    }
+    writer.EndArray ();
+
+    writer.Field ("total_time", user->GetTotalTimeLimit ())
+        .Field ("updated_elapsed_time", user->GetElapsedTime ())
+        .Field ("question_timer", CalculateQuestionTimer (user));
 }
 
-json QuizController::HandleFetchUnattempted (connection_hdl hdl, const json & request)
+json QuizController::HandleFetchUnattempted (connection_hdl hdl, const json &)
 {
     std::string error_msg;
     if (!session_mgr.ValidateSession (hdl, error_msg)) {
@@ -295,58 +809,219 @@ json QuizController::HandleFetchUnattempted (connection_hdl hdl, const json & re
 
     return {
         {"type", "UNATTEMPTED_QUESTIONS"},
-        {"question_ids", unattempted}
+        {"question_ids", ToDisplayIds (GetShuffle (user), unattempted)}
     };
 }
 
-json QuizController::HandleSubmitAnswer (connection_hdl hdl, const json & request)
+void QuizController::HandleSubmitAnswer (connection_hdl hdl, const SubmitAnswerCmd & cmd, ResponseWriter & writer)
+{
+    PreparedAnswer prepared;
+    if (PrepareSubmitAnswer (hdl, cmd, writer, prepared)) {
+        ApplySubmitAnswer (prepared, writer);
+    }
+}
+
+bool QuizController::PrepareSubmitAnswer (connection_hdl hdl, const SubmitAnswerCmd & cmd, ResponseWriter & writer, PreparedAnswer & prepared)
 {
     std::string error_msg;
 
     if (!session_mgr.ValidateSession (hdl, error_msg)) {
-        return CreateErrorResponse (error_msg);
+        WriteError (writer, error_msg);
+        return false;
     }
 
     auto user = session_mgr.GetUserByHandle (hdl);
     if (!user) {
-        return CreateErrorResponse ("Start the quiz first");
+        WriteError (writer, "Start the quiz first");
+        return false;
     }
 
     if (CheckTimeElapsed (user, QuizConfig::GetInstance ().GetQuizMode ())) {
-        return CreateErrorResponse ("Quiz time has elapsed");
+        WriteError (writer, "Quiz time has elapsed");
+        return false;
     }
 
-    unsigned int qid = request.value ("question_id", 0);
-    QuestionBank & qb = QuestionBank::GetInstance ();
+    unsigned int qid = cmd.question_id;
 
-    if (qid <= 0 || qid > qb.TotalQuestionCount ()) {
-        return CreateErrorResponse ("Invalid question ID");
+    if (qid <= 0 || qid > user->GetQuestionBank ()->TotalQuestionCount ()) {
+        WriteError (writer, "Invalid question ID");
+        return false;
     }
 
     user->SetLastActivityTimeInMs ();
 
-    Answer ans (qid);
-    for (int op : request.value ("selected_options", std::vector<int>{})) {
-        ans.SetSelectedOp (op);
+    // the client answers in display ids and option positions, grading happens in bank space
+    QuestionShuffle shuffle = GetShuffle (user);
+    unsigned int bank_id = shuffle.ToBankId (qid);
+    unsigned int option_count = OptionCount (user, bank_id);
+
+    prepared.answer.SetQuestionId (bank_id);
+    for (int op = 0; op < 4; ++op) {
+        if (cmd.option_mask & (1u << op)) {
+            prepared.answer.SetSelectedOp (shuffle.ToBankOption (bank_id, op, option_count));
+        }
     }
 
-    long long time_to_attempt = request.value ("time_to_attempt_in_ms", 0);
-    user->AddToElapsedTimeInQuiz (time_to_attempt);
+    prepared.user = std::move (user);
+    prepared.username = session_mgr.GetUsername (hdl);
+    prepared.question_id = qid;
+    prepared.bank_id = bank_id;
+    prepared.time_to_attempt_ms = cmd.time_to_attempt_ms;
+    return true;
+}
+
+void QuizController::ApplySubmitAnswer (PreparedAnswer & prepared, ResponseWriter & writer)
+{
+    const std::shared_ptr<User> & user = prepared.user;
 
-    eQuesAttemptStatus status = user->SetAndValidateUserAnswer (ans);
+    user->AddToElapsedTimeInQuiz (prepared.time_to_attempt_ms);
+    ItemAnalytics::GetInstance ().RecordAnswerTime (prepared.bank_id, prepared.time_to_attempt_ms);
+
+    eQuesAttemptStatus status = user->SetAndValidateUserAnswer (prepared.answer);
     double score = user->GetUserCurrentScore ();
+    UpdateLeaderboard (prepared.username, user);
+
+    writer.Field ("type", "ANSWER_SUBMITTED")
+        .Field ("question_id", prepared.question_id)
+        .Field ("status", static_cast<int>(status))
+        .Field ("score", score)
+        .Field ("total_time", user->GetTotalTimeLimit ())
+        .Field ("updated_elapsed_time", user->GetElapsedTime ())
+        .Field ("seq", user->GetSequence ());
+}
+
+/*
+* SUBMIT_ANSWERS - flushes several answers in one frame, "answers" holds objects shaped like SUBMIT_ANSWER.
+* The whole batch is graded with one lookup of the answer keys. Entries with a bad question id are
+* reported back as errors and do not stop the rest of the batch.
+*/
+json QuizController::HandleSubmitAnswers (connection_hdl hdl, const json & request)
+{
+    PreparedBatch prepared;
+    json error;
+    if (!PrepareSubmitAnswers (hdl, request, error, prepared)) {
+        return error;
+    }
+    return ApplySubmitAnswers (prepared);
+}
+
+bool QuizController::PrepareSubmitAnswers (connection_hdl hdl, const json & request, json & error, PreparedBatch & prepared)
+{
+    std::string error_msg;
+
+    if (!session_mgr.ValidateSession (hdl, error_msg)) {
+        error = CreateErrorResponse (error_msg);
+        return false;
+    }
+
+    auto user = session_mgr.GetUserByHandle (hdl);
+    if (!user) {
+        error = CreateErrorResponse ("Start the quiz first");
+        return false;
+    }
+
+    if (CheckTimeElapsed (user, QuizConfig::GetInstance ().GetQuizMode ())) {
+        error = CreateErrorResponse ("Quiz time has elapsed");
+        return false;
+    }
+
+    auto answers_it = request.find ("answers");
+    if (answers_it == request.end () || !answers_it->is_array () ||
+        answers_it->empty () || answers_it->size () > MAX_BATCH_SIZE) {
+        error = CreateErrorResponse ("Batch must carry 1 to " + std::to_string (MAX_BATCH_SIZE) + " answers");
+        return false;
+    }
+
+    const unsigned int total_questions = user->GetQuestionBank ()->TotalQuestionCount ();
+    QuestionShuffle shuffle = GetShuffle (user);
+
+    prepared.answers.reserve (answers_it->size ());
+    prepared.graded_ids.reserve (answers_it->size ());
+    prepared.answer_times.reserve (answers_it->size ());
+    prepared.results = json::array ();
+
+    for (const json & entry : *answers_it) {
+        unsigned int qid = entry.value ("question_id", 0u);
+
+        if (qid == 0 || qid > total_questions) {
+            prepared.results.push_back ({{"question_id", qid}, {"error", "Invalid question ID"}});
+            continue;
+        }
+
+        unsigned int bank_id = shuffle.ToBankId (qid);
+        unsigned int option_count = OptionCount (user, bank_id);
+        Answer ans (bank_id);
+        for (int op : entry.value ("selected_options", std::vector<int>{})) {
+            ans.SetSelectedOp (shuffle.ToBankOption (bank_id, op, option_count));
+        }
+        prepared.answers.push_back (std::move (ans));
+        prepared.graded_ids.push_back (qid);
+        prepared.answer_times.push_back (entry.value ("time_to_attempt_in_ms", 0LL));
+    }
+
+    user->SetLastActivityTimeInMs ();
+
+    prepared.user = std::move (user);
+    prepared.username = session_mgr.GetUsername (hdl);
+    return true;
+}
+
+json QuizController::ApplySubmitAnswers (PreparedBatch & prepared)
+{
+    const std::shared_ptr<User> & user = prepared.user;
+
+    long long time_to_attempt = 0;
+    for (size_t i = 0; i < prepared.answers.size (); ++i) {
+        time_to_attempt += prepared.answer_times[i];
+        ItemAnalytics::GetInstance ().RecordAnswerTime (prepared.answers[i].GetQuestionId (), prepared.answer_times[i]);
+    }
+    user->AddToElapsedTimeInQuiz (time_to_attempt);
+
+    std::vector<eQuesAttemptStatus> statuses = user->SetAndValidateUserAnswers (prepared.answers);
+    UpdateLeaderboard (prepared.username, user);
+
+    for (size_t i = 0; i < statuses.size (); ++i) {
+        prepared.results.push_back ({{"question_id", prepared.graded_ids[i]}, {"status", static_cast<int>(statuses[i])}});
+    }
 
     return {
-        {"type", "ANSWER_SUBMITTED"},
-        {"question_id", qid},
-        {"status", static_cast<int>(status)},
-        {"score", score},
+        {"type", "ANSWERS_SUBMITTED"},
+        {"results", std::move (prepared.results)},
+        {"score", user->GetUserCurrentScore ()},
         {"total_time", user->GetTotalTimeLimit ()},
-        {"updated_elapsed_time", user->GetElapsedTime ()}
+        {"updated_elapsed_time", user->GetElapsedTime ()},
+        {"seq", user->GetSequence ()}
     };
 }
 
-json QuizController::HandleLogout (connection_hdl hdl, const json & request)
+// bank space record of a batch, RecoverFromJournal grades it again through ApplySubmitAnswers
+json QuizController::JournalRecord (const PreparedBatch & prepared)
+{
+    json answers = json::array ();
+    for (size_t i = 0; i < prepared.answers.size (); ++i) {
+        std::array<bool, 4> selected = prepared.answers[i].GetSelectedOp ();
+        json options = json::array ();
+        for (int op = 0; op < 4; ++op) {
+            if (selected[op]) {
+                options.push_back (op);
+            }
+        }
+        answers.push_back ({
+            {"question_id", prepared.answers[i].GetQuestionId ()},
+            {"selected_options", std::move (options)},
+            {"time_to_attempt_in_ms", prepared.answer_times[i]}
+        });
+    }
+
+    return {
+        {"event", "answers"},
+        {"at", QuizClock::WallNowMs ()},
+        {"user", prepared.username},
+        {"answers", std::move (answers)}
+    };
+}
+
+json QuizController::HandleLogout (connection_hdl hdl, const json &)
 {
     std::string username = session_mgr.GetUsername (hdl);
     auto user = session_mgr.GetUser (username);
@@ -357,9 +1032,237 @@ json QuizController::HandleLogout (connection_hdl hdl, const json & request)
 
     session_mgr.RemoveSession (hdl);
 
+    // an explicit logout ends the session for good - tokens issued so far must not bring it back
+    if (!username.empty ()) {
+        resume_tokens.Revoke (username);
+        credentials.Forget (username);
+        Leaderboard::GetInstance ().Unsubscribe (username);
+    }
+
     return {{"type", "LOGOUT_OK"}, {"Bye", username}};
 }
 
+/*
+* RESUME - { "resume_token", "last_seq" }, the cheap way back after a dropped connection.
+* The token replaces the password check and names the user, so the session is moved onto this
+* handle with two hash lookups. Instead of the full CONTINUE_QUIZ state only the answers graded
+* after "last_seq" are returned - usually none, or the one whose response was lost with the connection.
+* A client that is ahead of the server (e.g. state restored from an older file) gets the full list.
+* On RESUME_FAIL the client falls back to LOGIN.
+*/
+json QuizController::HandleResume (connection_hdl hdl, const json & request)
+{
+    std::string username;
+    if (!resume_tokens.Verify (request.value ("resume_token", ""), username)) {
+        return {{"type", "RESUME_FAIL"}, {"reason", "Invalid or expired resume token"}};
+    }
+
+    bool was_bound;
+    if (!session_mgr.RebindSession (hdl, username, was_bound)) {
+        return {{"type", "RESUME_FAIL"}, {"reason", "Connection already has a session"}};
+    }
+
+    json response = {
+        {"type", "RESUME_OK"},
+        {"welcome", username},
+        {"resume_token", resume_tokens.Issue (username)}
+    };
+
+    auto user = session_mgr.LoadUser (username);
+    if (!user) {
+        response["quiz_started"] = false;
+        return response;
+    }
+
+    // the old connection never reported its disconnect, settle its time now
+    if (was_bound) {
+        CalculateElapsedTimeOnDisconnection (user);
+    }
+
+    unsigned long long last_seq = request.value ("last_seq", 0ULL);
+    unsigned long long seq = user->GetSequence ();
+    bool is_full = last_seq > seq;
+
+    QuestionShuffle shuffle = GetShuffle (user);
+    json changes = json::array ();
+    unsigned long long change_seq = is_full ? 0 : last_seq;
+    for (const auto & [qid, status] : user->GetChangesSince (change_seq)) {
+        changes.push_back ({{"seq", ++change_seq}, {"question_id", shuffle.ToDisplayId (qid)}, {"status", static_cast<int>(status)}});
+    }
+
+    response["quiz_started"] = true;
+    response["seq"] = seq;
+    response["full"] = is_full;
+    response["changes"] = std::move (changes);
+    response["score"] = user->GetUserCurrentScore ();
+    response["total_time"] = user->GetTotalTimeLimit ();
+    response["updated_elapsed_time"] = user->GetElapsedTime ();
+    response["end_time"] = ToWireTime (user->GetEndTimeInMs ());
+    response["time_elapsed"] = CheckTimeElapsed (user, QuizConfig::GetInstance ().GetQuizMode ());
+
+    if (is_full) {
+        response["question_ids"] = ToDisplayIds (shuffle, user->GetUnattemptedQuestionIds ());
+    }
+    return response;
+}
+
+/*
+* LEADERBOARD - { "top": k } returns the k best users and the caller's own rank.
+* Ranking is by score, then by elapsed time (faster first), see Leaderboard.
+*/
+json QuizController::HandleLeaderboard (connection_hdl hdl, const json & request)
+{
+    std::string error_msg;
+    if (!session_mgr.ValidateSession (hdl, error_msg)) {
+        return CreateErrorResponse (error_msg);
+    }
+
+    size_t k = std::min<size_t> (request.value ("top", DEFAULT_LEADERBOARD_TOP), MAX_LEADERBOARD_TOP);
+    Leaderboard & board = Leaderboard::GetInstance ();
+
+    json response = {
+        {"type", "LEADERBOARD"},
+        {"version", board.GetVersion ()},
+        {"top", BuildLeaderboardEntries (board.GetTop (k))}
+    };
+
+    unsigned int rank;
+    size_t total;
+    if (board.GetRank (session_mgr.GetUsername (hdl), rank, total)) {
+        response["rank"] = rank;
+    }
+    response["total"] = board.GetSize ();
+    return response;
+}
+
+/*
+* SUBSCRIBE_LEADERBOARD - { "top": k, "subscribe": true|false }. Subscribers get a LEADERBOARD push
+* at most once per LeaderboardPushIntervalMs, and only when the ranking changed since the last one.
+*/
+json QuizController::HandleSubscribeLeaderboard (connection_hdl hdl, const json & request)
+{
+    std::string error_msg;
+    if (!session_mgr.ValidateSession (hdl, error_msg)) {
+        return CreateErrorResponse (error_msg);
+    }
+
+    std::string username = session_mgr.GetUsername (hdl);
+    bool is_subscribe = request.value ("subscribe", true);
+
+    if (is_subscribe) {
+        size_t k = std::min<size_t> (request.value ("top", DEFAULT_LEADERBOARD_TOP), MAX_LEADERBOARD_TOP);
+        Leaderboard::GetInstance ().Subscribe (username, k);
+    } else {
+        Leaderboard::GetInstance ().Unsubscribe (username);
+    }
+
+    return {
+        {"type", "LEADERBOARD_SUBSCRIBED"},
+        {"subscribed", is_subscribe},
+        {"interval_ms", QuizConfig::GetInstance ().GetLeaderboardPushIntervalMs ()}
+    };
+}
+
+/*
+* ITEM_STATS - admin only. Live per question statistics merged from the grading threads,
+* with "export": true they are also written to the AnalyticsFile csv of the current exam.
+*/
+json QuizController::HandleItemStats (connection_hdl hdl, const json & request)
+{
+    if (!IsAdmin (hdl)) {
+        return CreateErrorResponse ("Not allowed");
+    }
+
+    std::vector<ItemAnalytics::ItemStats> stats = ItemAnalytics::GetInstance ().Snapshot (ExamQuestionCount (session_mgr.GetAllUsers ()));
+
+    json response = {
+        {"type", "ITEM_STATS"},
+        {"items", ItemAnalytics::ToJson (stats)}
+    };
+
+    if (request.value ("export", false)) {
+        std::string path = ExamFile (QuizConfig::GetInstance ().GetAnalyticsFile (), CurrentExam ());
+        response["exported"] = ItemAnalytics::WriteCsv (stats, path);
+        response["file"] = path;
+    }
+    return response;
+}
+
+/*
+* EXPORT_RESULTS - admin only, refused while the quiz runs. Writes every user's result to the
+* columnar ResultsFile of the last exam again (the exam id goes into the name), the same file is
+* written on its own when the quiz ends.
+*/
+json QuizController::HandleExportResults (connection_hdl hdl, const json &)
+{
+    if (!IsAdmin (hdl)) {
+        return CreateErrorResponse ("Not allowed");
+    }
+
+    // the exporter reads the users' results unlocked from its own threads - only once nobody answers any more
+    if (state_mgr.IsQuizActive ("global_quiz")) {
+        return CreateErrorResponse ("Results can be exported once the quiz has ended");
+    }
+
+    json summary;
+    bool is_ok = ExportResults (session_mgr.GetAllUsers (), &summary);
+    summary["type"] = "RESULTS_EXPORTED";
+    summary["exported"] = is_ok;
+    return summary;
+}
+
+/*
+* RELOAD_BANK - admin only, { "file" } defaults to QuestionBankFile. The bank is parsed in the
+* background, the admin gets RELOAD_STARTED now and BANK_RELOADED with the diff once it is live.
+*/
+json QuizController::HandleReloadBank (connection_hdl hdl, const json & request)
+{
+    if (!IsAdmin (hdl)) {
+        return CreateErrorResponse ("Not allowed");
+    }
+
+    std::string path = request.value ("file", QuizConfig::GetInstance ().GetQuestionBankFile ());
+    std::string admin = session_mgr.GetUsername (hdl);
+    SessionManager & sessions = session_mgr;
+
+    bool is_started = BankReloader::GetInstance ().RequestReload (path, [&sessions, admin] (const BankReloader::ReloadResult & result) {
+        json notice = {
+            {"type", "BANK_RELOADED"},
+            {"ok", result.is_ok},
+            {"file", result.file},
+            {"parse_ms", result.parse_ms}
+        };
+        if (result.is_ok) {
+            notice["version"] = result.version;
+            notice["total_questions"] = result.question_count;
+            notice["diff"] = result.diff.ToJson ();
+            notice["exams_updated"] = result.repinned;
+        } else {
+            notice["error"] = result.error;
+        }
+        sessions.NotifyUser (admin, notice.dump ());
+                                                                  });
+
+    if (!is_started) {
+        return CreateErrorResponse ("A reload is already running");
+    }
+    return {{"type", "RELOAD_STARTED"}, {"file", path}};
+}
+
+json QuizController::BuildLeaderboardEntries (const std::vector<Leaderboard::Entry> & top)
+{
+    json entries = json::array ();
+    for (const auto & entry : top) {
+        entries.push_back ({
+            {"rank", entry.rank},
+            {"username", entry.username},
+            {"score", entry.score},
+            {"elapsed_time", entry.elapsed_ms}
+        });
+    }
+    return entries;
+}
+
 void QuizController::OnConnect (connection_hdl hdl)
 {
 // Connection established - no action needed
@@ -383,6 +1286,11 @@ json QuizController::CreateErrorResponse (const std::string & message) const
     return {{"type", "ERROR"}, {"message", message}};
 }
 
+void QuizController::WriteError (ResponseWriter & writer, std::string_view message) const
+{
+    writer.Field ("type", "ERROR").Field ("message", message);
+}
+
 bool QuizController::CheckTimeElapsed (std::shared_ptr<User> user, eQuizMode mode) const
 {
     if (mode == BULLET_TIMER_MODE) {
@@ -390,7 +1298,7 @@ bool QuizController::CheckTimeElapsed (std::shared_ptr<User> user, eQuizMode mod
         return false;
     } else if (mode == STRICT_TIME_BOUND_MODE) {
 
-        long long current_time = QuizHelper::get_current_time_in_ms ();
+        long long current_time = QuizClock::NowMs ();
         return current_time >= user->GetEndTimeInMs ();
 
     } else if (mode == TIME_BOUND_MODE) {
@@ -410,8 +1318,349 @@ long long QuizController::CalculateQuestionTimer (std::shared_ptr<User> user) co
     } else if (quiz_mode == TIME_BOUND_MODE) {
         return user->GetTotalTimeLimit () - user->GetElapsedTime ();
     } else {
-        return user->GetEndTimeInMs () - QuizHelper::get_current_time_in_ms ();
+        return user->GetEndTimeInMs () - QuizClock::NowMs ();
+    }
+}
+
+void QuizController::UpdateLeaderboard (const std::string & username, std::shared_ptr<User> user) const
+{
+    if (!username.empty ()) {
+        Leaderboard::GetInstance ().Update (username, user->GetUserCurrentScore (), user->GetElapsedTime ());
+    }
+}
+
+QuestionShuffle QuizController::GetShuffle (std::shared_ptr<User> user) const
+{
+    QuizConfig & cfg = QuizConfig::GetInstance ();
+    return QuestionShuffle (user->GetShuffleSeed (), user->GetQuestionBank ()->TotalQuestionCount (),
+                            cfg.IsShuffleQuestions (), cfg.IsShuffleOptions ());
+}
+
+// options of the question in the user's pinned bank - decides whether its options are reordered at all
+unsigned int QuizController::OptionCount (const std::shared_ptr<User> & user, unsigned int bank_id)
+{
+    std::shared_ptr<const Question> ques = user->GetQuestionBank ()->GetQuestionById (bank_id);
+    return ques ? ques->GetOptionCount () : 0;
+}
+
+// bank ids -> the ids the user sees, in the user's order
+std::vector<unsigned int> QuizController::ToDisplayIds (const QuestionShuffle & shuffle, const std::vector<unsigned int> & bank_ids)
+{
+    std::vector<unsigned int> display_ids;
+    display_ids.reserve (bank_ids.size ());
+    for (unsigned int bank_id : bank_ids) {
+        display_ids.push_back (shuffle.ToDisplayId (bank_id));
+    }
+    std::sort (display_ids.begin (), display_ids.end ());
+    return display_ids;
+}
+
+bool QuizController::IsAdmin (connection_hdl hdl) const
+{
+    std::string admin = QuizConfig::GetInstance ().GetAdminUser ();
+    return !admin.empty () && session_mgr.GetUsername (hdl) == admin;
+}
+
+void QuizController::StartQuizTimer (const std::string & quiz_id, long long duration_ms)
+{
+    state_mgr.StartQuiz (quiz_id, duration_ms);
+
+    // Register notification callback
+    state_mgr.RegisterClient (quiz_id, [this, quiz_id] (const std::string & message) {
+        session_mgr.NotifyAllUsers (message);
+
+        if (message == "QUIZ_TIMEOUT" || message == "QUIZ_FORCE_STOPPED" || message == "ALL_QUIZZES_FORCE_STOPPED") {
+            OnQuizEnded (quiz_id);
+        }
+                              });
+}
+
+// End of the exam - write out what was collected while it ran
+void QuizController::OnQuizEnded (const std::string & quiz_id)
+{
+    std::vector<std::shared_ptr<User>> users = session_mgr.GetAllUsers ();
+
+    std::string path = ExamFile (QuizConfig::GetInstance ().GetAnalyticsFile (), CurrentExam ());
+    std::vector<ItemAnalytics::ItemStats> stats = ItemAnalytics::GetInstance ().Snapshot (ExamQuestionCount (users));
+
+    if (ItemAnalytics::WriteCsv (stats, path)) {
+        QUIZ_LOG_INFO (LOG_COMPONENT, "Item analytics for %s written to %s", quiz_id.c_str (), path.c_str ());
+    } else {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Could not write item analytics to %s", path.c_str ());
+    }
+
+    // the exam's users leave memory only once their final results are on disk
+    if (ExportResults (users)) {
+        ArchiveExamUsers (users);
+        answer_journal.Truncate ();
+    }
+}
+
+// the longest exam among the users - a reload may have shrunk the current bank under the ones already running
+unsigned int QuizController::ExamQuestionCount (const std::vector<std::shared_ptr<User>> & users) const
+{
+    unsigned int count = QuestionBank::GetInstance ().TotalQuestionCount ();
+    for (const auto & user : users) {
+        count = std::max (count, user->GetQuestionBank ()->TotalQuestionCount ());
+    }
+    return count;
+}
+
+// a new exam - the users of the last one can no longer come back to see their results, nor rank in it,
+// and the item statistics start over
+void QuizController::BeginExam ()
+{
+    exam_id = QuizClock::WallNowMs ();
+    ItemAnalytics::GetInstance ().Reset ();
+
+    Leaderboard & board = Leaderboard::GetInstance ();
+    for (const auto & username : session_mgr.RetireArchivedExam ()) {
+        board.Remove (username);
+    }
+}
+
+bool QuizController::ExportResults (const std::vector<std::shared_ptr<User>> & users, json * summary)
+{
+    std::string path = ExamFile (QuizConfig::GetInstance ().GetResultsFile (), CurrentExam ());
+    ResultExporter::ExportStats stats;
+    bool is_ok = ResultExporter::Export (users, ExamQuestionCount (users), path, stats);
+
+    if (is_ok) {
+        QUIZ_LOG_INFO (LOG_COMPONENT, "Results of %zu users written to %s (%llu bytes, fill %lld ms, write %lld ms)",
+                       stats.users, path.c_str (), stats.bytes, stats.fill_ms, stats.write_ms);
+    } else {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Could not write results to %s", path.c_str ());
+    }
+
+    if (summary) {
+        *summary = {
+            {"file", path},
+            {"users", stats.users},
+            {"questions", stats.questions},
+            {"bytes", stats.bytes},
+            {"fill_ms", stats.fill_ms},
+            {"write_ms", stats.write_ms}
+        };
+    }
+    return is_ok;
+}
+
+// an exam without a BeginExam (not strict mode, an old state file) still needs an id of its own
+long long QuizController::CurrentExam ()
+{
+    long long exam = exam_id.load ();
+    if (exam == 0) {
+        long long assigned = QuizClock::WallNowMs ();
+        exam = exam_id.compare_exchange_strong (exam, assigned) ? assigned : exam;
+    }
+    return exam;
+}
+
+void QuizController::ArchiveExamUsers (const std::vector<std::shared_ptr<User>> & users)
+{
+    size_t evicted = session_mgr.ArchiveUsers (users, CurrentExam ());
+    if (evicted > 0) {
+        QUIZ_LOG_INFO (LOG_COMPONENT, "Archived %zu users of the ended exam, %zu left in memory", evicted, users.size () - evicted);
+    }
+}
+
+/*
+* State file layout:
+*   { "saved_at": ms, "quiz": { "id", "state", "remaining_ms", "exam", "archived_exam" }, "users": [ User::Serialize ().. ] }
+* Written to a temp file first and renamed, so a reader never sees half a file.
+*/
+bool QuizController::SaveState (const std::string & path)
+{
+    std::string quiz_id = "global_quiz";
+
+    json state = {
+        {"saved_at", QuizClock::WallNowMs ()},
+        {"quiz", {
+            {"id", quiz_id},
+            {"state", static_cast<int>(state_mgr.GetQuizState (quiz_id))},
+            {"remaining_ms", state_mgr.GetRemainingTime (quiz_id)},
+            {"exam", exam_id.load ()},
+            {"archived_exam", session_mgr.GetArchivedExam ()}
+        }},
+        {"users", session_mgr.SerializeUsers ()},
+        {"resume", resume_tokens.Serialize ()}
+    };
+
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out (tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out << state.dump ();
+        if (!out.good ()) {
+            return false;
+        }
+    }
+
+    std::remove (path.c_str ());
+    return std::rename (tmp_path.c_str (), path.c_str ()) == 0;
+}
+
+bool QuizController::LoadState (const std::string & path)
+{
+    std::ifstream in (path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    json state = json::parse (in, nullptr, false);
+    if (state.is_discarded ()) {
+        return false;
+    }
+
+    session_mgr.RestoreUsers (state.value ("users", json::array ()));
+
+    // the ranking is derived state - rebuild it from the restored results.
+    // The restored exams continue on the bank this process loaded.
+    std::shared_ptr<const QuestionBank::Snapshot> bank = QuestionBank::GetInstance ().GetSnapshot ();
+    for (const auto & user_state : state.value ("users", json::array ())) {
+        std::string username = user_state.value ("name", "");
+        auto user = session_mgr.GetUser (username);
+        if (user) {
+            user->PinQuestionBank (bank);
+            UpdateLeaderboard (username, user);
+        }
+    }
+
+    // keep the old process' key, so the clients it sent away can RESUME here
+    resume_tokens.Restore (state.value ("resume", json::object ()));
+
+    // the quiz wide timer keeps running across the restart, minus the time the handover took
+    json quiz = state.value ("quiz", json::object ());
+    exam_id = quiz.value ("exam", 0LL);
+    session_mgr.IndexArchivedExam (quiz.value ("archived_exam", 0LL));
+    if (quiz.value ("state", 0) == static_cast<int>(QuizState::IN_PROGRESS)) {
+        long long handover_ms = QuizClock::WallNowMs () - state.value ("saved_at", 0LL);
+        long long remaining_ms = quiz.value ("remaining_ms", 0LL) - std::max (0LL, handover_ms);
+
+        if (remaining_ms > 0) {
+            StartQuizTimer (quiz.value ("id", std::string ("global_quiz")), remaining_ms);
+        }
+    }
+    return true;
+}
+
+/*
+* Cold start after a crash - rebuilds the exam from the answer journal: each "start" record creates the
+* user again with its shuffle seed and deadlines, each "answer" / "answers" (batch) record is graded
+* again in order. Reading
+* stops at the first line that does not parse, the one a crash tore. A strict exam gets its timer back
+* with what is left of it, or is ended here if it ran out while the server was down.
+* The replayed users run on the bank this process loaded, and the time of disconnects is not journaled.
+*/
+size_t QuizController::RecoverFromJournal ()
+{
+    std::string path = QuizConfig::GetInstance ().GetAnswerJournalFile ();
+    if (path.empty ()) {
+        return 0;
+    }
+    std::ifstream in (path, std::ios::binary);
+    if (!in) {
+        return 0;
+    }
+
+    std::shared_ptr<const QuestionBank::Snapshot> bank = QuestionBank::GetInstance ().GetSnapshot ();
+    size_t started = 0;
+    size_t answered = 0;
+    size_t skipped = 0;
+    long long quiz_end_wall_ms = 0;
+    std::string line;
+
+    while (std::getline (in, line)) {
+        json record = json::parse (line, nullptr, false);
+        if (record.is_discarded () || !record.is_object ()) {
+            break;
+        }
+
+        std::string username = record.value ("user", "");
+        if (record.value ("event", "answer") == "start") {
+            long long end_wall_ms = record.value ("end_time", 0LL);
+            auto user = session_mgr.CreateUser (username, bank, record.value ("seed", 0ULL), record.value ("total_time", 0LL),
+                                                FromWireTime (record.value ("start_time", 0LL)), FromWireTime (end_wall_ms));
+            if (!user) {
+                ++skipped;
+                continue;
+            }
+            UpdateLeaderboard (username, user);
+
+            exam_id = record.value ("exam", 0LL);
+            if (end_wall_ms != 0 && (quiz_end_wall_ms == 0 || end_wall_ms < quiz_end_wall_ms)) {
+                quiz_end_wall_ms = end_wall_ms;     // the global timer began with the first start
+            }
+            ++started;
+            continue;
+        }
+
+        auto user = session_mgr.GetUser (username);
+        if (record.value ("event", "answer") == "answers") {
+            if (!user) {
+                ++skipped;
+                continue;
+            }
+            PreparedBatch prepared;
+            prepared.user = user;
+            prepared.username = username;
+            prepared.results = json::array ();
+            for (const auto & entry : record.value ("answers", json::array ())) {
+                unsigned int batch_id = entry.value ("question_id", 0u);
+                if (batch_id == 0 || batch_id > user->GetQuestionBank ()->TotalQuestionCount ()) {
+                    continue;
+                }
+                Answer ans (batch_id);
+                for (int op : entry.value ("selected_options", std::vector<int>{})) {
+                    ans.SetSelectedOp (op);
+                }
+                prepared.answers.push_back (std::move (ans));
+                prepared.graded_ids.push_back (batch_id);
+                prepared.answer_times.push_back (entry.value ("time_to_attempt_in_ms", 0LL));
+            }
+            ApplySubmitAnswers (prepared);
+            answered += prepared.answers.size ();
+            continue;
+        }
+
+        unsigned int bank_id = record.value ("question_id", 0u);
+        if (!user || bank_id == 0 || bank_id > user->GetQuestionBank ()->TotalQuestionCount ()) {
+            ++skipped;
+            continue;
+        }
+
+        Answer answer (bank_id);
+        for (const auto & op : record.value ("selected_options", json::array ())) {
+            if (op.is_number_integer ()) {
+                answer.SetSelectedOp (op.get<int> ());
+            }
+        }
+        long long time_to_attempt_ms = record.value ("time_to_attempt_in_ms", 0LL);
+        user->AddToElapsedTimeInQuiz (time_to_attempt_ms);
+        ItemAnalytics::GetInstance ().RecordAnswerTime (bank_id, time_to_attempt_ms);
+        user->SetAndValidateUserAnswer (answer);
+        UpdateLeaderboard (username, user);
+        ++answered;
+    }
+
+    if (started == 0) {
+        return 0;
+    }
+    QUIZ_LOG_INFO (LOG_COMPONENT, "Recovered %zu users and %zu answers from %s (%zu records skipped)",
+                   started, answered, path.c_str (), skipped);
+
+    if (QuizConfig::GetInstance ().GetQuizMode () == STRICT_TIME_BOUND_MODE && quiz_end_wall_ms != 0) {
+        std::string quiz_id = "global_quiz";
+        long long remaining_ms = quiz_end_wall_ms - QuizClock::WallNowMs ();
+        if (remaining_ms > 0) {
+            StartQuizTimer (quiz_id, remaining_ms);
+        } else {
+            OnQuizEnded (quiz_id);
+        }
     }
+    return started;
 }
 
 void QuizController::CalculateElapsedTimeOnDisconnection (std::shared_ptr<User> user) const
@@ -425,7 +1674,7 @@ void QuizController::CalculateElapsedTimeOnDisconnection (std::shared_ptr<User>
     }
 
     if (quiz_mode == TIME_BOUND_MODE) {
-        long long current_time = QuizHelper::get_current_time_in_ms ();
+        long long current_time = QuizClock::NowMs ();
         long long elapsed_time = current_time - last_activity_time;
         user->AddToElapsedTimeInQuiz (elapsed_time);
     }
@@ -1,55 +1,151 @@
 #pragma once
+#include <atomic>
 #include <nlohmann/json.hpp>
 #include "SessionManager.hpp"
 #include "QuizStateManager.hpp"
 #include "QuizConfig.h"
 #include "QuestionBank.h"
+#include "TokenBucket.hpp"
+#include "ResumeToken.hpp"
+#include "Leaderboard.hpp"
+#include "ItemAnalytics.hpp"
+#include "ResultExporter.hpp"
+#include "QuestionShuffle.hpp"
+#include "BankReloader.hpp"
+#include "RequestDecoder.hpp"
+#include "ResponseWriter.hpp"
+#include "AnswerJournal.hpp"
+#include "CredentialStore.hpp"
+#include "HandlerTask.hpp"
 
 using json = nlohmann::json;
 using connection_hdl = websocketpp::connection_hdl;
 
-enum class CommandType {
-    LOGIN,
-    START_QUIZ,
-    CONTINUE_QUIZ,
-    END_QUIZ,
-    FETCH_QUESTION,
-    FETCH_UNATTEMPTED,
-    SUBMIT_ANSWER,
-    LOGOUT,
-    UNKNOWN
-};
-
 class QuizController {
     private:
     SessionManager & session_mgr;
     QuizStateManager & state_mgr;
 
+    // Admission control for LOGIN - over the rate the client is told to retry after a jittered delay
+    TokenBucket login_bucket;
+
+    // Signed tokens that let a reconnecting client RESUME its session without a new LOGIN
+    ResumeTokenIssuer resume_tokens;
+
     // Command handlers
     json HandleLogin (connection_hdl hdl, const json & request);
+    json CompleteLogin (connection_hdl hdl, const std::string & username);
+    json RetryLoginResponse (long long retry_after_ms) const;
+
+    // LOGIN with a credential file - the password is checked on the hashing pool while the io thread moves on
+    HandlerTask LoginAsync (connection_hdl hdl, std::string username, std::string password, bool has_request_id, unsigned long long request_id);
     json HandleStartQuiz (connection_hdl hdl, const json & request);
     json HandleContinueQuiz (connection_hdl hdl, const json & request);
     json HandleEndQuiz (connection_hdl hdl, const json & request);
-    json HandleFetchQuestion (connection_hdl hdl, const json & request);
+    void HandleFetchQuestion (connection_hdl hdl, const FetchQuestionCmd & cmd, ResponseWriter & writer);
+    void HandleFetchQuestions (connection_hdl hdl, const json & request, ResponseWriter & writer);
     json HandleFetchUnattempted (connection_hdl hdl, const json & request);
-    json HandleSubmitAnswer (connection_hdl hdl, const json & request);
+    void HandleSubmitAnswer (connection_hdl hdl, const SubmitAnswerCmd & cmd, ResponseWriter & writer);
+    json HandleSubmitAnswers (connection_hdl hdl, const json & request);
     json HandleLogout (connection_hdl hdl, const json & request);
+    json HandleResume (connection_hdl hdl, const json & request);
+    json HandleLeaderboard (connection_hdl hdl, const json & request);
+    json HandleSubscribeLeaderboard (connection_hdl hdl, const json & request);
+    json HandleItemStats (connection_hdl hdl, const json & request);
+    json HandleExportResults (connection_hdl hdl, const json & request);
+    json HandleReloadBank (connection_hdl hdl, const json & request);
+
+    // A SUBMIT_ANSWER that passed its checks, resolved to bank space - split so the journal can sit in between
+    struct PreparedAnswer {
+        std::shared_ptr<User> user;
+        std::string username;
+        unsigned int question_id = 0;       // display id, echoed back
+        unsigned int bank_id = 0;
+        Answer answer {0};
+        long long time_to_attempt_ms = 0;
+    };
+    bool PrepareSubmitAnswer (connection_hdl hdl, const SubmitAnswerCmd & cmd, ResponseWriter & writer, PreparedAnswer & prepared);
+    void ApplySubmitAnswer (PreparedAnswer & prepared, ResponseWriter & writer);
+
+    // SUBMIT_ANSWER with the journal on - graded and answered only once the answer is durable
+    HandlerTask SubmitAnswerAsync (connection_hdl hdl, SubmitAnswerCmd cmd, bool has_request_id, unsigned long long request_id);
+
+    // A SUBMIT_ANSWERS batch split the same way - answers in bank space, graded_ids / answer_times run alongside
+    struct PreparedBatch {
+        std::shared_ptr<User> user;
+        std::string username;
+        std::vector<Answer> answers;
+        std::vector<unsigned int> graded_ids;   // display ids, echoed back
+        std::vector<long long> answer_times;
+        json results;                           // the entries already rejected
+    };
+    bool PrepareSubmitAnswers (connection_hdl hdl, const json & request, json & error, PreparedBatch & prepared);
+    json ApplySubmitAnswers (PreparedBatch & prepared);
+    static json JournalRecord (const PreparedBatch & prepared);
+    HandlerTask SubmitAnswersAsync (connection_hdl hdl, json request, bool has_request_id, unsigned long long request_id);
+
+    // Routes a parsed command to its handler, which writes its members into the open response object
+    void DispatchCommand (CommandType cmd, connection_hdl hdl, const json & request, ResponseWriter & writer);
 
     // Utility methods
-    CommandType ParseCommandType (const std::string & type) const;
     bool IsCommandAllowed (CommandType cmd, const std::string & quiz_id) const;
     json CreateErrorResponse (const std::string & message) const;
+    void WriteError (ResponseWriter & writer, std::string_view message) const;
     long long CalculateQuestionTimer (std::shared_ptr<User> user) const;
     bool CheckTimeElapsed (std::shared_ptr<User> user, eQuizMode mode) const;
     void CalculateElapsedTimeOnDisconnection (std::shared_ptr<User> user) const;
+    void StartQuizTimer (const std::string & quiz_id, long long duration_ms);
+    void UpdateLeaderboard (const std::string & username, std::shared_ptr<User> user) const;
+    bool IsAdmin (connection_hdl hdl) const;
+    QuestionShuffle GetShuffle (std::shared_ptr<User> user) const;
+    static unsigned int OptionCount (const std::shared_ptr<User> & user, unsigned int bank_id);
+    static std::vector<unsigned int> ToDisplayIds (const QuestionShuffle & shuffle, const std::vector<unsigned int> & bank_ids);
+    static void WriteQuestion (ResponseWriter & writer, const QuestionShuffle & shuffle, unsigned int display_id,
+                               unsigned int bank_id, const Question & ques);
+    void OnQuizEnded (const std::string & quiz_id);
+    bool ExportResults (const std::vector<std::shared_ptr<User>> & users, json * summary = nullptr);
+    unsigned int ExamQuestionCount (const std::vector<std::shared_ptr<User>> & users) const;
+    void BeginExam ();
+    long long CurrentExam ();
+    void ArchiveExamUsers (const std::vector<std::shared_ptr<User>> & users);
+
+    // the running or last exam - the wall time it started, archived users are kept apart by it
+    std::atomic<long long> exam_id {0};
+
+    // last members - destroyed first, so the logins and answers still in flight finish against a whole controller
+    CredentialStore credentials;
+    bool has_credential_file = false;       // LOGIN checks against credentials (failing if it did not load), else the test password
+    AnswerJournal answer_journal;
 
     public:
     QuizController ();
 
-    // Main request processor
-    json ProcessRequest (connection_hdl hdl, const json & request);
+    // Main request processor - the response object is written whole into writer
+    void ProcessRequest (connection_hdl hdl, const json & request, ResponseWriter & writer);
+
+    // Same, for a frame RequestDecoder could take apart without the json parser
+    void ProcessRequest (connection_hdl hdl, const DecodedRequest & request, ResponseWriter & writer);
+
+    /*
+    * Requests whose handler has to wait (LOGIN with a CredentialFile, SUBMIT_ANSWER(S) while AnswerJournalFile is set) come back in task,
+    * which sends nothing itself - the caller starts it and gets the response text when it is done. Its
+    * thread is free meanwhile, so the caller holds back the connection's later requests to keep them in order.
+    * false for everything else, those go through ProcessRequest without any coroutine frame.
+    */
+    bool ProcessRequestAsync (connection_hdl hdl, const DecodedRequest & request, HandlerTask & task);
+    bool ProcessRequestAsync (connection_hdl hdl, const json & request, HandlerTask & task);
 
     // Connection lifecycle
     void OnConnect (connection_hdl hdl);
     void OnDisconnect (connection_hdl hdl);
+
+    // Restart handover - users and the quiz timer are written to / read from a state file
+    bool SaveState (const std::string & path);
+    bool LoadState (const std::string & path);
+
+    // Cold start - rebuilds the users and their answers from the answer journal, returns how many users came back
+    size_t RecoverFromJournal ();
+
+    // [{ "rank", "username", "score", "elapsed_time" }..] - shared by LEADERBOARD and the subscriber pushes
+    static json BuildLeaderboardEntries (const std::vector<Leaderboard::Entry> & top);
 };
\ No newline at end of file
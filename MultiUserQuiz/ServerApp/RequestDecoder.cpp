@@ -0,0 +1,262 @@
+// RequestDecoder.cpp
+#include "RequestDecoder.hpp"
+#include <charconv>
+
+namespace {
+
+    /*
+    * Cursor over the payload. Every Read* returns false on anything it does not handle, the whole
+    * decode then gives up and leaves the frame to the json parser.
+    */
+    class Scanner {
+        const char * pos;
+        const char * end;
+
+    public:
+        explicit Scanner (std::string_view text)
+            : pos (text.data ()),
+            end (text.data () + text.size ())
+        { }
+
+        void SkipSpace ()
+        {
+            while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+                ++pos;
+            }
+        }
+
+        bool IsAtEnd ()
+        {
+            SkipSpace ();
+            return pos == end;
+        }
+
+        char Peek ()
+        {
+            SkipSpace ();
+            return pos < end ? *pos : '\0';
+        }
+
+        bool Consume (char c)
+        {
+            if (Peek () != c) {
+                return false;
+            }
+            ++pos;
+            return true;
+        }
+
+        // the view points into the payload, so escapes are left to the json parser
+        bool ReadString (std::string_view & out)
+        {
+            if (!Consume ('"')) {
+                return false;
+            }
+
+            const char * start = pos;
+            while (pos < end && *pos != '"') {
+                if (*pos == '\\' || static_cast<unsigned char>(*pos) < 0x20) {
+                    return false;
+                }
+                ++pos;
+            }
+            if (pos == end) {
+                return false;
+            }
+
+            out = std::string_view (start, pos - start);
+            ++pos;
+            return true;
+        }
+
+        // integers only, a fraction or exponent is the json parser's job
+        bool ReadInteger (long long & out)
+        {
+            SkipSpace ();
+            auto [next, ec] = std::from_chars (pos, end, out);
+            if (ec != std::errc () || (next < end && (*next == '.' || *next == 'e' || *next == 'E'))) {
+                return false;
+            }
+            // json has no leading zeros, let the parser reject them
+            const char * digits = (*pos == '-') ? pos + 1 : pos;
+            if (*digits == '0' && next - digits > 1) {
+                return false;
+            }
+            pos = next;
+            return true;
+        }
+
+        bool ReadBool (bool & out)
+        {
+            SkipSpace ();
+            std::string_view rest (pos, end - pos);
+            if (rest.substr (0, 4) == "true") {
+                out = true;
+                pos += 4;
+                return true;
+            }
+            if (rest.substr (0, 5) == "false") {
+                out = false;
+                pos += 5;
+                return true;
+            }
+            return false;
+        }
+
+        // an ignored value - only the scalar kinds, nested values are not worth skipping by hand
+        bool SkipScalar ()
+        {
+            char c = Peek ();
+            if (c == '"') {
+                std::string_view ignored;
+                return ReadString (ignored);
+            }
+            if (c == 't' || c == 'f') {
+                bool ignored;
+                return ReadBool (ignored);
+            }
+            long long ignored;
+            return ReadInteger (ignored);
+        }
+    };
+
+    bool ReadQuestionId (Scanner & scanner, unsigned int & question_id)
+    {
+        long long value;
+        if (!scanner.ReadInteger (value) || value < 0 || value > 0xFFFFFFFFLL) {
+            return false;
+        }
+        question_id = static_cast<unsigned int>(value);
+        return true;
+    }
+
+    bool ReadOptionMask (Scanner & scanner, unsigned char & mask)
+    {
+        if (!scanner.Consume ('[')) {
+            return false;
+        }
+
+        mask = 0;
+        if (scanner.Consume (']')) {
+            return true;
+        }
+
+        do {
+            long long option;
+            if (!scanner.ReadInteger (option)) {
+                return false;
+            }
+            if (option >= 0 && option < 4) {
+                mask |= static_cast<unsigned char>(1u << option);
+            }
+        } while (scanner.Consume (','));
+
+        return scanner.Consume (']');
+    }
+
+    inline CommandType Verify (std::string_view name, std::string_view expected, CommandType type)
+    {
+        return name == expected ? type : CommandType::UNKNOWN;
+    }
+
+} // anonymous namespace
+
+CommandType ParseCommandType (std::string_view name)
+{
+    switch (CommandHash (name)) {
+        case CommandHash ("LOGIN"):                 return Verify (name, "LOGIN", CommandType::LOGIN);
+        case CommandHash ("START_QUIZ"):            return Verify (name, "START_QUIZ", CommandType::START_QUIZ);
+        case CommandHash ("CONTINUE_QUIZ"):         return Verify (name, "CONTINUE_QUIZ", CommandType::CONTINUE_QUIZ);
+        case CommandHash ("END_QUIZ"):              return Verify (name, "END_QUIZ", CommandType::END_QUIZ);
+        case CommandHash ("FETCH_QUESTION"):        return Verify (name, "FETCH_QUESTION", CommandType::FETCH_QUESTION);
+        case CommandHash ("FETCH_QUESTIONS"):       return Verify (name, "FETCH_QUESTIONS", CommandType::FETCH_QUESTIONS);
+        case CommandHash ("FETCH_UNATTEMPTED"):     return Verify (name, "FETCH_UNATTEMPTED", CommandType::FETCH_UNATTEMPTED);
+        case CommandHash ("SUBMIT_ANSWER"):         return Verify (name, "SUBMIT_ANSWER", CommandType::SUBMIT_ANSWER);
+        case CommandHash ("SUBMIT_ANSWERS"):        return Verify (name, "SUBMIT_ANSWERS", CommandType::SUBMIT_ANSWERS);
+        case CommandHash ("LOGOUT"):                return Verify (name, "LOGOUT", CommandType::LOGOUT);
+        case CommandHash ("RESUME"):                return Verify (name, "RESUME", CommandType::RESUME);
+        case CommandHash ("LEADERBOARD"):           return Verify (name, "LEADERBOARD", CommandType::LEADERBOARD);
+        case CommandHash ("SUBSCRIBE_LEADERBOARD"): return Verify (name, "SUBSCRIBE_LEADERBOARD", CommandType::SUBSCRIBE_LEADERBOARD);
+        case CommandHash ("ITEM_STATS"):            return Verify (name, "ITEM_STATS", CommandType::ITEM_STATS);
+        case CommandHash ("EXPORT_RESULTS"):        return Verify (name, "EXPORT_RESULTS", CommandType::EXPORT_RESULTS);
+        case CommandHash ("RELOAD_BANK"):           return Verify (name, "RELOAD_BANK", CommandType::RELOAD_BANK);
+        default:                                    return CommandType::UNKNOWN;
+    }
+}
+
+bool RequestDecoder::Decode (std::string_view payload, DecodedRequest & request)
+{
+    Scanner scanner (payload);
+    request = DecodedRequest ();
+
+    if (!scanner.Consume ('{')) {
+        return false;
+    }
+
+    // fields may come in any order - collect them all, the type decides at the end which ones count
+    if (!scanner.Consume ('}')) {
+        do {
+            std::string_view key;
+            if (!scanner.ReadString (key) || !scanner.Consume (':')) {
+                return false;
+            }
+
+            bool is_read;
+            switch (CommandHash (key)) {
+                case CommandHash ("type"): {
+                    std::string_view type;
+                    is_read = key == "type" && scanner.ReadString (type);
+                    request.type = ParseCommandType (type);
+                    break;
+                }
+                case CommandHash ("question_id"):
+                    is_read = key == "question_id" && ReadQuestionId (scanner, request.fetch.question_id);
+                    request.submit.question_id = request.fetch.question_id;
+                    break;
+                case CommandHash ("prefetch"):
+                    is_read = key == "prefetch" && scanner.ReadBool (request.fetch.is_prefetch);
+                    break;
+                case CommandHash ("selected_options"):
+                    is_read = key == "selected_options" && ReadOptionMask (scanner, request.submit.option_mask);
+                    break;
+                case CommandHash ("time_to_attempt_in_ms"):
+                    is_read = key == "time_to_attempt_in_ms" && scanner.ReadInteger (request.submit.time_to_attempt_ms);
+                    break;
+                case CommandHash ("request_id"): {
+                    // only an unsigned id is echoed back, like on the json path
+                    long long id = -1;
+                    is_read = key == "request_id" && scanner.ReadInteger (id);
+                    request.has_request_id = id >= 0;
+                    request.request_id = request.has_request_id ? static_cast<unsigned long long>(id) : 0;
+                    break;
+                }
+                default:
+                    is_read = scanner.SkipScalar ();
+                    break;
+            }
+
+            if (!is_read) {
+                return false;
+            }
+        } while (scanner.Consume (','));
+
+        if (!scanner.Consume ('}')) {
+            return false;
+        }
+    }
+
+    if (!scanner.IsAtEnd ()) {
+        return false;
+    }
+
+    switch (request.type) {
+        case CommandType::FETCH_QUESTION:
+        case CommandType::SUBMIT_ANSWER:
+        case CommandType::FETCH_UNATTEMPTED:
+        case CommandType::CONTINUE_QUIZ:
+        case CommandType::END_QUIZ:
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,77 @@
+// RequestDecoder.hpp
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+enum class CommandType {
+    LOGIN,
+    START_QUIZ,
+    CONTINUE_QUIZ,
+    END_QUIZ,
+    FETCH_QUESTION,
+    FETCH_QUESTIONS,
+    FETCH_UNATTEMPTED,
+    SUBMIT_ANSWER,
+    SUBMIT_ANSWERS,
+    LOGOUT,
+    RESUME,
+    LEADERBOARD,
+    SUBSCRIBE_LEADERBOARD,
+    ITEM_STATS,
+    EXPORT_RESULTS,
+    RELOAD_BANK,
+    UNKNOWN
+};
+
+// FNV-1a, usable in case labels - the command switch below is checked for collisions by the compiler
+constexpr uint32_t CommandHash (std::string_view name)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// one hash and one compare, no allocation
+CommandType ParseCommandType (std::string_view name);
+
+struct FetchQuestionCmd {
+    unsigned int question_id = 0;
+    bool is_prefetch = false;
+};
+
+struct SubmitAnswerCmd {
+    unsigned int question_id = 0;
+    unsigned char option_mask = 0;          // bit i = option i selected, out of range options are dropped like Answer does
+    long long time_to_attempt_ms = 0;
+};
+
+/*
+* A request decoded without building a json DOM. Only the per question traffic has a typed form -
+* FETCH_QUESTION, SUBMIT_ANSWER and the commands that carry no arguments - everything else goes the
+* json way.
+*/
+struct DecodedRequest {
+    CommandType type = CommandType::UNKNOWN;
+    bool has_request_id = false;
+    unsigned long long request_id = 0;
+    FetchQuestionCmd fetch;
+    SubmitAnswerCmd submit;
+};
+
+/*
+* Single pass decoder for the frames the clients send most. It walks the payload once, straight into
+* DecodedRequest - keys and strings are compared in place, numbers converted with from_chars - so a
+* decode does not touch the heap.
+*
+* It only understands flat objects of strings without escapes, integers, booleans and integer arrays.
+* Anything else (nested values, escapes, fractions, a command without a typed form) makes Decode return
+* false and the caller falls back to json::parse, which also produces the error for malformed input.
+*/
+class RequestDecoder {
+
+public:
+    static bool Decode (std::string_view payload, DecodedRequest & request);
+};
@@ -0,0 +1,213 @@
+// ResponseWriter.cpp
+#include "ResponseWriter.hpp"
+#include <charconv>
+#include <cmath>
+
+#define RESPONSE_BUFFER_RESERVE         4096        // covers every per question response without a regrow
+#define RESPONSE_BUFFER_KEEP            (1 << 20)   // a buffer grown past this by one big response is given back
+
+std::string & ResponseWriter::ThreadBuffer ()
+{
+    thread_local std::string buffer;
+
+    if (buffer.capacity () > RESPONSE_BUFFER_KEEP) {
+        std::string ().swap (buffer);
+    }
+    if (buffer.capacity () < RESPONSE_BUFFER_RESERVE) {
+        buffer.reserve (RESPONSE_BUFFER_RESERVE);
+    }
+    buffer.clear ();
+    return buffer;
+}
+
+void ResponseWriter::Separate ()
+{
+    if (needs_comma) {
+        out.push_back (',');
+    }
+    needs_comma = true;
+}
+
+void ResponseWriter::WriteEscaped (std::string_view text)
+{
+    static const char HEX[] = "0123456789abcdef";
+
+    out.push_back ('"');
+
+    // runs of plain characters are appended in one go
+    size_t run = 0;
+    for (size_t i = 0; i < text.size (); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        out.append (text.data () + run, i - run);
+        run = i + 1;
+
+        switch (c) {
+            case '"':  out.append ("\\\"", 2); break;
+            case '\\': out.append ("\\\\", 2); break;
+            case '\b': out.append ("\\b", 2); break;
+            case '\f': out.append ("\\f", 2); break;
+            case '\n': out.append ("\\n", 2); break;
+            case '\r': out.append ("\\r", 2); break;
+            case '\t': out.append ("\\t", 2); break;
+            default: {
+                char escaped[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+                out.append (escaped, 6);
+                break;
+            }
+        }
+    }
+    out.append (text.data () + run, text.size () - run);
+
+    out.push_back ('"');
+}
+
+ResponseWriter & ResponseWriter::BeginObject ()
+{
+    Separate ();
+    out.push_back ('{');
+    needs_comma = false;
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::EndObject ()
+{
+    out.push_back ('}');
+    needs_comma = true;
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::BeginArray ()
+{
+    Separate ();
+    out.push_back ('[');
+    needs_comma = false;
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::EndArray ()
+{
+    out.push_back (']');
+    needs_comma = true;
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::Key (std::string_view key)
+{
+    Separate ();
+    WriteEscaped (key);
+    out.push_back (':');
+    needs_comma = false;
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::String (std::string_view value)
+{
+    Separate ();
+    WriteEscaped (value);
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::Int (long long value)
+{
+    char digits[24];
+    auto [end, ec] = std::to_chars (digits, digits + sizeof (digits), value);
+
+    Separate ();
+    out.append (digits, end - digits);
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::UInt (unsigned long long value)
+{
+    char digits[24];
+    auto [end, ec] = std::to_chars (digits, digits + sizeof (digits), value);
+
+    Separate ();
+    out.append (digits, end - digits);
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::Double (double value)
+{
+    // json::dump writes non finite numbers as null
+    if (!std::isfinite (value)) {
+        return Null ();
+    }
+
+    char digits[32];
+    auto [end, ec] = std::to_chars (digits, digits + sizeof (digits), value);
+
+    Separate ();
+    out.append (digits, end - digits);
+
+    // keep it a float on the reading side, like json::dump does
+    if (std::string_view (digits, end - digits).find_first_of (".eE") == std::string_view::npos) {
+        out.append (".0", 2);
+    }
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::Bool (bool value)
+{
+    Separate ();
+    out.append (value ? "true" : "false");
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::Null ()
+{
+    Separate ();
+    out.append ("null", 4);
+    return *this;
+}
+
+ResponseWriter & ResponseWriter::Value (const nlohmann::json & value)
+{
+    switch (value.type ()) {
+        case nlohmann::json::value_t::object:
+            BeginObject ();
+            Fields (value);
+            return EndObject ();
+        case nlohmann::json::value_t::array:
+            BeginArray ();
+            for (const auto & element : value) {
+                Value (element);
+            }
+            return EndArray ();
+        case nlohmann::json::value_t::string:
+            return String (value.get_ref<const std::string &> ());
+        case nlohmann::json::value_t::boolean:
+            return Bool (value.get<bool> ());
+        case nlohmann::json::value_t::number_integer:
+            return Int (value.get<long long> ());
+        case nlohmann::json::value_t::number_unsigned:
+            return UInt (value.get<unsigned long long> ());
+        case nlohmann::json::value_t::number_float:
+            return Double (value.get<double> ());
+        default:
+            // null, and the binary / discarded kinds the server never builds
+            return Null ();
+    }
+}
+
+ResponseWriter & ResponseWriter::Fields (const nlohmann::json & object)
+{
+    if (!object.is_object ()) {
+        return *this;
+    }
+    for (auto it = object.begin (); it != object.end (); ++it) {
+        Key (it.key ());
+        Value (it.value ());
+    }
+    return *this;
+}
+
+void ResponseWriter::Rewind (size_t mark)
+{
+    out.resize (mark);
+    needs_comma = false;
+}
@@ -0,0 +1,61 @@
+// ResponseWriter.hpp
+#pragma once
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+/*
+* Appends JSON text straight to a string - no json DOM in between, so the per question responses
+* cost no allocation once the buffer has grown to its working size.
+*
+* Commas are tracked with one flag, which is all the nesting the responses need: a value after Key
+* never takes one, every other value or container does when something precedes it.
+*
+* The output is wire compatible with json::dump - same escaping, doubles in shortest round trip
+* form with a ".0" on whole numbers. Key order may differ, the protocol does not depend on it.
+*/
+class ResponseWriter {
+    std::string & out;
+    bool needs_comma = false;
+
+    void Separate ();
+    void WriteEscaped (std::string_view text);
+
+public:
+    explicit ResponseWriter (std::string & buffer)
+        : out (buffer)
+    { }
+
+    // the calling thread's response buffer, empty but with the capacity earlier responses grew it to
+    static std::string & ThreadBuffer ();
+
+    ResponseWriter & BeginObject ();
+    ResponseWriter & EndObject ();
+    ResponseWriter & BeginArray ();
+    ResponseWriter & EndArray ();
+    ResponseWriter & Key (std::string_view key);
+
+    ResponseWriter & String (std::string_view value);
+    ResponseWriter & Int (long long value);
+    ResponseWriter & UInt (unsigned long long value);
+    ResponseWriter & Double (double value);
+    ResponseWriter & Bool (bool value);
+    ResponseWriter & Null ();
+    ResponseWriter & Value (const nlohmann::json & value);
+
+    // the members of an object, for writing into an object that is already open
+    ResponseWriter & Fields (const nlohmann::json & object);
+
+    // back to an open object with no members yet, after everything past mark was dropped
+    void Rewind (size_t mark);
+    size_t Size () const { return out.size (); }
+
+    ResponseWriter & Field (std::string_view key, std::string_view value)  { return Key (key).String (value); }
+    ResponseWriter & Field (std::string_view key, const char * value)      { return Key (key).String (value); }
+    ResponseWriter & Field (std::string_view key, int value)               { return Key (key).Int (value); }
+    ResponseWriter & Field (std::string_view key, long long value)         { return Key (key).Int (value); }
+    ResponseWriter & Field (std::string_view key, unsigned int value)      { return Key (key).UInt (value); }
+    ResponseWriter & Field (std::string_view key, unsigned long long value){ return Key (key).UInt (value); }
+    ResponseWriter & Field (std::string_view key, double value)            { return Key (key).Double (value); }
+    ResponseWriter & Field (std::string_view key, bool value)              { return Key (key).Bool (value); }
+};
@@ -0,0 +1,127 @@
+// ResultExporter.cpp
+#include "ResultExporter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#define EXPORT_WRITE_BUFFER_BYTES   (8 * 1024 * 1024)   // stdio buffer - the columns go out in a handful of large writes
+#define EXPORT_MIN_USERS_PER_THREAD 1024                // below this a thread costs more than it saves
+#define EXPORT_FORMAT_VERSION       1
+
+namespace {
+
+    long long ElapsedMs (std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now () - since).count ();
+    }
+
+    template <typename T>
+    bool WriteValue (FILE * out, const T & value)
+    {
+        return fwrite (&value, sizeof (T), 1, out) == 1;
+    }
+
+    template <typename T>
+    bool WriteArray (FILE * out, const std::vector<T> & values)
+    {
+        return values.empty () || fwrite (values.data (), sizeof (T), values.size (), out) == values.size ();
+    }
+
+} // anonymous namespace
+
+bool ResultExporter::Export (const std::vector<std::shared_ptr<User>> & users, unsigned int question_count,
+                             const std::string & path, ExportStats & stats)
+{
+    auto fill_start = std::chrono::steady_clock::now ();
+    const size_t user_count = users.size ();
+
+    std::vector<double> scores (user_count);
+    std::vector<int64_t> elapsed (user_count);
+    std::vector<unsigned char> statuses (user_count * question_count, static_cast<unsigned char>(UNATTEMPTED));
+    std::vector<unsigned char> masks (user_count * question_count, 0);
+
+    // the names are variable length, each range collects its own blob and they are stitched in order
+    size_t hw_threads = std::max (1u, std::thread::hardware_concurrency ());
+    size_t num_threads = std::max<size_t> (1, std::min (hw_threads, user_count / EXPORT_MIN_USERS_PER_THREAD));
+    size_t range = (user_count + num_threads - 1) / num_threads;
+    std::vector<std::string> name_blobs (num_threads);
+    std::vector<std::vector<uint32_t>> name_lengths (num_threads);
+
+    auto fill_range = [&] (size_t part) {
+        size_t begin = part * range;
+        size_t end = std::min (user_count, begin + range);
+
+        for (size_t i = begin; i < end; ++i) {
+            const std::shared_ptr<User> & user = users[i];
+            scores[i] = user->GetUserCurrentScore ();
+            elapsed[i] = user->GetElapsedTime ();
+            user->ExportColumns (i, user_count, question_count, statuses.data (), masks.data ());
+
+            const std::string & name = user->GetUserName ();
+            name_blobs[part] += name;
+            name_lengths[part].push_back (static_cast<uint32_t>(name.size ()));
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t part = 1; part < num_threads; ++part) {
+        workers.emplace_back (fill_range, part);
+    }
+    fill_range (0);
+    for (auto & worker : workers) {
+        worker.join ();
+    }
+
+    std::vector<uint32_t> name_offsets;
+    name_offsets.reserve (user_count + 1);
+    name_offsets.push_back (0);
+    for (const auto & lengths : name_lengths) {
+        for (uint32_t len : lengths) {
+            name_offsets.push_back (name_offsets.back () + len);
+        }
+    }
+
+    stats = {user_count, question_count, 0, ElapsedMs (fill_start), 0};
+    auto write_start = std::chrono::steady_clock::now ();
+
+    // written aside and renamed over the last export, a failed one leaves that file as it was
+    std::string tmp_path = path + ".tmp";
+    FILE * out = fopen (tmp_path.c_str (), "wb");
+    if (!out) {
+        return false;
+    }
+    std::vector<char> io_buffer (EXPORT_WRITE_BUFFER_BYTES);
+    setvbuf (out, io_buffer.data (), _IOFBF, io_buffer.size ());
+
+    bool is_ok = fwrite ("MUQR", 1, 4, out) == 4 &&
+        WriteValue (out, static_cast<uint32_t>(EXPORT_FORMAT_VERSION)) &&
+        WriteValue (out, static_cast<uint64_t>(user_count)) &&
+        WriteValue (out, static_cast<uint32_t>(question_count)) &&
+        WriteArray (out, name_offsets);
+
+    for (const auto & blob : name_blobs) {
+        is_ok = is_ok && (blob.empty () || fwrite (blob.data (), 1, blob.size (), out) == blob.size ());
+    }
+
+    is_ok = is_ok &&
+        WriteArray (out, scores) &&
+        WriteArray (out, elapsed) &&
+        WriteArray (out, statuses) &&
+        WriteArray (out, masks);
+
+    stats.bytes = static_cast<unsigned long long>(ftell (out));
+    is_ok = fclose (out) == 0 && is_ok;
+
+    if (is_ok) {
+        std::remove (path.c_str ());
+        is_ok = std::rename (tmp_path.c_str (), path.c_str ()) == 0;
+    } else {
+        std::remove (tmp_path.c_str ());
+    }
+    stats.write_ms = ElapsedMs (write_start);
+
+    return is_ok;
+}
@@ -0,0 +1,41 @@
+// ResultExporter.hpp
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "User.h"
+
+/*
+* Bulk export of every user's final result into one columnar file (.muqr).
+*
+* The users are split into contiguous ranges and filled in parallel, one thread per range, straight
+* into the column arrays - every thread writes its own slice of every column, so nothing is shared
+* and nothing is locked. The columns are then streamed out with a few large writes.
+*
+* Layout (little endian, native sizes):
+*   char[4]   "MUQR"
+*   uint32    format version (1)
+*   uint64    user count (N)
+*   uint32    question count (Q)
+*   uint32    N + 1 name offsets into the name blob, then the blob (names are not terminated)
+*   double    score[N]
+*   int64     elapsed time in ms[N]
+*   uint8     status[Q][N]            question major - eQuesAttemptStatus, UNATTEMPTED if never answered
+*   uint8     option mask[Q][N]       bit i set when option i was selected
+*
+* Readers can pull a single question's column (e.g. for item analysis) with one seek.
+*/
+class ResultExporter {
+
+public:
+    struct ExportStats {
+        size_t users;
+        unsigned int questions;
+        unsigned long long bytes;
+        long long fill_ms;
+        long long write_ms;
+    };
+
+    static bool Export (const std::vector<std::shared_ptr<User>> & users, unsigned int question_count,
+                        const std::string & path, ExportStats & stats);
+};
@@ -0,0 +1,163 @@
+// ResumeToken.cpp
+#include "ResumeToken.hpp"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <random>
+#include "QuizDefs.h"
+#include "QuizClock.h"
+
+#define RESUME_SECRET_BYTES     32
+#define RESUME_MAC_BYTES        16          // truncated HMAC-SHA256, plenty against forging within a token lifetime
+
+namespace {
+
+    std::string ToHex (const unsigned char * data, size_t len)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve (len * 2);
+        for (size_t i = 0; i < len; ++i) {
+            hex += digits[data[i] >> 4];
+            hex += digits[data[i] & 0x0f];
+        }
+        return hex;
+    }
+
+    int HexNibble (char ch)
+    {
+        if (ch >= '0' && ch <= '9') {
+            return ch - '0';
+        }
+        if (ch >= 'a' && ch <= 'f') {
+            return ch - 'a' + 10;
+        }
+        if (ch >= 'A' && ch <= 'F') {
+            return ch - 'A' + 10;
+        }
+        return -1;
+    }
+
+    bool FromHex (const std::string & hex, std::string & out)
+    {
+        if (hex.size () % 2 != 0) {
+            return false;
+        }
+
+        out.clear ();
+        out.reserve (hex.size () / 2);
+        for (size_t i = 0; i < hex.size (); i += 2) {
+            int hi = HexNibble (hex[i]);
+            int lo = HexNibble (hex[i + 1]);
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            out += static_cast<char>((hi << 4) | lo);
+        }
+        return true;
+    }
+
+} // anonymous namespace
+
+ResumeTokenIssuer::ResumeTokenIssuer (long long ttl_in_ms)
+    : ttl_ms (ttl_in_ms)
+{
+    unsigned char key[RESUME_SECRET_BYTES];
+
+    if (RAND_bytes (key, sizeof (key)) != 1) {
+        // no entropy from OpenSSL - still better than a fixed key
+        std::random_device rd;
+        for (auto & byte : key) {
+            byte = static_cast<unsigned char>(rd ());
+        }
+    }
+    secret.assign (reinterpret_cast<const char *>(key), sizeof (key));
+}
+
+std::string ResumeTokenIssuer::Sign (const std::string & body) const
+{
+    unsigned char mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+
+    HMAC (EVP_sha256 (), secret.data (), static_cast<int>(secret.size ()),
+          reinterpret_cast<const unsigned char *>(body.data ()), body.size (), mac, &mac_len);
+
+    return ToHex (mac, std::min<size_t> (mac_len, RESUME_MAC_BYTES));
+}
+
+std::string ResumeTokenIssuer::Issue (const std::string & username)
+{
+    std::lock_guard<std::mutex> lock (issuer_mutex);
+
+    std::string body = ToHex (reinterpret_cast<const unsigned char *>(username.data ()), username.size ()) + "." +
+        std::to_string (generations[username]) + "." +
+        std::to_string (QuizClock::WallNowMs () + ttl_ms);
+
+    return body + "." + Sign (body);
+}
+
+bool ResumeTokenIssuer::Verify (const std::string & token, std::string & username) const
+{
+    size_t mac_pos = token.rfind ('.');
+    if (mac_pos == std::string::npos) {
+        return false;
+    }
+
+    std::string body = token.substr (0, mac_pos);
+    std::string mac = token.substr (mac_pos + 1);
+
+    std::lock_guard<std::mutex> lock (issuer_mutex);
+
+    std::string expected = Sign (body);
+    if (mac.size () != expected.size () || CRYPTO_memcmp (mac.data (), expected.data (), mac.size ()) != 0) {
+        return false;
+    }
+
+    // the mac is good, so the fields below are ours and well formed
+    size_t gen_pos = body.find ('.');
+    size_t expiry_pos = body.find ('.', gen_pos + 1);
+    if (gen_pos == std::string::npos || expiry_pos == std::string::npos ||
+        !FromHex (body.substr (0, gen_pos), username)) {
+        return false;
+    }
+
+    unsigned long generation = std::stoul (body.substr (gen_pos + 1, expiry_pos - gen_pos - 1));
+    long long expiry_ms = std::stoll (body.substr (expiry_pos + 1));
+
+    if (expiry_ms < QuizClock::WallNowMs ()) {
+        return false;
+    }
+
+    auto it = generations.find (username);
+    return generation == (it != generations.end () ? it->second : 0);
+}
+
+void ResumeTokenIssuer::Revoke (const std::string & username)
+{
+    std::lock_guard<std::mutex> lock (issuer_mutex);
+    ++generations[username];
+}
+
+nlohmann::json ResumeTokenIssuer::Serialize () const
+{
+    std::lock_guard<std::mutex> lock (issuer_mutex);
+    return {
+        {"secret", ToHex (reinterpret_cast<const unsigned char *>(secret.data ()), secret.size ())},
+        {"generations", generations}
+    };
+}
+
+bool ResumeTokenIssuer::Restore (const nlohmann::json & state)
+{
+    std::string key;
+    if (!FromHex (state.value ("secret", ""), key) || key.empty ()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock (issuer_mutex);
+    secret = key;
+    generations = state.value ("generations", std::unordered_map<std::string, unsigned int>{});
+    return true;
+}
@@ -0,0 +1,40 @@
+// ResumeToken.hpp
+#pragma once
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+
+/*
+* Issues and checks the resume tokens handed out with LOGIN_OK.
+*
+*   <hex username>.<generation>.<expiry ms>.<hex HMAC-SHA256 of the first three fields, truncated to 16 bytes>
+*
+* A token proves the holder logged in as that user recently, so a reconnecting client can RESUME
+* without the password and without the server looking anything up beyond the user itself.
+* Logout bumps the user's generation, which invalidates every token issued before it.
+*
+* The key is random per process. Serialize / Restore carry it (and the generations) over a restart
+* handover, so tokens issued by the old process stay valid on the new one.
+*/
+class ResumeTokenIssuer {
+
+private:
+    std::string secret;
+    long long ttl_ms;
+    std::unordered_map<std::string, unsigned int> generations;
+    mutable std::mutex issuer_mutex;
+
+    std::string Sign (const std::string & body) const;
+
+public:
+    explicit ResumeTokenIssuer (long long ttl_in_ms);
+
+    std::string Issue (const std::string & username);
+    bool Verify (const std::string & token, std::string & username) const;
+    void Revoke (const std::string & username);
+
+    // Restart handover
+    nlohmann::json Serialize () const;
+    bool Restore (const nlohmann::json & state);
+};
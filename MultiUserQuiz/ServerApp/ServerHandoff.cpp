@@ -0,0 +1,211 @@
+// ServerHandoff.cpp
+#include "ServerHandoff.hpp"
+#include "Logger.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static const char * LOG_COMPONENT = "ServerHandoff";
+
+#define HANDOFF_DRAIN_REQUEST   "DRAIN\n"
+#define HANDOFF_STATE_PREFIX    "STATE "
+#define HANDOFF_POLL_MS         200
+
+ServerHandoff::ServerHandoff () : is_serving (false), listen_fd (-1)
+{ }
+
+ServerHandoff::~ServerHandoff ()
+{
+    Stop ();
+}
+
+#ifndef _WIN32
+
+namespace {
+
+    bool MakeAddress (const std::string & path, sockaddr_un & addr)
+    {
+        if (path.empty () || path.size () >= sizeof (addr.sun_path)) {
+            return false;
+        }
+        memset (&addr, 0, sizeof (addr));
+        addr.sun_family = AF_UNIX;
+        memcpy (addr.sun_path, path.c_str (), path.size ());
+        return true;
+    }
+
+    bool WriteAll (int fd, const std::string & data)
+    {
+        size_t sent = 0;
+        while (sent < data.size ()) {
+            ssize_t n = ::write (fd, data.data () + sent, data.size () - sent);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Reads one '\n' terminated line, gives up after timeout_ms without data
+    bool ReadLine (int fd, std::string & line, int timeout_ms)
+    {
+        line.clear ();
+        char ch;
+
+        while (true) {
+            pollfd pfd {fd, POLLIN, 0};
+            int ready = ::poll (&pfd, 1, timeout_ms);
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ready <= 0) {
+                return false;
+            }
+
+            ssize_t n = ::read (fd, &ch, 1);
+            if (n <= 0) {
+                return false;
+            }
+            if (ch == '\n') {
+                return true;
+            }
+            line += ch;
+        }
+    }
+
+} // anonymous namespace
+
+bool ServerHandoff::Serve (const std::string & path, std::function<std::string ()> on_drain)
+{
+    sockaddr_un addr;
+    if (is_serving || !MakeAddress (path, addr)) {
+        return false;
+    }
+
+    int fd = ::socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    // a stale socket file from a crashed process would make bind fail
+    ::unlink (path.c_str ());
+    if (::bind (fd, reinterpret_cast<sockaddr *>(&addr), sizeof (addr)) < 0 || ::listen (fd, 1) < 0) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Cannot serve handoff socket %s: %s", path.c_str (), strerror (errno));
+        ::close (fd);
+        return false;
+    }
+
+    socket_path = path;
+    listen_fd = fd;
+    is_serving = true;
+    serve_thread = std::thread (&ServerHandoff::ServeLoop, this, on_drain);
+
+    QUIZ_LOG_INFO (LOG_COMPONENT, "Accepting restart handover on %s", path.c_str ());
+    return true;
+}
+
+void ServerHandoff::ServeLoop (std::function<std::string ()> on_drain)
+{
+    while (is_serving) {
+        pollfd pfd {listen_fd, POLLIN, 0};
+        if (::poll (&pfd, 1, HANDOFF_POLL_MS) <= 0) {
+            continue;
+        }
+
+        int peer = ::accept (listen_fd, nullptr, nullptr);
+        if (peer < 0) {
+            continue;
+        }
+
+        std::string request;
+        if (!ReadLine (peer, request, HANDOFF_POLL_MS * 10) || request + "\n" != HANDOFF_DRAIN_REQUEST) {
+            QUIZ_LOG_WARN (LOG_COMPONENT, "Ignoring malformed handover request");
+            ::close (peer);
+            continue;
+        }
+
+        QUIZ_LOG_INFO (LOG_COMPONENT, "Handover requested, draining");
+        std::string state_path = on_drain ();
+
+        WriteAll (peer, HANDOFF_STATE_PREFIX + state_path + "\n");
+        ::close (peer);
+
+        // one handover per process - the new process serves the socket from now on
+        is_serving = false;
+    }
+
+    ::close (listen_fd);
+    listen_fd = -1;
+}
+
+void ServerHandoff::Stop ()
+{
+    is_serving = false;
+    if (serve_thread.joinable () && serve_thread.get_id () != std::this_thread::get_id ()) {
+        serve_thread.join ();
+    }
+}
+
+bool ServerHandoff::RequestTakeover (const std::string & path, std::string & state_path, int timeout_ms)
+{
+    sockaddr_un addr;
+    if (!MakeAddress (path, addr)) {
+        return false;
+    }
+
+    int fd = ::socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    if (::connect (fd, reinterpret_cast<sockaddr *>(&addr), sizeof (addr)) < 0) {
+        QUIZ_LOG_WARN (LOG_COMPONENT, "No server to take over at %s: %s", path.c_str (), strerror (errno));
+        ::close (fd);
+        return false;
+    }
+
+    std::string reply;
+    bool is_ok = WriteAll (fd, HANDOFF_DRAIN_REQUEST) && ReadLine (fd, reply, timeout_ms) &&
+                 reply.compare (0, strlen (HANDOFF_STATE_PREFIX), HANDOFF_STATE_PREFIX) == 0;
+    ::close (fd);
+
+    if (!is_ok) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Handover from %s did not complete", path.c_str ());
+        return false;
+    }
+
+    state_path = reply.substr (strlen (HANDOFF_STATE_PREFIX));
+    return true;
+}
+
+#else
+
+bool ServerHandoff::Serve (const std::string & path, std::function<std::string ()> on_drain)
+{
+    QUIZ_LOG_WARN (LOG_COMPONENT, "Restart handover is not available on this platform");
+    return false;
+}
+
+void ServerHandoff::ServeLoop (std::function<std::string ()> on_drain)
+{ }
+
+void ServerHandoff::Stop ()
+{ }
+
+bool ServerHandoff::RequestTakeover (const std::string & path, std::string & state_path, int timeout_ms)
+{
+    QUIZ_LOG_WARN (LOG_COMPONENT, "Restart handover is not available on this platform");
+    return false;
+}
+
+#endif
@@ -0,0 +1,44 @@
+// ServerHandoff.hpp
+#pragma once
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+/*
+* Restart handover between an old and a new server process over a local unix socket.
+*
+*   new process                                 old process (Serve)
+*   -----------                                 -------------------
+*   listen on the port (SO_REUSEPORT),
+*   admission closed (503 + Retry-After)
+*   RequestTakeover  ---- "DRAIN\n" ---->       stop listening, close clients with 1012,
+*                                               persist users to the state file
+*                    <--- "STATE <path>\n" --   stop
+*   load the state file, open admission
+*
+* Both processes share the port during the overlap, so there is always someone accepting and
+* clients that reconnect early are told to retry until the new process has the state.
+* POSIX only - on Windows Serve and RequestTakeover just report that handover is unavailable.
+*/
+class ServerHandoff {
+
+private:
+    std::string socket_path;
+    std::atomic<bool> is_serving;
+    std::thread serve_thread;
+    int listen_fd;
+
+    void ServeLoop (std::function<std::string ()> on_drain);
+
+public:
+    ServerHandoff ();
+    ~ServerHandoff ();
+
+    // Old side - on_drain drains the server and returns the state file path
+    bool Serve (const std::string & path, std::function<std::string ()> on_drain);
+    void Stop ();
+
+    // New side - blocks until the old process has drained, state_path receives its state file
+    static bool RequestTakeover (const std::string & path, std::string & state_path, int timeout_ms);
+};
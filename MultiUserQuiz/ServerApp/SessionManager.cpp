@@ -18,11 +18,32 @@ bool SessionManager::AddSession (connection_hdl hdl, const std::string & usernam
     std::unique_lock lock (session_mutex);
 
     // Check if user already connected from another handle
-    if (IsUserLoggedIn (username)) {
+    if (username_to_hdl.find (username) != username_to_hdl.end ()) {
         return false;
     }
 
     hdl_to_username[hdl] = username;
+    username_to_hdl[username] = hdl;
+    return true;
+}
+
+bool SessionManager::RebindSession (connection_hdl hdl, const std::string & username, bool & was_bound)
+{
+    std::unique_lock lock (session_mutex);
+
+    if (hdl_to_username.find (hdl) != hdl_to_username.end ()) {
+        return false;   // this connection already carries a session
+    }
+
+    auto it = username_to_hdl.find (username);
+    was_bound = it != username_to_hdl.end ();
+    if (was_bound) {
+        // the old connection may still look open (half open after a network drop) - it just loses the user
+        hdl_to_username.erase (it->second);
+    }
+
+    hdl_to_username[hdl] = username;
+    username_to_hdl[username] = hdl;
     return true;
 }
 
@@ -33,6 +54,10 @@ bool SessionManager::RemoveSession (connection_hdl hdl)
     auto it = hdl_to_username.find (hdl);
     if (it != hdl_to_username.end ()) {
 
+        auto user_it = username_to_hdl.find (it->second);
+        if (user_it != username_to_hdl.end () && !user_it->second.owner_before (hdl) && !hdl.owner_before (user_it->second)) {
+            username_to_hdl.erase (user_it);
+        }
         hdl_to_username.erase (it);
         return true;
     }
@@ -46,6 +71,17 @@ std::string SessionManager::GetUsername (connection_hdl hdl) const
     return (it != hdl_to_username.end ()) ? it->second : "";
 }
 
+bool SessionManager::GetConnectionHandle (const std::string & username, connection_hdl & hdl) const
+{
+    std::shared_lock lock (session_mutex);
+    auto it = username_to_hdl.find (username);
+    if (it == username_to_hdl.end ()) {
+        return false;
+    }
+    hdl = it->second;
+    return true;
+}
+
 std::shared_ptr<User> SessionManager::GetUser (const std::string & username) const
 {
     std::shared_lock lock (session_mutex);
@@ -59,22 +95,223 @@ std::shared_ptr<User> SessionManager::GetUserByHandle (connection_hdl hdl) const
     return username.empty () ? nullptr : GetUser (username);
 }
 
-bool SessionManager::CreateUser (const std::string & username)
+std::shared_ptr<User> SessionManager::CreateUser (const std::string & username, std::shared_ptr<const QuestionBank::Snapshot> bank,
+                                                 unsigned long long shuffle_seed, long long total_time_ms, long long start_ms, long long end_ms)
 {
     std::unique_lock lock (session_mutex);
     if (username_to_user.find (username) != username_to_user.end ()) {
-        return false; // User already exists
+        return nullptr; // User already exists
     }
-    username_to_user[username] = std::make_shared<User> (username);
-    return true;
+
+    // a provisioned candidate only claims its slot, the heap is for the ones nobody expected
+    std::shared_ptr<User> user = roster.Take (username);
+    if (!user) {
+        user = std::make_shared<User> (username);
+    }
+
+    // set before the user is published - export, leaderboard and RESUME threads read it without the lock
+    user->PinQuestionBank (std::move (bank));
+    user->SetShuffleSeed (shuffle_seed);
+    user->SetTotalTimeLimit (total_time_ms);
+    user->SetStartTimeInMs (start_ms);
+    user->SetEndTimeInMs (end_ms);
+    username_to_user[username] = user;
+    return user;
+}
+
+size_t SessionManager::ProvisionRoster (const std::string & path, unsigned int question_count)
+{
+    std::vector<std::string> usernames;
+    if (!UserRoster::ReadFile (path, usernames)) {
+        return 0;
+    }
+
+    std::unique_lock lock (session_mutex);
+    size_t provisioned = roster.Provision (usernames, question_count);
+
+    // the map takes every candidate without a rehash at the start rush
+    username_to_user.reserve (username_to_user.size () + provisioned);
+    return provisioned;
+}
+
+std::vector<std::shared_ptr<User>> SessionManager::GetAllUsers () const
+{
+    std::shared_lock lock (session_mutex);
+    std::vector<std::shared_ptr<User>> users;
+    users.reserve (username_to_user.size ());
+
+    for (const auto & entry : username_to_user) {
+        users.push_back (entry.second);
+    }
+    return users;
+}
+
+bool SessionManager::OpenArchive (const std::string & path)
+{
+    return archive.Open (path);
+}
+
+size_t SessionManager::ArchiveUsers (const std::vector<std::shared_ptr<User>> & users, long long exam_id)
+{
+    if (!archive.IsOpen ()) {
+        return 0;
+    }
+
+    // written and synced outside the session lock - a login meanwhile keeps its user in memory below
+    bool is_new_exam = archive.GetIndexedExam () != exam_id;
+    std::vector<std::shared_ptr<User>> stored;
+    for (const auto & user : users) {
+        if (IsUserLoggedIn (user->GetUserName ())) {
+            continue;
+        }
+        if (archive.Store (user->GetUserName (), exam_id, user->GetQuestionBank ()->version, user->Serialize ())) {
+            stored.push_back (user);
+        }
+    }
+    if (stored.empty () || !archive.Flush ()) {
+        return 0;
+    }
+
+    std::unique_lock lock (session_mutex);
+    if (is_new_exam) {
+        archived_banks.clear ();
+    }
+
+    size_t evicted = 0;
+    for (const auto & user : stored) {
+        const std::string & username = user->GetUserName ();
+        auto it = username_to_user.find (username);
+        if (username_to_hdl.find (username) == username_to_hdl.end () && it != username_to_user.end () && it->second == user) {
+            // the banks the exam ran on stay while its users can come back
+            std::shared_ptr<const QuestionBank::Snapshot> bank = user->GetQuestionBank ();
+            archived_banks.emplace (bank->version, bank);
+            username_to_user.erase (it);
+            ++evicted;
+        }
+    }
+    return evicted;
+}
+
+std::shared_ptr<User> SessionManager::LoadUser (const std::string & username)
+{
+    auto user = GetUser (username);
+    if (user || !archive.IsOpen ()) {
+        return user;
+    }
+
+    nlohmann::json state;
+    unsigned long long bank_version = 0;
+    if (!archive.Load (username, state, bank_version)) {
+        return nullptr;
+    }
+
+    // a rostered candidate goes back into its slot
+    user = roster.Take (username);
+    if (user) {
+        user->RestoreState (state);
+    } else {
+        user = User::Restore (state);
+    }
+
+    std::unique_lock lock (session_mutex);
+
+    // graded and shown on the bank the exam ran on - after a handover only the current one is known
+    auto bank = archived_banks.find (bank_version);
+    user->PinQuestionBank (bank != archived_banks.end () ? bank->second : QuestionBank::GetInstance ().GetSnapshot ());
+
+    // a LoadUser of the same user racing this one - whichever got in first is kept
+    return username_to_user.emplace (username, user).first->second;
+}
+
+std::vector<std::string> SessionManager::RetireArchivedExam ()
+{
+    std::vector<std::string> usernames = archive.Retire ();
+
+    std::unique_lock lock (session_mutex);
+    archived_banks.clear ();
+    return usernames;
+}
+
+bool SessionManager::IndexArchivedExam (long long exam_id)
+{
+    return exam_id != 0 && archive.IndexExam (exam_id);
+}
+
+long long SessionManager::GetArchivedExam () const
+{
+    return archive.GetIndexedExam ();
+}
+
+nlohmann::json SessionManager::SerializeUsers () const
+{
+    std::shared_lock lock (session_mutex);
+    nlohmann::json users = nlohmann::json::array ();
+
+    for (const auto & [username, user] : username_to_user) {
+        users.push_back (user->Serialize ());
+    }
+    return users;
+}
+
+size_t SessionManager::RestoreUsers (const nlohmann::json & users)
+{
+    std::unique_lock lock (session_mutex);
+    size_t restored = 0;
+
+    for (const auto & state : users) {
+        auto user = User::Restore (state);
+        if (!state.value ("name", "").empty ()) {
+            username_to_user[state["name"]] = user;
+            ++restored;
+        }
+    }
+    return restored;
+}
+
+void SessionManager::SetNotifier (std::function<void (connection_hdl, const std::string &)> callback)
+{
+    std::unique_lock lock (session_mutex);
+    notifier = callback;
 }
 
 void SessionManager::NotifyUser (const std::string & username, const std::string & message)
 {
+    connection_hdl hdl;
+    std::function<void (connection_hdl, const std::string &)> notify;
+    {
+        std::shared_lock lock (session_mutex);
+        auto it = username_to_hdl.find (username);
+        if (it == username_to_hdl.end ()) {
+            return;
+        }
+        hdl = it->second;
+        notify = notifier;
+    }
+
+    // deliver outside the lock, the notifier takes the connection send locks
+    if (notify) {
+        notify (hdl, message);
+    }
 }
 
 void SessionManager::NotifyAllUsers (const std::string & message)
 {
+    std::vector<connection_hdl> targets;
+    std::function<void (connection_hdl, const std::string &)> notify;
+    {
+        std::shared_lock lock (session_mutex);
+        targets.reserve (hdl_to_username.size ());
+        for (const auto & entry : hdl_to_username) {
+            targets.push_back (entry.first);
+        }
+        notify = notifier;
+    }
+
+    for (auto & hdl : targets) {
+        if (notify) {
+            notify (hdl, message);
+        }
+    }
 }
 
 bool SessionManager::ValidateSession (connection_hdl hdl, std::string & error_msg) const
@@ -91,11 +328,5 @@ bool SessionManager::ValidateSession (connection_hdl hdl, std::string & error_ms
 bool SessionManager::IsUserLoggedIn (const std::string & username) const
 {
     std::shared_lock lock (session_mutex);
-
-    for (const auto & [hdl, existing_user] : hdl_to_username) {
-        if (existing_user == username) {
-            return true;
-        }
-    }
-    return false;
+    return username_to_hdl.find (username) != username_to_hdl.end ();
 }
\ No newline at end of file
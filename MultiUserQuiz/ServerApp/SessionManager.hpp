@@ -1,12 +1,16 @@
 
 // SessionManager.hpp
 #pragma once
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <shared_mutex>
 #include <websocketpp/connection.hpp>
 #include <User.h>
+#include "UserArchive.hpp"
+#include "UserRoster.hpp"
 
 using connection_hdl = websocketpp::connection_hdl;
 
@@ -16,9 +20,20 @@ class SessionManager {
     static std::mutex instance_mutex;
 
     std::map<connection_hdl, std::string, std::owner_less<connection_hdl>> hdl_to_username;
+    std::unordered_map<std::string, connection_hdl> username_to_hdl;   // reverse of hdl_to_username, one live handle per user
     std::unordered_map<std::string, std::shared_ptr<User>> username_to_user;
     mutable std::shared_mutex session_mutex;
 
+    // pre-built users for the expected candidates, see UserRoster
+    UserRoster roster;
+
+    // finished users moved out of username_to_user, see ArchiveUsers
+    UserArchive archive;
+    std::unordered_map<unsigned long long, std::shared_ptr<const QuestionBank::Snapshot>> archived_banks;   // by version, for LoadUser
+
+    // Delivers a push message to one connection - installed by the ConnectionManager
+    std::function<void (connection_hdl, const std::string &)> notifier;
+
     SessionManager () = default;
 
     public:
@@ -28,18 +43,46 @@ class SessionManager {
     bool AddSession (connection_hdl hdl, const std::string & username);
     bool RemoveSession (connection_hdl hdl);
     std::string GetUsername (connection_hdl hdl) const;
-//    connection_hdl GetConnectionHandle (const std::string & username) const;
+    bool GetConnectionHandle (const std::string & username, connection_hdl & hdl) const;
+
+    // Moves the user's session onto a new handle - was_bound tells if another handle still carried it
+    bool RebindSession (connection_hdl hdl, const std::string & username, bool & was_bound);
 
     // User management
     std::shared_ptr<User> GetUser (const std::string & username) const;
     std::shared_ptr<User> GetUserByHandle (connection_hdl hdl) const;
-    bool CreateUser (const std::string & username);
+    // the new user (a roster slot when there is one) pinned to bank with its exam's seed and time limits (0 = none),
+    // nullptr if the user already exists
+    std::shared_ptr<User> CreateUser (const std::string & username, std::shared_ptr<const QuestionBank::Snapshot> bank,
+                                      unsigned long long shuffle_seed, long long total_time_ms, long long start_ms, long long end_ms);
+
+    // reads the roster file and provisions its users for an exam of question_count questions - call before serving
+    size_t ProvisionRoster (const std::string & path, unsigned int question_count);
+    std::vector<std::shared_ptr<User>> GetAllUsers () const;
+
+    // Users of an ended exam - written to the archive and dropped from memory, read back when they come
+    // again to see their results. Only the last archived exam comes back, until RetireArchivedExam.
+    bool OpenArchive (const std::string & path);
+    // users logged in at the time stay in memory - returns how many left it
+    size_t ArchiveUsers (const std::vector<std::shared_ptr<User>> & users, long long exam_id);
+    // the user in memory, else the archived one brought back, nullptr if there is neither
+    std::shared_ptr<User> LoadUser (const std::string & username);
+    // the next exam starts - returns the users of the old one
+    std::vector<std::string> RetireArchivedExam ();
+    // state handover - the new process brings back the same exam's users
+    bool IndexArchivedExam (long long exam_id);
+    long long GetArchivedExam () const;
+
+    // State handover across a server restart - connections are not carried over, only users
+    nlohmann::json SerializeUsers () const;
+    size_t RestoreUsers (const nlohmann::json & users);
 
     // Connection state
     bool IsUserLoggedIn (const std::string & username) const;
 //    bool IsHandleValid (connection_hdl hdl) const;
 
     // Notification support
+    void SetNotifier (std::function<void (connection_hdl, const std::string &)> callback);
     void NotifyUser (const std::string & username, const std::string & message);
     void NotifyAllUsers (const std::string & message);
 
@@ -0,0 +1,63 @@
+// TokenBucket.cpp
+#include "TokenBucket.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#define RETRY_JITTER_MIN_MS     250
+
+TokenBucket::TokenBucket (double rate, double burst_size)
+    : rate_per_sec (rate),
+    burst (std::max (burst_size, 1.0)),
+    tokens (std::max (burst_size, 1.0)),
+    last_refill (std::chrono::steady_clock::now ())
+{ }
+
+void TokenBucket::Configure (double rate, double burst_size)
+{
+    std::lock_guard<std::mutex> lock (bucket_mutex);
+    rate_per_sec = rate;
+    burst = std::max (burst_size, 1.0);
+    tokens = burst;
+    last_refill = std::chrono::steady_clock::now ();
+}
+
+bool TokenBucket::IsLimited () const
+{
+    return rate_per_sec > 0;
+}
+
+void TokenBucket::Refill (std::chrono::steady_clock::time_point now)
+{
+    double elapsed_sec = std::chrono::duration<double> (now - last_refill).count ();
+    tokens = std::min (burst, tokens + elapsed_sec * rate_per_sec);
+    last_refill = now;
+}
+
+bool TokenBucket::TryAcquire (long long & retry_after_ms)
+{
+    std::lock_guard<std::mutex> lock (bucket_mutex);
+    retry_after_ms = 0;
+
+    if (rate_per_sec <= 0) {
+        return true;
+    }
+
+    Refill (std::chrono::steady_clock::now ());
+    if (tokens >= 1.0) {
+        tokens -= 1.0;
+        return true;
+    }
+
+    retry_after_ms = static_cast<long long>(std::ceil ((1.0 - tokens) * 1000.0 / rate_per_sec));
+    return false;
+}
+
+long long TokenBucket::JitterRetryDelay (long long delay_ms)
+{
+    thread_local std::mt19937 rng (std::random_device {} ());
+
+    long long spread = std::max (delay_ms, static_cast<long long>(RETRY_JITTER_MIN_MS));
+    std::uniform_int_distribution<long long> dist (0, spread);
+    return delay_ms + dist (rng);
+}
@@ -0,0 +1,33 @@
+// TokenBucket.hpp
+#pragma once
+#include <chrono>
+#include <mutex>
+
+/*
+* Classic token bucket used for admission control - refills at "rate" tokens per second
+* up to "burst" tokens. A rate of 0 disables the limit.
+*
+* TryAcquire never blocks, on refusal it reports how long until a token will be available
+* so the caller can tell the client when to come back.
+*/
+class TokenBucket {
+
+private:
+    double rate_per_sec;
+    double burst;
+    double tokens;
+    std::chrono::steady_clock::time_point last_refill;
+    std::mutex bucket_mutex;
+
+    void Refill (std::chrono::steady_clock::time_point now);
+
+public:
+    TokenBucket (double rate = 0, double burst_size = 0);
+
+    void Configure (double rate, double burst_size);
+    bool TryAcquire (long long & retry_after_ms);
+    bool IsLimited () const;
+
+    // Spreads retries over [delay, 2 * delay] (at least RETRY_JITTER_MIN_MS wide) so refused clients don't come back in lock step
+    static long long JitterRetryDelay (long long delay_ms);
+};
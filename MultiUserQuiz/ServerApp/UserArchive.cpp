@@ -0,0 +1,264 @@
+// UserArchive.cpp
+#include "UserArchive.hpp"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <filesystem>
+#include <fstream>
+#include "Logger.h"
+
+static const char * LOG_COMPONENT = "UserArchive";
+
+#define ARCHIVE_HEADER_BYTES    4
+#define ARCHIVE_MAX_RECORD      (64u << 20)     // a longer length can only be a damaged file
+
+namespace {
+
+    void PutLength (unsigned char * out, uint32_t size)
+    {
+        for (int i = 0; i < ARCHIVE_HEADER_BYTES; ++i) {
+            out[i] = static_cast<unsigned char>(size >> (8 * i));
+        }
+    }
+
+    uint32_t GetLength (const unsigned char * in)
+    {
+        uint32_t size = 0;
+        for (int i = 0; i < ARCHIVE_HEADER_BYTES; ++i) {
+            size |= static_cast<uint32_t>(in[i]) << (8 * i);
+        }
+        return size;
+    }
+
+    // offsets past 2 GB, long is 32 bit on Windows
+    bool SeekTo (std::FILE * file, uint64_t offset)
+    {
+#ifdef _WIN32
+        return _fseeki64 (file, static_cast<long long>(offset), SEEK_SET) == 0;
+#else
+        return fseeko (file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+} // anonymous namespace
+
+UserArchive::~UserArchive ()
+{
+    Close ();
+}
+
+bool UserArchive::Scan (long long exam_id)
+{
+    index.clear ();
+    indexed_exam = exam_id;
+    end_offset = 0;
+
+    std::ifstream in (path, std::ios::binary);
+    if (!in) {
+        return true;    // nothing archived yet
+    }
+
+    unsigned char header[ARCHIVE_HEADER_BYTES];
+    std::vector<std::uint8_t> record;
+    uint64_t offset = 0;
+
+    while (in.read (reinterpret_cast<char *>(header), ARCHIVE_HEADER_BYTES)) {
+        uint32_t size = GetLength (header);
+        if (size == 0 || size > ARCHIVE_MAX_RECORD) {
+            break;
+        }
+        record.resize (size);
+        if (!in.read (reinterpret_cast<char *>(record.data ()), size)) {
+            break;
+        }
+
+        nlohmann::json entry = nlohmann::json::from_cbor (record, true, false);
+        if (entry.is_discarded () || !entry.contains ("user") || entry["user"].value ("name", "").empty ()) {
+            break;
+        }
+        if (exam_id != 0 && entry.value ("exam", 0LL) == exam_id) {
+            index[entry["user"]["name"].get<std::string> ()] = {offset + ARCHIVE_HEADER_BYTES, size};
+        }
+        offset += ARCHIVE_HEADER_BYTES + size;
+    }
+    in.close ();
+
+    std::error_code ec;
+    uint64_t file_size = std::filesystem::file_size (path, ec);
+    if (!ec && file_size > offset) {
+        QUIZ_LOG_WARN (LOG_COMPONENT, "Cutting %llu damaged bytes off the end of %s",
+                       static_cast<unsigned long long>(file_size - offset), path.c_str ());
+        std::filesystem::resize_file (path, offset, ec);
+        if (ec) {
+            QUIZ_LOG_ERROR (LOG_COMPONENT, "Could not truncate %s", path.c_str ());
+            return false;
+        }
+    }
+    end_offset = offset;
+    return true;
+}
+
+bool UserArchive::Open (const std::string & archive_path)
+{
+    std::lock_guard<std::mutex> lock (archive_mutex);
+    if (file) {
+        return true;
+    }
+
+    path = archive_path;
+    if (!Scan (0)) {
+        return false;
+    }
+
+    file = std::fopen (path.c_str (), "a+b");
+    if (!file) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "Could not open user archive %s", path.c_str ());
+        return false;
+    }
+
+    QUIZ_LOG_INFO (LOG_COMPONENT, "Archiving finished users to %s (%llu bytes there)",
+                   path.c_str (), static_cast<unsigned long long>(end_offset));
+    return true;
+}
+
+void UserArchive::Close ()
+{
+    std::lock_guard<std::mutex> lock (archive_mutex);
+    if (file) {
+        std::fclose (file);
+        file = nullptr;
+    }
+    index.clear ();
+    indexed_exam = 0;
+}
+
+bool UserArchive::Store (const std::string & username, long long exam_id, unsigned long long bank_version, const nlohmann::json & state)
+{
+    nlohmann::json entry = {
+        {"exam", exam_id},
+        {"bank", bank_version},
+        {"user", state}
+    };
+    std::vector<std::uint8_t> record = nlohmann::json::to_cbor (entry);
+    if (record.size () > ARCHIVE_MAX_RECORD) {
+        return false;
+    }
+
+    unsigned char header[ARCHIVE_HEADER_BYTES];
+    PutLength (header, static_cast<uint32_t>(record.size ()));
+
+    std::lock_guard<std::mutex> lock (archive_mutex);
+    if (!file) {
+        return false;
+    }
+
+    // a read may have moved the position - appends still go to the end, but a seek must sit in between
+    std::fseek (file, 0, SEEK_END);
+    if (std::fwrite (header, 1, ARCHIVE_HEADER_BYTES, file) != ARCHIVE_HEADER_BYTES ||
+        std::fwrite (record.data (), 1, record.size (), file) != record.size ()) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "User archive write failed for %s", username.c_str ());
+        return false;
+    }
+
+    // one exam indexed at a time
+    if (exam_id != indexed_exam) {
+        index.clear ();
+        indexed_exam = exam_id;
+    }
+    index[username] = {end_offset + ARCHIVE_HEADER_BYTES, static_cast<uint32_t>(record.size ())};
+    end_offset += ARCHIVE_HEADER_BYTES + record.size ();
+    return true;
+}
+
+bool UserArchive::Flush ()
+{
+    std::lock_guard<std::mutex> lock (archive_mutex);
+    if (!file) {
+        return false;
+    }
+
+    if (std::fflush (file) != 0) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "User archive flush failed");
+        return false;
+    }
+
+#ifdef _WIN32
+    int sync_result = _commit (_fileno (file));
+#else
+    int sync_result = fsync (fileno (file));
+#endif
+    if (sync_result != 0) {
+        QUIZ_LOG_ERROR (LOG_COMPONENT, "User archive sync failed");
+        return false;
+    }
+    return true;
+}
+
+bool UserArchive::Load (const std::string & username, nlohmann::json & state, unsigned long long & bank_version) const
+{
+    std::vector<std::uint8_t> record;
+    {
+        std::lock_guard<std::mutex> lock (archive_mutex);
+        auto it = index.find (username);
+        if (!file || it == index.end ()) {
+            return false;
+        }
+
+        // what Store left in the buffer has to reach the file before it can be read back
+        record.resize (it->second.size);
+        if (std::fflush (file) != 0 || !SeekTo (file, it->second.offset) ||
+            std::fread (record.data (), 1, record.size (), file) != record.size ()) {
+            QUIZ_LOG_ERROR (LOG_COMPONENT, "User archive read failed for %s", username.c_str ());
+            return false;
+        }
+    }
+
+    nlohmann::json entry = nlohmann::json::from_cbor (record, true, false);
+    if (entry.is_discarded () || !entry.contains ("user")) {
+        return false;
+    }
+    bank_version = entry.value ("bank", 0ULL);
+    state = std::move (entry["user"]);
+    return true;
+}
+
+bool UserArchive::IndexExam (long long exam_id)
+{
+    std::lock_guard<std::mutex> lock (archive_mutex);
+    if (!file) {
+        return false;
+    }
+    if (std::fflush (file) != 0) {
+        return false;
+    }
+    return Scan (exam_id);
+}
+
+long long UserArchive::GetIndexedExam () const
+{
+    std::lock_guard<std::mutex> lock (archive_mutex);
+    return indexed_exam;
+}
+
+std::vector<std::string> UserArchive::Retire ()
+{
+    std::lock_guard<std::mutex> lock (archive_mutex);
+    std::vector<std::string> usernames;
+    usernames.reserve (index.size ());
+    for (const auto & entry : index) {
+        usernames.push_back (entry.first);
+    }
+
+    // swapped out, clear alone would keep the buckets of the old exam
+    std::unordered_map<std::string, Location> ().swap (index);
+    indexed_exam = 0;
+    return usernames;
+}
+
+size_t UserArchive::Size () const
+{
+    std::lock_guard<std::mutex> lock (archive_mutex);
+    return index.size ();
+}
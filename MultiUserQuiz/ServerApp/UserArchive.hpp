@@ -0,0 +1,72 @@
+// UserArchive.hpp
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/*
+* Users whose exam is over, moved out of memory - an append only file of records
+*
+*   uint32    record length (little endian)
+*   byte[]    CBOR { "exam": exam id, "bank": bank version, "user": User::Serialize }
+*
+* The file keeps every exam, but only one exam is indexed (username -> record position) - the one
+* whose results can still be looked at. Storing users of another exam, or Retire when the next exam
+* starts, drops the old index, so what stays in memory is bounded by one exam. A user archived again
+* gets a new record, the newest one wins.
+*
+* Open only checks the file - a record torn by a crash is cut off - and indexes nothing, users of an
+* exam from before the restart do not come back unless IndexExam says so (state handover).
+*/
+class UserArchive {
+
+    struct Location {
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    std::string path;
+    std::FILE * file = nullptr;
+    uint64_t end_offset = 0;
+    long long indexed_exam = 0;
+    std::unordered_map<std::string, Location> index;
+    mutable std::mutex archive_mutex;
+
+    // walks the records, indexing the ones of exam_id (0 = none) - end_offset is where the valid part ends
+    bool Scan (long long exam_id);
+
+public:
+    UserArchive () = default;
+    ~UserArchive ();
+
+    UserArchive (const UserArchive &) = delete;
+    UserArchive & operator= (const UserArchive &) = delete;
+
+    // checks what is already in path and appends to it, false when it cannot be opened
+    bool Open (const std::string & path);
+    void Close ();
+
+    bool IsOpen () const { return file != nullptr; }
+
+    // appends the user's state - not on disk before Flush
+    bool Store (const std::string & username, long long exam_id, unsigned long long bank_version, const nlohmann::json & state);
+
+    // writes and syncs what was stored, only then may the users leave memory
+    bool Flush ();
+
+    // the newest state archived for the user in the indexed exam, false if there is none
+    bool Load (const std::string & username, nlohmann::json & state, unsigned long long & bank_version) const;
+
+    // indexes the users of exam_id from the file, replacing the current index
+    bool IndexExam (long long exam_id);
+    long long GetIndexedExam () const;
+
+    // forgets the indexed exam - returns its users, the records stay in the file
+    std::vector<std::string> Retire ();
+
+    size_t Size () const;
+};
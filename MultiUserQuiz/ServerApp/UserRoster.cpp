@@ -0,0 +1,77 @@
+// UserRoster.cpp
+#include "UserRoster.hpp"
+#include <fstream>
+#include <new>
+
+UserRoster::Slab::Slab (size_t capacity)
+    : slots (static_cast<Slot *>(::operator new (capacity * sizeof (Slot))))
+{
+}
+
+UserRoster::Slab::~Slab ()
+{
+    for (size_t i = 0; i < count; ++i) {
+        slots[i].~Slot ();
+    }
+    ::operator delete (slots);
+}
+
+bool UserRoster::ReadFile (const std::string & path, std::vector<std::string> & usernames)
+{
+    std::ifstream in (path);
+    if (!in) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline (in, line)) {
+        size_t first = line.find_first_not_of (" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        size_t last = line.find_last_not_of (" \t\r");
+        usernames.push_back (line.substr (first, last - first + 1));
+    }
+    return true;
+}
+
+size_t UserRoster::Provision (const std::vector<std::string> & usernames, unsigned int question_count)
+{
+    slab = std::make_shared<Slab> (usernames.size ());
+    reserved_questions = question_count;
+    index.clear ();
+    index.reserve (usernames.size ());
+
+    for (const auto & username : usernames) {
+        if (index.count (username)) {
+            continue;
+        }
+
+        // count only moves past a slot once it is constructed, the slab destroys exactly those
+        Slot * slot = new (&slab->slots[slab->count]) Slot (username);
+        ++slab->count;
+
+        slot->user.ReserveAnswers (question_count);
+        index.emplace (username, slot);
+    }
+
+    return slab->count;
+}
+
+std::shared_ptr<User> UserRoster::Take (const std::string & username)
+{
+    auto it = index.find (username);
+    if (it == index.end () || it->second->is_taken.exchange (true, std::memory_order_acq_rel)) {
+        return nullptr;
+    }
+
+    // keeps the slab alive, and puts a fresh user back into the slot once nobody holds this one
+    Slot * slot = it->second;
+    return std::shared_ptr<User> (&slot->user, [owner = slab, slot, question_count = reserved_questions] (User *) {
+        std::string username = slot->user.GetUserName ();
+        slot->user.~User ();
+        new (&slot->user) User (username);
+        slot->user.ReserveAnswers (question_count);
+        slot->is_taken.store (false, std::memory_order_release);
+    });
+}
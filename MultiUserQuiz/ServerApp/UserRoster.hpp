@@ -0,0 +1,59 @@
+// UserRoster.hpp
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <User.h>
+
+/*
+* Candidates provisioned before the exam starts - one contiguous slab of User objects built from the
+* roster file at startup, each with its answer storage sized for the bank. START_QUIZ then claims the
+* user's slot (a lookup and an atomic flag) instead of allocating and constructing under the session
+* lock at the very moment every candidate presses start.
+*
+* A claimed slot is handed out as a shared_ptr that keeps the whole slab alive. When its last holder
+* lets go (the user was archived, see SessionManager::ArchiveUsers) the slot gets a fresh user and can
+* be taken again, so the slab is all the memory the roster ever needs. Users not on the roster still
+* get a heap User as before.
+*
+* Provision runs once at startup, before any connection - Take is safe from any thread after that.
+*/
+class UserRoster {
+
+private:
+    struct Slot {
+        User user;
+        std::atomic<bool> is_taken {false};
+
+        explicit Slot (const std::string & username) : user (username) { }
+    };
+
+    struct Slab {
+        Slot * slots = nullptr;
+        size_t count = 0;
+
+        explicit Slab (size_t capacity);
+        ~Slab ();
+
+        Slab (const Slab &) = delete;
+        Slab & operator= (const Slab &) = delete;
+    };
+
+    std::shared_ptr<Slab> slab;
+    std::unordered_map<std::string, Slot *> index;
+    unsigned int reserved_questions = 0;
+
+public:
+    // one username per line, blank lines and '#' comments skipped - false when the file cannot be read
+    static bool ReadFile (const std::string & path, std::vector<std::string> & usernames);
+
+    // builds the slab, duplicates are provisioned once - returns the number of slots
+    size_t Provision (const std::vector<std::string> & usernames, unsigned int question_count);
+
+    // the user's slot, nullptr when not on the roster or already taken
+    std::shared_ptr<User> Take (const std::string & username);
+
+    size_t Size () const { return index.size (); }
+};
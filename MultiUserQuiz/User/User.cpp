@@ -1,8 +1,10 @@
 #include "User.h"
+#include "QuizClock.h"
 
 User::User (const std::string & pUserName)
 {
-    vResultPtr = std::make_unique<Result> ();
+    vStartTime = vEndTime = 0;
+    vShuffleSeed = 0;
     vUserName = pUserName;
     ResetLastActivityTimeInMs ();
 }
@@ -34,7 +36,7 @@ long long User::GetEndTimeInMs () const
 
 void User::SetLastActivityTimeInMs ()
 {
-    vLastActivityTime = QuizHelper::get_current_time_in_ms ();
+    vLastActivityTime = QuizClock::NowMs ();
 }
 
 void User::ResetLastActivityTimeInMs ()
@@ -49,45 +51,152 @@ long long User::GetlastActivityTimeInMs () const
 
 void User::SetTotalTimeLimit (long long pTotaltime)
 {
-    vResultPtr->SetTotalTimeLimit (pTotaltime);
+    vResult.SetTotalTimeLimit (pTotaltime);
 }
 
 long long User::GetTotalTimeLimit () const
 {
-    return vResultPtr->GetTotalTimeLimit ();
+    return vResult.GetTotalTimeLimit ();
 }
 
 void User::UpdateElapsedTimeInQuiz (long long pTimeElapsed)
 {
-    vResultPtr->UpdateTimeElapsed (pTimeElapsed);
+    vResult.UpdateTimeElapsed (pTimeElapsed);
 }
 
 void User::AddToElapsedTimeInQuiz (long long pTimeElapsed)
 {
-    vResultPtr->AddToElapsedTime (pTimeElapsed);
+    vResult.AddToElapsedTime (pTimeElapsed);
 }
 
 long long User::GetElapsedTime ()
 {
-    return vResultPtr->GetTimeElapsedInQuiz ();
+    return vResult.GetTimeElapsedInQuiz ();
 }
 
 eQuesAttemptStatus User::SetAndValidateUserAnswer (Answer & pAns)
 {
-    return vResultPtr->AddAnswer (pAns);
+    eQuesAttemptStatus status = vResult.AddAnswer (pAns, *GetQuestionBank ());
+    vChangeLog.emplace_back (pAns.GetQuestionId (), status);
+    return status;
+}
+
+std::vector<eQuesAttemptStatus> User::SetAndValidateUserAnswers (std::vector<Answer> & pAnswers)
+{
+    std::vector<eQuesAttemptStatus> statuses = vResult.AddAnswers (pAnswers, *GetQuestionBank ());
+    for (size_t i = 0; i < statuses.size (); ++i) {
+        vChangeLog.emplace_back (pAnswers[i].GetQuestionId (), statuses[i]);
+    }
+    return statuses;
 }
 
 double User::GetUserCurrentScore ()
 {
-    return vResultPtr->GetCurrentScore ();
+    return vResult.GetCurrentScore ();
 }
 
 void User::ShowFinalScore (bool pShowIncorrectAttempts)
 {
-    vResultPtr->PrintFinalResult (pShowIncorrectAttempts);
+    vResult.PrintFinalResult (pShowIncorrectAttempts);
 }
 
 std::vector<unsigned int> User::GetUnattemptedQuestionIds () const
 {
-    return vResultPtr->GetUnattemptedQuestionIds ();
+    return vResult.GetUnattemptedQuestionIds (GetQuestionBank ()->TotalQuestionCount ());
+}
+
+const std::string & User::GetUserName () const
+{
+    return vUserName;
+}
+
+void User::PinQuestionBank (std::shared_ptr<const QuestionBank::Snapshot> pBank)
+{
+    std::atomic_store (&vBank, std::move (pBank));
+}
+
+void User::ReserveAnswers (unsigned int pQuesCount)
+{
+    vResult.Reserve (pQuesCount);
+    vChangeLog.reserve (pQuesCount);
+}
+
+std::shared_ptr<const QuestionBank::Snapshot> User::GetQuestionBank () const
+{
+    std::shared_ptr<const QuestionBank::Snapshot> bank = std::atomic_load (&vBank);
+    return bank ? bank : QuestionBank::GetInstance ().GetSnapshot ();
+}
+
+void User::SetShuffleSeed (unsigned long long pSeed)
+{
+    vShuffleSeed = pSeed;
+}
+
+unsigned long long User::GetShuffleSeed () const
+{
+    return vShuffleSeed;
+}
+
+void User::ExportColumns (size_t pUserIndex, size_t pUserCount, unsigned int pQuesCount,
+                          unsigned char * pStatusColumns, unsigned char * pMaskColumns) const
+{
+    vResult.ExportColumns (pUserIndex, pUserCount, pQuesCount, pStatusColumns, pMaskColumns);
+}
+
+unsigned long long User::GetSequence () const
+{
+    return vChangeLog.size ();
+}
+
+std::vector<std::pair<unsigned int, eQuesAttemptStatus>> User::GetChangesSince (unsigned long long pSeq) const
+{
+    if (pSeq >= vChangeLog.size ()) {
+        return {};
+    }
+    return std::vector<std::pair<unsigned int, eQuesAttemptStatus>> (vChangeLog.begin () + pSeq, vChangeLog.end ());
+}
+
+nlohmann::json User::Serialize () const
+{
+    nlohmann::json changes = nlohmann::json::array ();
+    for (const auto & [quesId, status] : vChangeLog) {
+        changes.push_back ({quesId, static_cast<int>(status)});
+    }
+
+    return {
+        {"name", vUserName},
+        {"start_time", vStartTime ? QuizClock::ToWallMs (vStartTime) : 0},
+        {"end_time", vEndTime ? QuizClock::ToWallMs (vEndTime) : 0},
+        {"shuffle_seed", vShuffleSeed},
+        {"result", vResult.Serialize ()},
+        {"changes", changes}
+    };
+}
+
+/*
+* Last activity is not restored - the user is disconnected at that point and the elapsed time
+* for the gap was already accounted for when the old server closed the connection.
+*/
+std::shared_ptr<User> User::Restore (const nlohmann::json & state)
+{
+    auto user = std::make_shared<User> (state.value ("name", ""));
+    user->RestoreState (state);
+    return user;
+}
+
+void User::RestoreState (const nlohmann::json & state)
+{
+    // written as wall time, the monotonic clock of the old process means nothing here
+    long long start_time = state.value ("start_time", 0LL);
+    long long end_time = state.value ("end_time", 0LL);
+    vStartTime = start_time ? QuizClock::FromWallMs (start_time) : 0;
+    vEndTime = end_time ? QuizClock::FromWallMs (end_time) : 0;
+    vShuffleSeed = state.value ("shuffle_seed", 0ULL);
+    vResult.Restore (state.value ("result", nlohmann::json::object ()));
+
+    // sequence numbers must survive the handover, resuming clients compare against them
+    vChangeLog.clear ();
+    for (const auto & change : state.value ("changes", nlohmann::json::array ())) {
+        vChangeLog.emplace_back (change[0].get<unsigned int> (), static_cast<eQuesAttemptStatus>(change[1].get<int> ()));
+    }
 }
\ No newline at end of file
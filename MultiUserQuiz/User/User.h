@@ -33,21 +33,56 @@ class User {
         long long               GetElapsedTime              ();
 
         eQuesAttemptStatus      SetAndValidateUserAnswer    (Answer & pAns);
+        std::vector<eQuesAttemptStatus> SetAndValidateUserAnswers (std::vector<Answer> & pAnswers);
         double                  GetUserCurrentScore         ();
         void                    ShowFinalScore              (bool pShowIncorrectAttempts);
 
         std::vector<unsigned int> GetUnattemptedQuestionIds () const;
 
+        const std::string &     GetUserName                 () const;
+
+        // The version of the question bank this user's exam runs on - grading, payloads and the question count
+        // all come from it, so a bank reload can never change ids or answer keys under a running exam.
+        // Not pinned means the current bank.
+        void                    PinQuestionBank             (std::shared_ptr<const QuestionBank::Snapshot> pBank);
+        std::shared_ptr<const QuestionBank::Snapshot> GetQuestionBank () const;
+
+        // sizes the answer storage for an exam of pQuesCount questions up front, see UserRoster
+        void                    ReserveAnswers              (unsigned int pQuesCount);
+
+        // seed of the user's question / option order, see QuestionShuffle
+        void                    SetShuffleSeed              (unsigned long long pSeed);
+        unsigned long long      GetShuffleSeed              () const;
+
+        // bulk export, see Result::ExportColumns
+        void                    ExportColumns               (size_t pUserIndex, size_t pUserCount, unsigned int pQuesCount,
+                                                             unsigned char * pStatusColumns, unsigned char * pMaskColumns) const;
+
+        // every graded answer bumps the sequence, a resuming client asks for the changes after the last one it saw
+        unsigned long long      GetSequence                 () const;
+        std::vector<std::pair<unsigned int, eQuesAttemptStatus>> GetChangesSince (unsigned long long pSeq) const;
+
+        // persistence - used to hand the user state over to a restarted server
+        nlohmann::json          Serialize                   () const;
+        static std::shared_ptr<User> Restore                (const nlohmann::json & state);
+        void                    RestoreState                (const nlohmann::json & state);     // into a fresh user, e.g. a roster slot
+
     private:
 
-        long long               vStartTime;                 // stores the julian time when the quiz is started, used in strict mode to know when the quiz started
+        long long               vStartTime;                 // stores the QuizClock (monotonic) time when the quiz is started, used in strict mode to know when the quiz started
 
-        long long               vEndTime;                   // stores the julian time when the quiz will end - used in strict time bound mode.
+        long long               vEndTime;                   // stores the QuizClock (monotonic) time when the quiz will end - used in strict time bound mode.
 
         long long               vLastActivityTime;          // This stores when the last request came from client to fetch question or submit answer. This will help in calculating 
                                                             // the elapsed time in case of disconnection happens after long duration of inactivity at client.
 
-        std::unique_ptr<Result> vResultPtr;                 // Result object for this user
+        Result                  vResult;                    // Result of this user - inline, a user is one allocation (or a roster slot)
+
+        unsigned long long      vShuffleSeed;               // the only per user state the shuffled order needs
+
+        std::shared_ptr<const QuestionBank::Snapshot> vBank;    // pinned bank version, only touched through std::atomic_load / atomic_store
+
+        std::vector<std::pair<unsigned int, eQuesAttemptStatus>> vChangeLog;   // graded answers in order, entry i has sequence number i + 1
         std::string             vUserName;                  // User name
 };
 